@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "AuAl"
+  "AuAl.pdb"
+  "CMakeFiles/AuAl.dir/examples/AuAl.c.o"
+  "CMakeFiles/AuAl.dir/examples/AuAl.c.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/AuAl.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/argparse.dir/src/argparse.c.o"
+  "CMakeFiles/argparse.dir/src/argparse.c.o.d"
+  "libargparse.a"
+  "libargparse.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/argparse.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
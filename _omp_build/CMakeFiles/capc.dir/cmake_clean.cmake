@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/capc.dir/src/capc.cpp.o"
+  "CMakeFiles/capc.dir/src/capc.cpp.o.d"
+  "capc"
+  "capc.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/capc.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
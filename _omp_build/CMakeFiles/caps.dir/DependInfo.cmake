@@ -0,0 +1,32 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/bessel.c" "CMakeFiles/caps.dir/src/bessel.c.o" "gcc" "CMakeFiles/caps.dir/src/bessel.c.o.d"
+  "/root/repo/src/cache.c" "CMakeFiles/caps.dir/src/cache.c.o" "gcc" "CMakeFiles/caps.dir/src/cache.c.o.d"
+  "/root/repo/src/fcqs.c" "CMakeFiles/caps.dir/src/fcqs.c.o" "gcc" "CMakeFiles/caps.dir/src/fcqs.c.o.d"
+  "/root/repo/src/integration.c" "CMakeFiles/caps.dir/src/integration.c.o" "gcc" "CMakeFiles/caps.dir/src/integration.c.o.d"
+  "/root/repo/src/libcaps.c" "CMakeFiles/caps.dir/src/libcaps.c.o" "gcc" "CMakeFiles/caps.dir/src/libcaps.c.o.d"
+  "/root/repo/src/logfac.c" "CMakeFiles/caps.dir/src/logfac.c.o" "gcc" "CMakeFiles/caps.dir/src/logfac.c.o.d"
+  "/root/repo/src/material.c" "CMakeFiles/caps.dir/src/material.c.o" "gcc" "CMakeFiles/caps.dir/src/material.c.o.d"
+  "/root/repo/src/matrix.c" "CMakeFiles/caps.dir/src/matrix.c.o" "gcc" "CMakeFiles/caps.dir/src/matrix.c.o.d"
+  "/root/repo/src/misc.c" "CMakeFiles/caps.dir/src/misc.c.o" "gcc" "CMakeFiles/caps.dir/src/misc.c.o.d"
+  "/root/repo/src/plm.c" "CMakeFiles/caps.dir/src/plm.c.o" "gcc" "CMakeFiles/caps.dir/src/plm.c.o.d"
+  "/root/repo/src/psd.c" "CMakeFiles/caps.dir/src/psd.c.o" "gcc" "CMakeFiles/caps.dir/src/psd.c.o.d"
+  "/root/repo/src/utils.c" "CMakeFiles/caps.dir/src/utils.c.o" "gcc" "CMakeFiles/caps.dir/src/utils.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_omp_build/CMakeFiles/cquadpack.dir/DependInfo.cmake"
+  "/root/repo/_omp_build/CMakeFiles/hodlr.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,33 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/caps.dir/src/bessel.c.o"
+  "CMakeFiles/caps.dir/src/bessel.c.o.d"
+  "CMakeFiles/caps.dir/src/cache.c.o"
+  "CMakeFiles/caps.dir/src/cache.c.o.d"
+  "CMakeFiles/caps.dir/src/fcqs.c.o"
+  "CMakeFiles/caps.dir/src/fcqs.c.o.d"
+  "CMakeFiles/caps.dir/src/integration.c.o"
+  "CMakeFiles/caps.dir/src/integration.c.o.d"
+  "CMakeFiles/caps.dir/src/libcaps.c.o"
+  "CMakeFiles/caps.dir/src/libcaps.c.o.d"
+  "CMakeFiles/caps.dir/src/logfac.c.o"
+  "CMakeFiles/caps.dir/src/logfac.c.o.d"
+  "CMakeFiles/caps.dir/src/material.c.o"
+  "CMakeFiles/caps.dir/src/material.c.o.d"
+  "CMakeFiles/caps.dir/src/matrix.c.o"
+  "CMakeFiles/caps.dir/src/matrix.c.o.d"
+  "CMakeFiles/caps.dir/src/misc.c.o"
+  "CMakeFiles/caps.dir/src/misc.c.o.d"
+  "CMakeFiles/caps.dir/src/plm.c.o"
+  "CMakeFiles/caps.dir/src/plm.c.o.d"
+  "CMakeFiles/caps.dir/src/psd.c.o"
+  "CMakeFiles/caps.dir/src/psd.c.o.d"
+  "CMakeFiles/caps.dir/src/utils.c.o"
+  "CMakeFiles/caps.dir/src/utils.c.o.d"
+  "libcaps.a"
+  "libcaps.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/caps.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/caps_frontend.dir/src/caps.c.o"
+  "CMakeFiles/caps_frontend.dir/src/caps.c.o.d"
+  "CMakeFiles/caps_frontend.dir/src/caps_mpi.c.o"
+  "CMakeFiles/caps_frontend.dir/src/caps_mpi.c.o.d"
+  "caps"
+  "caps.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/caps_frontend.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
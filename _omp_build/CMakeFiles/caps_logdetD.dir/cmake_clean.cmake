@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/caps_logdetD.dir/src/caps_logdetD.c.o"
+  "CMakeFiles/caps_logdetD.dir/src/caps_logdetD.c.o.d"
+  "caps_logdetD"
+  "caps_logdetD.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/caps_logdetD.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,24 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/caps_mpi.c" "CMakeFiles/cass.dir/src/caps_mpi.c.o" "gcc" "CMakeFiles/cass.dir/src/caps_mpi.c.o.d"
+  "/root/repo/src/cass.c" "CMakeFiles/cass.dir/src/cass.c.o" "gcc" "CMakeFiles/cass.dir/src/cass.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_omp_build/CMakeFiles/caps.dir/DependInfo.cmake"
+  "/root/repo/_omp_build/CMakeFiles/argparse.dir/DependInfo.cmake"
+  "/root/repo/_omp_build/CMakeFiles/cquadpack.dir/DependInfo.cmake"
+  "/root/repo/_omp_build/CMakeFiles/hodlr.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
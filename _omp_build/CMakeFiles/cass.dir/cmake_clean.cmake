@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/cass.dir/src/caps_mpi.c.o"
+  "CMakeFiles/cass.dir/src/caps_mpi.c.o.d"
+  "CMakeFiles/cass.dir/src/cass.c.o"
+  "CMakeFiles/cass.dir/src/cass.c.o.d"
+  "cass"
+  "cass.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/cass.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
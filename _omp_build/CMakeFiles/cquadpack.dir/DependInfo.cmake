@@ -0,0 +1,30 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/cquadpack/src/dqage.c" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqage.c.o" "gcc" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqage.c.o.d"
+  "/root/repo/src/cquadpack/src/dqagi.c" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqagi.c.o" "gcc" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqagi.c.o.d"
+  "/root/repo/src/cquadpack/src/dqags.c" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqags.c.o" "gcc" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqags.c.o.d"
+  "/root/repo/src/cquadpack/src/dqext.c" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqext.c.o" "gcc" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqext.c.o.d"
+  "/root/repo/src/cquadpack/src/dqk15.c" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk15.c.o" "gcc" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk15.c.o.d"
+  "/root/repo/src/cquadpack/src/dqk15i.c" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk15i.c.o" "gcc" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk15i.c.o.d"
+  "/root/repo/src/cquadpack/src/dqk21.c" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk21.c.o" "gcc" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk21.c.o.d"
+  "/root/repo/src/cquadpack/src/dqk31.c" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk31.c.o" "gcc" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk31.c.o.d"
+  "/root/repo/src/cquadpack/src/dqk41.c" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk41.c.o" "gcc" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk41.c.o.d"
+  "/root/repo/src/cquadpack/src/dqk51.c" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk51.c.o" "gcc" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk51.c.o.d"
+  "/root/repo/src/cquadpack/src/dqk61.c" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk61.c.o" "gcc" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk61.c.o.d"
+  "/root/repo/src/cquadpack/src/dqsort.c" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqsort.c.o" "gcc" "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqsort.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
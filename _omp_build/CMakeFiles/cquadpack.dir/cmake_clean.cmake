@@ -0,0 +1,33 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqage.c.o"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqage.c.o.d"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqagi.c.o"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqagi.c.o.d"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqags.c.o"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqags.c.o.d"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqext.c.o"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqext.c.o.d"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk15.c.o"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk15.c.o.d"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk15i.c.o"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk15i.c.o.d"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk21.c.o"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk21.c.o.d"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk31.c.o"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk31.c.o.d"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk41.c.o"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk41.c.o.d"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk51.c.o"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk51.c.o.d"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk61.c.o"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqk61.c.o.d"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqsort.c.o"
+  "CMakeFiles/cquadpack.dir/src/cquadpack/src/dqsort.c.o.d"
+  "libcquadpack.a"
+  "libcquadpack.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/cquadpack.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
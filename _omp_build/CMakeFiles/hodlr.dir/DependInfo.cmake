@@ -0,0 +1,25 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/libhodlr/src/HODLR_Matrix.cpp" "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Matrix.cpp.o" "gcc" "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Matrix.cpp.o.d"
+  "/root/repo/src/libhodlr/src/HODLR_Node.cpp" "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Node.cpp.o" "gcc" "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Node.cpp.o.d"
+  "/root/repo/src/libhodlr/src/HODLR_Tree.cpp" "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Tree.cpp.o" "gcc" "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Tree.cpp.o.d"
+  "/root/repo/src/libhodlr/src/HODLR_Tree_NonSPD.cpp" "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Tree_NonSPD.cpp.o" "gcc" "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Tree_NonSPD.cpp.o.d"
+  "/root/repo/src/libhodlr/src/HODLR_Tree_SPD.cpp" "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Tree_SPD.cpp.o" "gcc" "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Tree_SPD.cpp.o.d"
+  "/root/repo/src/libhodlr/src/KDTree.cpp" "CMakeFiles/hodlr.dir/src/libhodlr/src/KDTree.cpp.o" "gcc" "CMakeFiles/hodlr.dir/src/libhodlr/src/KDTree.cpp.o.d"
+  "/root/repo/src/libhodlr/src/hodlr.cpp" "CMakeFiles/hodlr.dir/src/libhodlr/src/hodlr.cpp.o" "gcc" "CMakeFiles/hodlr.dir/src/libhodlr/src/hodlr.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,23 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Matrix.cpp.o"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Matrix.cpp.o.d"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Node.cpp.o"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Node.cpp.o.d"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Tree.cpp.o"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Tree.cpp.o.d"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Tree_NonSPD.cpp.o"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Tree_NonSPD.cpp.o.d"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Tree_SPD.cpp.o"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/HODLR_Tree_SPD.cpp.o.d"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/KDTree.cpp.o"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/KDTree.cpp.o.d"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/hodlr.cpp.o"
+  "CMakeFiles/hodlr.dir/src/libhodlr/src/hodlr.cpp.o.d"
+  "libhodlr.a"
+  "libhodlr.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/hodlr.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,32 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/tests/test_bessels.c" "CMakeFiles/tests.dir/src/tests/test_bessels.c.o" "gcc" "CMakeFiles/tests.dir/src/tests/test_bessels.c.o.d"
+  "/root/repo/src/tests/test_fresnel.c" "CMakeFiles/tests.dir/src/tests/test_fresnel.c.o" "gcc" "CMakeFiles/tests.dir/src/tests/test_fresnel.c.o.d"
+  "/root/repo/src/tests/test_lfac.c" "CMakeFiles/tests.dir/src/tests/test_lfac.c.o" "gcc" "CMakeFiles/tests.dir/src/tests/test_lfac.c.o.d"
+  "/root/repo/src/tests/test_lnLambda.c" "CMakeFiles/tests.dir/src/tests/test_lnLambda.c.o" "gcc" "CMakeFiles/tests.dir/src/tests/test_lnLambda.c.o.d"
+  "/root/repo/src/tests/test_lnPlm.c" "CMakeFiles/tests.dir/src/tests/test_lnPlm.c.o" "gcc" "CMakeFiles/tests.dir/src/tests/test_lnPlm.c.o.d"
+  "/root/repo/src/tests/test_logdetD.c" "CMakeFiles/tests.dir/src/tests/test_logdetD.c.o" "gcc" "CMakeFiles/tests.dir/src/tests/test_logdetD.c.o.d"
+  "/root/repo/src/tests/test_logi.c" "CMakeFiles/tests.dir/src/tests/test_logi.c.o" "gcc" "CMakeFiles/tests.dir/src/tests/test_logi.c.o.d"
+  "/root/repo/src/tests/test_mie.c" "CMakeFiles/tests.dir/src/tests/test_mie.c.o" "gcc" "CMakeFiles/tests.dir/src/tests/test_mie.c.o.d"
+  "/root/repo/src/tests/test_mie_drude.c" "CMakeFiles/tests.dir/src/tests/test_mie_drude.c.o" "gcc" "CMakeFiles/tests.dir/src/tests/test_mie_drude.c.o.d"
+  "/root/repo/src/tests/tests.c" "CMakeFiles/tests.dir/src/tests/tests.c.o" "gcc" "CMakeFiles/tests.dir/src/tests/tests.c.o.d"
+  "/root/repo/src/tests/unittest.c" "CMakeFiles/tests.dir/src/tests/unittest.c.o" "gcc" "CMakeFiles/tests.dir/src/tests/unittest.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_omp_build/CMakeFiles/caps.dir/DependInfo.cmake"
+  "/root/repo/_omp_build/CMakeFiles/cquadpack.dir/DependInfo.cmake"
+  "/root/repo/_omp_build/CMakeFiles/hodlr.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,31 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/tests.dir/src/tests/test_bessels.c.o"
+  "CMakeFiles/tests.dir/src/tests/test_bessels.c.o.d"
+  "CMakeFiles/tests.dir/src/tests/test_fresnel.c.o"
+  "CMakeFiles/tests.dir/src/tests/test_fresnel.c.o.d"
+  "CMakeFiles/tests.dir/src/tests/test_lfac.c.o"
+  "CMakeFiles/tests.dir/src/tests/test_lfac.c.o.d"
+  "CMakeFiles/tests.dir/src/tests/test_lnLambda.c.o"
+  "CMakeFiles/tests.dir/src/tests/test_lnLambda.c.o.d"
+  "CMakeFiles/tests.dir/src/tests/test_lnPlm.c.o"
+  "CMakeFiles/tests.dir/src/tests/test_lnPlm.c.o.d"
+  "CMakeFiles/tests.dir/src/tests/test_logdetD.c.o"
+  "CMakeFiles/tests.dir/src/tests/test_logdetD.c.o.d"
+  "CMakeFiles/tests.dir/src/tests/test_logi.c.o"
+  "CMakeFiles/tests.dir/src/tests/test_logi.c.o.d"
+  "CMakeFiles/tests.dir/src/tests/test_mie.c.o"
+  "CMakeFiles/tests.dir/src/tests/test_mie.c.o.d"
+  "CMakeFiles/tests.dir/src/tests/test_mie_drude.c.o"
+  "CMakeFiles/tests.dir/src/tests/test_mie_drude.c.o.d"
+  "CMakeFiles/tests.dir/src/tests/tests.c.o"
+  "CMakeFiles/tests.dir/src/tests/tests.c.o.d"
+  "CMakeFiles/tests.dir/src/tests/unittest.c.o"
+  "CMakeFiles/tests.dir/src/tests/unittest.c.o.d"
+  "caps_tests"
+  "caps_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -614,6 +614,72 @@ double bessel_logIn(int n, double x)
     return bessel_logI0(x)-log(I);
 }
 
+/** @brief Logarithm of modified Bessel functions \f$K_n(x)\f$ for \f$n=0,\dots,n_\mathrm{max}\f$
+ *
+ * The Bessel functions are computed in a single sweep of the recurrence
+ * relation
+ * \f[
+ * K_{j+1}(x) = K_{j-1}(x) + \frac{2j}{x} K_j(x)
+ * \f]
+ * in upwards direction starting from \ref bessel_logK0 and \ref
+ * bessel_logK1. This is considerably faster than calling \ref bessel_logKn
+ * for every order.
+ *
+ * @param [in]  nmax  maximum order
+ * @param [in]  x     argument
+ * @param [out] logKn \f$\log K_n(x)\f$ for \f$n=0,\dots,n_\mathrm{max}\f$
+ */
+void bessel_logKn_array(int nmax, double x, double logKn[])
+{
+    logKn[0] = bessel_logK0(x);
+    if(nmax < 1)
+        return;
+
+    logKn[1] = bessel_logK1(x);
+    for(int j = 1; j < nmax; j++)
+    {
+        /* K_{j+1} = K_{j-1} + 2j/x K_j = 2j/x * K_j * (1+x/2j*K_{j-1}/K_j) */
+        const double k = 0.5*x/j;
+        logKn[j+1] = -log(k)+logKn[j]+log1p(exp(logKn[j-1]-logKn[j])*k);
+    }
+}
+
+/** @brief Logarithm of modified Bessel functions \f$I_n(x)\f$ for \f$n=0,\dots,n_\mathrm{max}\f$
+ *
+ * The ratios \f$r_n = I_{n-1}(x)/I_n(x)\f$ are computed in a single sweep of
+ * the recurrence relation
+ * \f[
+ * r_{n-1} = \frac{1}{r_n} + \frac{2(n-1)}{x}
+ * \f]
+ * in downwards direction starting from \f$r_{n_\mathrm{max}}\f$ (see \ref
+ * bessel_ratioI). The Bessel functions are normalized using \ref
+ * bessel_logI0 (Miller's algorithm). This is considerably faster than calling
+ * \ref bessel_logIn for every order.
+ *
+ * @param [in]  nmax  maximum order
+ * @param [in]  x     argument, \f$x>0\f$
+ * @param [out] logIn \f$\log I_n(x)\f$ for \f$n=0,\dots,n_\mathrm{max}\f$
+ */
+void bessel_logIn_array(int nmax, double x, double logIn[])
+{
+    logIn[0] = bessel_logI0(x);
+    if(nmax < 1)
+        return;
+
+    /* store log(r_n) in logIn[n] */
+    double r = bessel_ratioI(nmax-1, x); /* I_{nmax-1}/I_nmax */
+    logIn[nmax] = log(r);
+    for(int n = nmax; n > 1; n--)
+    {
+        r = 1/r + 2*(n-1)/x;
+        logIn[n-1] = log(r);
+    }
+
+    /* log I_n = log I_{n-1} - log r_n */
+    for(int n = 1; n <= nmax; n++)
+        logIn[n] = logIn[n-1]-logIn[n];
+}
+
 /*@}*/
 
 /**
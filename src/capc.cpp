@@ -1,5 +1,7 @@
 #include <algorithm>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <stdio.h>
 #include <strings.h>
@@ -13,29 +15,36 @@
 #include "cquadpack/include/cquadpack.h"
 
 static double __kernel(int i, int j, void *args_);
-static double __integrand_dirichlet(double x, void *args);
-static double __integrand_neumann(double x, void *args);
+static void __integrand_dirichlet(int n, const double x[], double fx[], void *args);
+static void __integrand_neumann(int n, const double x[], double fx[], void *args);
 
 class CasimirCP {
     double R, d;
-    int lmax;
+    int lmax, threads;
     detalg_t detalg;
 
+    // buffers for the Bessel functions; one buffer for every node of a
+    // batch of the integration, reused for all batches
+    std::vector<std::vector<double>> buffers;
+
     public:
         // constructor
-        CasimirCP(double R, double d, detalg_t detalg=DETALG_HODLR) {
+        CasimirCP(double R, double d, detalg_t detalg=DETALG_AUTO) {
             this->R = R;
             this->d = d;
             this->lmax = std::max(25, (int)(5*R/d));
+            this->threads = 1;
             this->detalg = detalg;
         }
 
         double get_R() const { return R; }
         double get_d() const { return d; }
         int get_lmax() const { return lmax; }
+        int get_threads() const { return threads; }
         detalg_t get_detalg() const { return detalg; }
 
         void set_lmax(int lmax) { this->lmax = lmax; }
+        void set_threads(int threads) { this->threads = std::max(1, threads); }
         void set_detalg(detalg_t detalg) { this->detalg = detalg; }
 
         double logdet_dirichlet(double q) {
@@ -47,6 +56,13 @@ class CasimirCP {
         }
 
         double logdet(double q, char DN) {
+            std::vector<double> buffer;
+            return this->logdet(q, DN, buffer, false);
+        }
+
+        // If concurrent is true, the two determinants are computed in
+        // parallel. The Bessel functions are stored in buffer.
+        double logdet(double q, char DN, std::vector<double> &buffer, bool concurrent) {
             const int dim = lmax;
             kernel_args_t args;
 
@@ -54,72 +70,105 @@ class CasimirCP {
             if(DN != 'D')
                 DN = 'N';
 
-            // initialize caches
+            // initialize caches: K_n(2*calL*q) for n=0..2*lmax+1, and
+            // I_n(Rq), K_n(Rq) for n=0..lmax+1; every sequence is computed
+            // by a single sweep of the recurrence relation
+            buffer.resize(5*(lmax+1)+2);
             args.lmax = lmax;
             args.DN = DN;
-
-            args.cache_ratio = new double[lmax+1];
-            args.cache_K     = new double[2*(lmax+1)];
+            args.cache_K     = buffer.data();
+            args.cache_ratio = args.cache_K+2*(lmax+1);
+            double *logI = args.cache_ratio+lmax+1;
+            double *logK = logI+lmax+2;
 
             const double calL = d+R;
-            for(int j = 0; j < 2*(lmax+1); j++)
-                args.cache_K[j] = bessel_logKn(j, 2*calL*q);
+            bessel_logKn_array(2*lmax+1, 2*calL*q, args.cache_K);
+            bessel_logIn_array(lmax+1, R*q, logI);
+            bessel_logKn_array(lmax+1, R*q, logK);
 
             if(DN == 'D')
             {
                 // Dirichlet: I_n(Rq)/K_n(Rq)
                 for(int j = 0; j < lmax+1; j++)
-                    args.cache_ratio[j] = bessel_logIn(j, R*q)-bessel_logKn(j, R*q);
+                    args.cache_ratio[j] = logI[j]-logK[j];
             }
             else
             {
                 // Neumann: I'_n(Rq)/K'_n(Rq)
-                double I[3] = { bessel_logI0(R*q), bessel_logI1(R*q), bessel_logIn(2,R*q) };
-                double K[3] = { bessel_logK0(R*q), bessel_logK1(R*q), bessel_logKn(2,R*q) };
 
                 // I'_0(Rq)/K'_0(Rq) = -I_1(x)/K_1(x)
-                args.cache_ratio[0] = I[1]-K[1];
+                args.cache_ratio[0] = logI[1]-logK[1];
 
                 for(int j = 1; j < lmax+1; j++)
                 {
                     /* denom = -2K'_j(x); K'_j(x) = -1/2*[ K_{j+1}(x) + K_{j-1}(x) ] */
-                    double denom = K[2]+log1p(exp(K[0]-K[2]));
+                    double denom = logK[j+1]+log1p(exp(logK[j-1]-logK[j+1]));
 
                     /* num = 2I'_j(x); I'_j(x) = = 1/2*[ I_{j+1}(x) + I_{j-1}(x) ] = dI */
-                    double num = I[0]+log1p(exp(I[2]-I[0]));
+                    double num = logI[j-1]+log1p(exp(logI[j+1]-logI[j-1]));
 
                     args.cache_ratio[j] = num-denom;
-
-                    I[0] = I[1];
-                    I[1] = I[2];
-                    I[2] = bessel_logIn(j+2,R*q);
-
-                    K[0] = K[1];
-                    K[1] = K[2];
-                    K[2] = bessel_logKn(j+2,R*q);
                 }
             }
-            
+
             // 1- M_00
             double M00 = exp(args.cache_ratio[0]+args.cache_K[0]);
             double log_rho = log1p(-M00);
             args.alpha = 2/(1-M00);
 
-            // compute first determinant
-            args.type = 0;
-            double logdet1 = kernel_logdet(dim, __kernel, &args, true, detalg);
+            // the determinants differ only in the type of the kernel
+            kernel_args_t args1 = args;
+            args.type  = 0;
+            args1.type = 1;
 
-            // compute second determinant
-            args.type = 1;
-            double logdet2 = kernel_logdet(dim, __kernel, &args, true, detalg);
-
-            // free memory
-            delete [] args.cache_ratio;
-            delete [] args.cache_K;
+            double logdet1, logdet2;
+            if(concurrent)
+            {
+                // compute second determinant in a separate thread
+                std::thread thread([&]() {
+                    logdet2 = kernel_logdet(dim, __kernel, &args1, true, detalg);
+                });
+                logdet1 = kernel_logdet(dim, __kernel, &args, true, detalg);
+                thread.join();
+            }
+            else
+            {
+                logdet1 = kernel_logdet(dim, __kernel, &args,  true, detalg);
+                logdet2 = kernel_logdet(dim, __kernel, &args1, true, detalg);
+            }
 
             return log_rho+logdet1+logdet2;
         }
 
+        // Evaluate the integrand at the n nodes x of a Gauss-Kronrod rule.
+        // The nodes are distributed over min(n, threads) threads. If there
+        // are more threads than nodes, the first threads-n nodes use a spare
+        // thread to compute their two determinants concurrently.
+        void integrand(int n, const double x[], double fx[], char DN)
+        {
+            if((int)buffers.size() < n)
+                buffers.resize(n);
+
+            const int workers = std::min(n, threads);
+            const int spare   = threads-workers;
+
+            auto work = [&](int worker) {
+                for(int i = worker; i < n; i += workers)
+                {
+                    const double q = x[i]/(2*d);
+                    fx[i] = q*this->logdet(q, DN, buffers[i], i < spare);
+                }
+            };
+
+            std::vector<std::thread> pool;
+            for(int worker = 1; worker < workers; worker++)
+                pool.emplace_back(work, worker);
+            work(0);
+
+            for(auto &thread : pool)
+                thread.join();
+        }
+
         double energy(char p, double T, double epsrel=1e-8)
         {
             p = toupper(p);
@@ -131,10 +180,15 @@ class CasimirCP {
                 double integral, abserr;
                 int neval, ier;
 
+                // the cost model of DETALG_AUTO must be initialized before
+                // determinants are computed concurrently
+                if(detalg == DETALG_AUTO)
+                    kernel_logdet_get_model();
+
                 if(p == 'D')
-                    integral = dqagi(__integrand_dirichlet, 0, 1, 0, epsrel, &abserr, &neval, &ier, this);
+                    integral = dqagi_batch(__integrand_dirichlet, 0, 1, 0, epsrel, &abserr, &neval, &ier, this);
                 else
-                    integral = dqagi(__integrand_neumann, 0, 1, 0, epsrel, &abserr, &neval, &ier, this);
+                    integral = dqagi_batch(__integrand_neumann, 0, 1, 0, epsrel, &abserr, &neval, &ier, this);
 
                 /* energy in units of hbar*c*L */
                 return integral/(4*M_PI*2*d);
@@ -167,20 +221,16 @@ static double __kernel(int i, int j, void *args_)
     return U+V+args->alpha*vvT;
 }
 
-static double __integrand_dirichlet(double x, void *args)
+static void __integrand_dirichlet(int n, const double x[], double fx[], void *args)
 {
     CasimirCP *capc = (CasimirCP *)args;
-
-    double q = x/(2*capc->get_d());
-    return q*capc->logdet_dirichlet(q);
+    capc->integrand(n, x, fx, 'D');
 }
 
-static double __integrand_neumann(double x, void *args)
+static void __integrand_neumann(int n, const double x[], double fx[], void *args)
 {
     CasimirCP *capc = (CasimirCP *)args;
-
-    double q = x/(2*capc->get_d());
-    return q*capc->logdet_neumann(q);
+    capc->integrand(n, x, fx, 'N');
 }
 
 int main(int argc, const char *argv[]) {
@@ -188,6 +238,7 @@ int main(int argc, const char *argv[]) {
     double epsrel = 1e-8, eta = 6, R = NAN, d = NAN;
     const char *detalg = NULL;
     int lmax = 0;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
 
     const char *const usage[] = {
         "capc [options] [[--] args]",
@@ -204,7 +255,8 @@ int main(int argc, const char *argv[]) {
         OPT_INTEGER('l', "lmax", &lmax, "dimension of vector space", NULL, 0, 0),
         OPT_DOUBLE('e', "epsrel", &epsrel, "relative error for integration", NULL, 0, 0),
         OPT_DOUBLE('n', "eta", &eta, "set eta", NULL, 0, 0),
-        OPT_STRING('D', "detalg", &detalg, "algorithm to compute determinants (HODLR, LU, QR or CHOLESKY)", NULL, 0, 0),
+        OPT_STRING('D', "detalg", &detalg, "algorithm to compute determinants (AUTO, HODLR, LU, QR or CHOLESKY)", NULL, 0, 0),
+        OPT_INTEGER('t', "threads", &threads, "number of threads (default: number of cores)", NULL, 0, 0),
         OPT_END(),
     };
 
@@ -263,6 +315,12 @@ int main(int argc, const char *argv[]) {
         argparse_usage(&argparse);
         return 1;
     }
+    if(threads <= 0)
+    {
+        fprintf(stderr, "threads must be positive\n\n");
+        argparse_usage(&argparse);
+        return 1;
+    }
 
     /* PFA for Dirichlet/Neumann in units of hbar*c*L, i.e., E_PFA^DN / (hbar*c*L) */
     double E_PFA_DN = -M_PI*M_PI*M_PI/1920*sqrt(R/(2*d))/(d*d);
@@ -270,6 +328,7 @@ int main(int argc, const char *argv[]) {
     double E_PFA = 2*E_PFA_DN;
 
     CasimirCP capc(R, d);
+    capc.set_threads(threads);
 
     // set lmax
     if(lmax > 0)
@@ -283,6 +342,7 @@ int main(int argc, const char *argv[]) {
     printf("# T = %.15g\n", T);
     printf("# lmax = %d\n", capc.get_lmax());
     printf("# epsrel = %g\n", epsrel);
+    printf("# threads = %d\n", threads);
 
     // set detalg
     if(detalg != NULL)
@@ -302,8 +362,13 @@ int main(int argc, const char *argv[]) {
             printf("# detalg = CHOLESKY\n");
             capc.set_detalg(DETALG_CHOLESKY);
         }
-        else
+        else if(strcasecmp(detalg, "HODLR") == 0)
+        {
             printf("# detalg = HODLR\n");
+            capc.set_detalg(DETALG_HODLR);
+        }
+        else
+            printf("# detalg = AUTO\n");
     }
 
     /* energy Dirichlet in units of hbar*c*L */
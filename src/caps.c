@@ -25,374 +25,1218 @@
 #define LDIM_MIN 20 /**< minimum value for --ldim */
 #define ETA 7.      /**< default value for --eta */
 #define IDLE 25     /**< idle time in ms */
+#define XI_SKIP_MIN 1e-100 /**< frequencies with |logdetD| below this estimate are always skipped */
+#define XI_SKIP_RBYL_MIN 0.05 /**< smallest aspect ratio R/L for which frequencies are skipped */
+#define XI_SKIP_RBYL_MAX 200  /**< largest aspect ratio R/L for which frequencies are skipped */
+#define IEPSREL_MAX 1e-4 /**< loosest accuracy of the integrals chosen by --accuracy */
+
+/* shares of the error budget, see --accuracy */
+#define CUTOFF_RATIO 100 /**< minimal ratio epsrel/cutoff for a smooth integrand */
+#define BUDGET_XI    0.7 /**< integration/summation over ξ (--epsrel) */
+#define BUDGET_M     (BUDGET_XI/CUTOFF_RATIO) /**< sums over m (--cutoff) */
+#define BUDGET_INT   0.2 /**< integrals of the matrix elements (--iepsrel) */
+#define BUDGET_HODLR (1-BUDGET_XI-BUDGET_M-BUDGET_INT) /**< compression of HODLR */
+
+/* PFA estimate of |logdetD(ξ)| (sum over m≥0, m=0 with half weight) for the
+ * separation L, used to skip frequencies that do not contribute; xi_ =
+ * ξ(L+R)/c. For large ξ the round trip is dominated by the region of closest
+ * approach. In the PFA the sum over m for perfect reflectors is
+ *      R/(4L) Li_3(exp(-2ξL/c)) ≤ ζ(3) R/(4L) exp(-2ξL/c),
+ * and smaller for other materials as |r_p| ≤ 1. The estimate is twice the
+ * right hand side. It is not a rigorous bound: it has been compared with
+ * exact sums over m for perfect reflectors and Drude metals (gold) for
+ * XI_SKIP_RBYL_MIN ≤ R/L ≤ XI_SKIP_RBYL_MAX and 0.5 ≤ ξL/c ≤ 20, where the
+ * exact values are at most 0.44 times the estimate; they approach half of it
+ * for large R/L. Outside of this range of aspect ratios the estimate is
+ * INFINITY, i.e., no frequency is skipped.
+ *
+ * For the derivatives (L+R)^k ∂_L^k (see caps_mpi_t.derivative) every
+ * derivative of the PFA gives a factor of at most 1.5*((L+R)/L+2ξ(L+R)/c),
+ * where 1.5 > ζ(2)/ζ(3) accounts for Li_2/Li_3; the exact values for k=1,2
+ * are at most 0.30 times the estimate where checked (R/L ≤ 100). */
+static double _logdetD_estimate(caps_mpi_t *caps_mpi, double L, double xi_)
+{
+    const double R = caps_mpi->R;
+    const double zeta3 = 1.2020569031595942;
 
-#define STATE_RUNNING 1
-#define STATE_IDLE    0
+    if(R/L < XI_SKIP_RBYL_MIN || R/L > XI_SKIP_RBYL_MAX)
+        return INFINITY;
 
-/* @brief Create caps_mpi object
- *
- * @param [in] L separation between sphere and plate in meter
- * @param [in] R radius of sphere in meter
- * @param [in] T temperature in Kelvin
- * @param [in] filename filename of material description or NULL
- * @param [in] resume filename of partial output to be resumed
- * @param [in] omegap plasma frequency of the Drude model in eV
- * @param [in] gamma_ relaxation frequency of the Drude model eV
- * @param [in] ldim dimension of vector space
- * @param [in] cutoff cutoff for summation over m
- * @param [in] iepsrel relative accuracy for integration of k for matrix elements
- * @param [in] cores number of cores to use
- * @param [in] verbose flag if verbose
- * @retval object caps_mpi_t object
- */
-caps_mpi_t *caps_mpi_init(double L, double R, double T, char *filename, char *resume, double omegap, double gamma_, int ldim, double cutoff, double iepsrel, int cores, bool verbose)
+    double estimate = 2*zeta3*R/(4*L)*exp(-2*xi_*L/(L+R));
+
+    for(int k = 0; k < caps_mpi->derivative; k++)
+        estimate *= 1.5*((L+R)/L+2*xi_);
+
+    return estimate;
+}
+
+/* Largest modulus of logdetD computed so far for the separation L and the
+ * current quantity (see caps_mpi_t.derivative); used as the scale of the
+ * frequencies that are skipped, see _F_xi_batch. */
+static double *_logdetD_scale(caps_mpi_t *caps_mpi, double L)
 {
-    caps_mpi_t *self = xmalloc(sizeof(caps_mpi_t));
-
-    self->L       = L;
-    self->R       = R;
-    self->T       = T;
-    self->omegap  = omegap;
-    self->gamma   = gamma_;
-    self->ldim    = ldim;
-    self->cutoff  = cutoff;
-    self->iepsrel = iepsrel;
-    self->cores   = cores;
-    self->verbose = verbose;
-    self->tasks   = xmalloc(cores*sizeof(caps_task_t *));
-    self->alpha   = 2*L/(L+R); /* used to scale integration if T=0 */
-
-    /* number of determinants we have computed */
-    self->determinants = 0;
-
-    TERMINATE(strlen(filename) > 511, "filename too long: %s", filename);
-    memset(self->filename, '\0', sizeof(self->filename));
-    strncpy(self->filename, filename, sizeof(self->filename)-sizeof(char));
-
-    /* cache for resume */
-    self->cache_elems = 0;
-    if(resume && strlen(resume) > 0)
-    {
-        char line[512];
-        FILE *fh = fopen(resume, "r");
-        TERMINATE(fh == NULL, "cannot open %s for reading", resume);
-
-        while(fgets(line, sizeof(line)/sizeof(char), fh) != NULL)
-        {
-            char *p1 = strstr(line, "# xi*(L+R)/c=");
-            char *p2 = strstr(line, "logdetD=");
-            if(p1 && p2)
-            {
-                char *p3;
+    const int n = sizeof(caps_mpi->scale)/sizeof(caps_mpi->scale[0]);
 
-                p1 += 13;
-                p3 = strchr(p1, ',');
-                TERMINATE(p3 == NULL, "%s has wrong format", resume);
-                *p3 = '\0';
-                self->cache[self->cache_elems][0] = atof(p1); /* xi */
+    for(int i = 0; i < caps_mpi->scale_elems; i++)
+        if(caps_mpi->scale[i][0] == L && caps_mpi->scale[i][1] == caps_mpi->derivative)
+            return &caps_mpi->scale[i][2];
 
-                p2 += 8;
-                p3 = strchr(p2, ',');
-                TERMINATE(p3 == NULL, "%s has wrong format", resume);
-                *p3 = '\0';
-                self->cache[self->cache_elems][1] = atof(p2); /* logdetD */
+    /* replace the oldest entry if the table is full */
+    const int i = caps_mpi->scale_elems < n ? caps_mpi->scale_elems++ : caps_mpi->scale_next++ % n;
+    caps_mpi->scale[i][0] = L;
+    caps_mpi->scale[i][1] = caps_mpi->derivative;
+    caps_mpi->scale[i][2] = 0;
 
-                self->cache_elems++;
-            }
-        }
+    return &caps_mpi->scale[i][2];
+}
 
-        fclose(fh);
-    }
+/* name of the quantity that is summed over m, see caps_mpi_t.derivative */
+static const char *_label(caps_mpi_t *caps_mpi)
+{
+    const char *labels[] = { "logdetD", "(L+R)*dlogdetD/dL", "(L+R)^2*d2logdetD/dL2" };
+    return labels[caps_mpi->derivative];
+}
 
-    self->tasks[0] = NULL;
-    for(int i = 1; i < cores; i++)
+/* look up logdetD for xi_ in the cache of a resumed computation; returns
+ * true if found */
+static bool _cache_lookup(caps_mpi_t *caps_mpi, double xi_, double *logdetD)
+{
+    for(int j = 0; j < caps_mpi->cache_elems; j++)
     {
-        caps_task_t *task = xmalloc(sizeof(caps_task_t));
-        task->index    = -1;
-        task->state    = STATE_IDLE;
-        self->tasks[i] = task;
+        const double xi_cache = caps_mpi->cache[j][0];
+
+        if(xi_ == xi_cache || fabs(1-xi_cache/xi_) < 1e-11)
+        {
+            *logdetD = caps_mpi->cache[j][1];
+            return true;
+        }
     }
 
-    return self;
+    return false;
 }
 
-/* stop all remaining slaves */
-static void _mpi_stop(int cores)
+/* state of the sum over m for a Matsubara frequency, see F_xi_batch */
+typedef struct {
+    double terms[4096]; /* NAN if not known yet */
+    double terms0[2];
+    double *terms2;     /* terms of logdetD2 (see --sphere-sphere) or NULL */
+    double terms2_0[2];
+    double partial;     /* sum of the known terms (m=0 with half weight) */
+    double t_max, t_last; /* largest and most recent known term */
+    double err_int;     /* predicted error of the terms due to the integrals */
+    int m, block; /* next task to submit */
+    int running;  /* number of running tasks */
+    bool done;    /* cutoff has been reached, no further tasks are submitted */
+} sum_m_t;
+
+/* Geometric model of the tail of the sum over m: if the terms m-2, m-1 and m
+ * are known and decrease, the remainder Σ_{m'>m} t_m' is estimated by
+ * t_m q/(1-q) with the last ratio q=t_m/t_{m-1}. If bound is not NULL, the
+ * larger of the ratios t_m/t_{m-1} and t_{m-1}/t_{m-2} is used to compute a
+ * conservative bound of the remainder. Returns NAN if no estimate is
+ * possible. */
+static double _tail_m(const double terms[], int m, double *bound)
 {
-    double buf[] = { -1, -1, -1, -1, -1, -1, -1 };
+    /* the term m=0 has a different weight */
+    if(m < 3)
+        return NAN;
+
+    const double t0 = terms[m-2], t1 = terms[m-1], t2 = terms[m];
+    if(isnan(t0) || isnan(t1) || isnan(t2))
+        return NAN;
+
+    const double q = t2/t1, q_max = fmax(q, t1/t0);
+    if(!(q > 0 && q_max < 1))
+        return NAN;
+
+    if(bound != NULL)
+        *bound = t2*q_max/(1-q_max);
 
-    for(int i = 1; i < cores; i++)
-        MPI_Send(buf, 7, MPI_DOUBLE, i, 0, MPI_COMM_WORLD);
+    return t2*q/(1-q);
 }
 
-/** @brief Free mpi object
- *
- * Stop all running jobs and free allocated memory.
- *
- * @param [in] self caps_mpit_t object
- */
-void caps_mpi_free(caps_mpi_t *self)
+/* Accuracy of the integrals for the next task of the sum over m. Without
+ * error budget (see --accuracy) this is caps_mpi->iepsrel. Otherwise the
+ * budget caps_mpi->iepsrel is loosened for terms that contribute little:
+ * the term t_m gets the accuracy iepsrel*sqrt(t_max/t_m), where t_max is the
+ * largest term and t_m is estimated by the most recent term. For a geometric
+ * decay t_m ~ t_max q^m the errors sum to iepsrel*t_max/(1-√q) ≤
+ * 2*iepsrel*Σt_m independently of the number of terms. */
+static double _iepsrel_task(caps_mpi_t *caps_mpi, sum_m_t *sum)
 {
-    _mpi_stop(self->cores);
+    const double iepsrel = caps_mpi->iepsrel;
 
-    for(int i = 1; i < self->cores; i++)
-        xfree(self->tasks[i]);
+    if(caps_mpi->accuracy <= 0 || !(sum->t_last != 0))
+        return iepsrel;
 
-    xfree(self->tasks);
-    xfree(self);
+    return fmin(IEPSREL_MAX, iepsrel*sqrt(fabs(sum->t_max/sum->t_last)));
 }
 
-
-/** @brief Get number of running jobs
+/* Compute logdetD (sum over m) for the n Matsubara frequencies xi_[] =
+ * ξ(L+R)/c concurrently. The tasks (ξ,m) of all frequencies are submitted to
+ * the workers; the task with the smallest m is submitted first. For every
+ * frequency no further tasks are submitted once the bound of the remainder
+ * of the sum over m given by _tail_m is smaller than cutoff relative to the sum of
+ * the known terms (if no estimate is available yet: once a term is smaller
+ * than cutoff relative to the term m=0), but all running tasks are
+ * collected. The estimated remainder is added to the sum. If t is not NULL, the time needed
+ * until the result for xi_[k] was available is stored in t[k].
  *
- * @param [in] self caps_mpit_t object
- * @retval running number of processes that are running
- */
-int caps_mpi_get_running(caps_mpi_t *self)
+ * Frequencies are skipped (logdetD=0, t=0) if the PFA estimate
+ * _logdetD_estimate is smaller than cutoff times the largest |logdetD|
+ * computed so far for the same separation, or smaller than XI_SKIP_MIN.
+ *
+ * If L and ldim are not NULL, frequency k belongs to the separation L[k] with
+ * dimension ldim[k] (xi_[k] = ξ(L[k]+R)/c), and the cache of a resumed
+ * computation is not used.
+ *
+ * If logdetD2 is not NULL, every task computes a second quantity whose sum
+ * over m is stored in logdetD2:
+ *  - caps_mpi->sphere_sphere: log det(1-M²) for two spheres at separation
+ *    d=2L from the same matrix elements as logdetD. As |log(1-λ²)| ≤
+ *    |log(1-λ)| for 0≤λ<1, its terms are bounded by the terms of logdetD.
+ *  - caps_mpi->ht_pr (only ξ=0): logdetD is the MM block for perfect
+ *    reflectors, logdetD2 the MM block for the plasma model with
+ *    caps_mpi->omegap. As |r_TE| < 1 for the plasma model, the terms of
+ *    logdetD2 are smaller than the terms of logdetD.
+ * In both cases the criteria to stop the sum over m and to skip frequencies
+ * are based on logdetD alone. */
+static void _F_xi_batch(caps_mpi_t *caps_mpi, int n, const double L[], const int ldim[], const double xi_[], double logdetD[], double t[], double logdetD2[])
 {
-    int running = 0;
+    const double t0 = now();
+    const int mmax = sizeof(((sum_m_t *)NULL)->terms)/sizeof(double);
+    const bool verbose = caps_mpi->verbose;
+    const double cutoff = caps_mpi->cutoff;
+    int remaining = 0; /* number of frequencies that are not finished yet */
 
-    for(int i = 1; i < self->cores; i++)
-        if(self->tasks[i]->state == STATE_RUNNING)
-            running++;
+    if(n <= 0)
+        return;
 
-    return running;
-}
+    sum_m_t *sums = xmalloc(n*sizeof(sum_m_t));
+    for(int k = 0; k < n; k++)
+    {
+        sum_m_t *sum = &sums[k];
+
+        for(int m = 0; m < mmax; m++)
+            sum->terms[m] = NAN;
+        sum->terms0[0] = sum->terms0[1] = NAN;
+        sum->partial = 0;
+        sum->t_max = sum->t_last = sum->err_int = 0;
+        sum->m = sum->block = sum->running = 0;
+        sum->done = false;
+        sum->terms2 = NULL;
+        if(logdetD2 != NULL)
+        {
+            sum->terms2 = xmalloc(mmax*sizeof(double));
+            for(int m = 0; m < mmax; m++)
+                sum->terms2[m] = NAN;
+            sum->terms2_0[0] = sum->terms2_0[1] = NAN;
+            logdetD2[k] = 0;
+        }
 
-/* xi_ = ξ(L+R)/c */
-int caps_mpi_submit(caps_mpi_t *self, int index, double xi_, int m)
-{
-    for(int i = 1; i < self->cores; i++)
+        /* look in cache if resumed */
+        const double L_k = (L == NULL) ? caps_mpi->L : L[k];
+        double *scale = _logdetD_scale(caps_mpi, L_k);
+        if(L == NULL && _cache_lookup(caps_mpi, xi_[k], &logdetD[k]))
+        {
+            sum->done = true;
+            *scale = fmax(*scale, fabs(logdetD[k]));
+            if(t != NULL)
+                t[k] = 0;
+        }
+        else if(xi_[k] > 0 && _logdetD_estimate(caps_mpi, L_k, xi_[k]) < fmax(XI_SKIP_MIN, cutoff*(*scale)))
+        {
+            /* the frequency does not contribute */
+            sum->done = true;
+            logdetD[k] = 0;
+            caps_mpi->skipped++;
+            if(t != NULL)
+                t[k] = 0;
+        }
+        else
+            remaining++;
+    }
+
+    while(remaining > 0)
     {
-        caps_task_t *task = self->tasks[i];
+        caps_task_t *task = NULL;
+        bool retrieved = false;
 
-        if(task->state == STATE_IDLE)
+        /* send jobs; the frequency with the smallest m first */
+        while(1)
         {
-            double buf[] = { xi_, self->L, self->R, self->omegap, self->gamma, m, self->iepsrel, self->ldim };
+            int next = -1;
+            for(int k = 0; k < n; k++)
+                if(!sums[k].done && (next < 0 || sums[k].m < sums[next].m))
+                    next = k;
 
-            task->index = index;
-            task->xi_   = xi_;
-            task->m     = m;
-            task->state = STATE_RUNNING;
+            if(next < 0)
+                break;
 
-            MPI_Send (buf,              8, MPI_DOUBLE, i, 0, MPI_COMM_WORLD);
-            MPI_Send (self->filename, 512, MPI_CHAR,   i, 0, MPI_COMM_WORLD);
-            MPI_Irecv(&task->recv,     1,  MPI_DOUBLE, i, 0, MPI_COMM_WORLD, &task->request);
+            sum_m_t *sum = &sums[next];
+            TERMINATE(sum->m >= mmax, "sum did not converge, sorry. :(");
 
-            return 1;
+            /* for m=0 the polarization blocks EE and MM decouple (except
+             * for xi=0 where only one of the blocks is computed); both
+             * blocks are computed as independent jobs. Derivatives with
+             * respect to L are computed for both blocks by a single job. */
+            const int blocks = (sum->m == 0 && xi_[next] > 0 && caps_mpi->derivative == 0) ? 2 : 1;
+
+            const double L_next = (L == NULL) ? caps_mpi->L : L[next];
+            const int ldim_next = (ldim == NULL) ? caps_mpi->ldim : ldim[next];
+            if(!caps_mpi_submit_L(caps_mpi, next, L_next, ldim_next, _iepsrel_task(caps_mpi, sum), xi_[next], sum->m, blocks == 2 ? sum->block : -1))
+                break;
+
+            sum->running++;
+            if(++sum->block == blocks)
+            {
+                sum->block = 0;
+                sum->m++;
+            }
+        }
+
+        /* retrieve jobs */
+        while(caps_mpi_retrieve(caps_mpi, &task))
+        {
+            sum_m_t *sum = &sums[task->index];
+            const double v = caps_mpi_store_term(sum->terms, sum->terms0, task, task->value);
+
+            if(verbose)
+            {
+                const char *blocks[] = { "EE", "MM" };
+                if(task->block < 0)
+                    fprintf(stderr, "# m=%d, xi_=%.16g, logdetD=%.16g\n", task->m, task->xi_, task->value);
+                else
+                    fprintf(stderr, "# m=%d (%s), xi_=%.16g, logdetD=%.16g\n", task->m, blocks[task->block], task->xi_, task->value);
+            }
+            if(sum->terms2 != NULL)
+                caps_mpi_store_term(sum->terms2, sum->terms2_0, task, task->value2);
+
+            retrieved = true;
+            sum->running--;
+            sum->err_int += task->iepsrel*fabs(task->m == 0 ? task->value/2 : task->value);
+
+            if(!isnan(v))
+            {
+                double bound;
+                const double tail = _tail_m(sum->terms, task->m, &bound);
+
+                sum->partial += (task->m == 0) ? v/2 : v;
+                sum->t_max = fmax(sum->t_max, fabs(v));
+                sum->t_last = v;
+                if(v == 0)
+                    sum->done = true;
+                else if(isnan(tail))
+                    sum->done = sum->done || v/sum->terms[0] < cutoff;
+                else
+                    sum->done = sum->done || fabs(bound) < cutoff*fabs(sum->partial);
+            }
+
+            if(sum->done && sum->running == 0)
+            {
+                /* remainder of the sum estimated from the last terms */
+                double tail = _tail_m(sum->terms, sum->m-1, NULL);
+                if(isnan(tail))
+                    tail = 0;
+
+                sum->terms[0] /= 2; /* m = 0 */
+                logdetD[task->index] = kahan_sum(sum->terms, sum->m)+tail;
+                {
+                    double *scale = _logdetD_scale(caps_mpi, L == NULL ? caps_mpi->L : L[task->index]);
+                    *scale = fmax(*scale, fabs(logdetD[task->index]));
+                }
+                if(logdetD[task->index] != 0)
+                {
+                    caps_mpi->tail_m  = fmax(caps_mpi->tail_m,  fabs(tail/logdetD[task->index]));
+                    caps_mpi->err_int = fmax(caps_mpi->err_int, sum->err_int/fabs(logdetD[task->index]));
+                }
+                if(sum->terms2 != NULL)
+                {
+                    double tail2 = _tail_m(sum->terms2, sum->m-1, NULL);
+                    if(isnan(tail2))
+                        tail2 = 0;
+
+                    sum->terms2[0] /= 2; /* m = 0 */
+                    logdetD2[task->index] = kahan_sum(sum->terms2, sum->m)+tail2;
+                }
+                if(t != NULL)
+                    t[task->index] = now()-t0;
+                remaining--;
+            }
         }
+
+        if(!retrieved)
+            usleep(IDLE);
     }
 
-    return 0;
+    for(int k = 0; k < n; k++)
+        xfree(sums[k].terms2);
+    xfree(sums);
 }
 
-/** @brief Get number of computed determinants
- *
- * Get the number of determinants that have been computed.
- *
- * @param [in] self caps_mpit_t object
- * @retval determinants number of computed determinants
- */
-int caps_get_determinants(caps_mpi_t *self)
+void F_xi_batch(caps_mpi_t *caps_mpi, int n, const double xi_[], double logdetD[], double t[])
 {
-    return self->determinants;
+    _F_xi_batch(caps_mpi, n, NULL, NULL, xi_, logdetD, t, NULL);
 }
 
-int caps_mpi_retrieve(caps_mpi_t *self, caps_task_t **task_out)
+/* x = 2ξL/c; the integrand is evaluated at the n nodes x at once, all
+ * Matsubara frequencies are computed concurrently by F_xi_batch */
+static void integrand(int n, const double x[], double fx[], void *args)
 {
-    *task_out = NULL;
+    caps_mpi_t *caps_mpi = (caps_mpi_t *)args;
+    double *xi_ = xcalloc(n, sizeof(double));
+    double *t   = xcalloc(n, sizeof(double));
+
+    /* frequencies that do not contribute are skipped by F_xi_batch */
+    for(int i = 0; i < n; i++)
+        xi_[i] = x[i]/caps_mpi->alpha; /* xi_=ξ(L+R)/c; α=2*L/(L+R) */
 
-    for(int i = 1; i < self->cores; i++)
+    if(caps_mpi->sphere_sphere)
     {
-        caps_task_t *task = self->tasks[i];
+        /* logdetD2 is recorded for the integration of the sphere-sphere
+         * energy, see integrand_ss */
+        double *logdetD2 = xcalloc(n, sizeof(double));
+        _F_xi_batch(caps_mpi, n, NULL, NULL, xi_, fx, t, logdetD2);
 
-        if(task->state == STATE_RUNNING)
+        for(int i = 0; i < n; i++)
         {
-            int flag = 0;
-            MPI_Status status;
+            buf_push(caps_mpi->ss_xi, xi_[i]);
+            buf_push(caps_mpi->ss_logdetD2, logdetD2[i]);
+            printf("# xi*(L+R)/c=%.16g, %s=%.16g, logdetD2=%.16g, t=%g\n", xi_[i], _label(caps_mpi), fx[i], logdetD2[i], t[i]);
+        }
 
-            MPI_Test(&task->request, &flag, &status);
+        xfree(logdetD2);
+    }
+    else
+    {
+        F_xi_batch(caps_mpi, n, xi_, fx, t);
 
-            if(flag)
-            {
-                MPI_Wait(&task->request, &status);
+        for(int i = 0; i < n; i++)
+            printf("# xi*(L+R)/c=%.16g, %s=%.16g, t=%g\n", xi_[i], _label(caps_mpi), fx[i], t[i]);
+    }
+
+    xfree(xi_);
+    xfree(t);
+}
 
-                task->value = task->recv;
-                task->state = STATE_IDLE;
-                self->determinants += 1;
+/* Integrand of the energy of the sphere-sphere geometry (see --sphere-sphere)
+ * at the nodes x = 2ξL/c = ξd/c: logdetD2 (sum over m≥0, m=0 with half
+ * weight) of log det(1-M²). The values recorded by integrand are reused;
+ * only nodes that have not been visited by the integration of the
+ * plane-sphere energy are computed. */
+static void integrand_ss(int n, const double x[], double fx[], void *args)
+{
+    caps_mpi_t *caps_mpi = (caps_mpi_t *)args;
+    double *xi_ = xcalloc(n, sizeof(double));
+    int *missing = xcalloc(n, sizeof(int));
+    int n_missing = 0;
 
-                *task_out = self->tasks[i];
+    for(int i = 0; i < n; i++)
+    {
+        const double xi_i = x[i]/caps_mpi->alpha;
+        bool found = false;
 
-                return 1;
+        for(size_t j = 0; j < buf_size(caps_mpi->ss_xi) && !found; j++)
+            if(caps_mpi->ss_xi[j] == xi_i || fabs(1-caps_mpi->ss_xi[j]/xi_i) < 1e-11)
+            {
+                fx[i] = caps_mpi->ss_logdetD2[j];
+                found = true;
             }
+
+        if(!found)
+        {
+            xi_[n_missing] = xi_i;
+            missing[n_missing++] = i;
         }
     }
 
-    return 0;
+    if(n_missing > 0)
+    {
+        double *logdetD  = xcalloc(n_missing, sizeof(double));
+        double *logdetD2 = xcalloc(n_missing, sizeof(double));
+        double *t        = xcalloc(n_missing, sizeof(double));
+
+        _F_xi_batch(caps_mpi, n_missing, NULL, NULL, xi_, logdetD, t, logdetD2);
+
+        for(int k = 0; k < n_missing; k++)
+        {
+            buf_push(caps_mpi->ss_xi, xi_[k]);
+            buf_push(caps_mpi->ss_logdetD2, logdetD2[k]);
+            fx[missing[k]] = logdetD2[k];
+            printf("# xi*(L+R)/c=%.16g, logdetD=%.16g, logdetD2=%.16g, t=%g\n", xi_[k], logdetD[k], logdetD2[k], t[k]);
+        }
+
+        xfree(logdetD);
+        xfree(logdetD2);
+        xfree(t);
+    }
+
+    xfree(xi_);
+    xfree(missing);
 }
 
-/* x = 2ξL/c */
-static double integrand(double x, void *args)
+/* xi_ = ξ(L+R)/c */
+double F_xi(double xi_, caps_mpi_t *caps_mpi)
 {
-    double logdetD;
-    const double t0 = now();
-    caps_mpi_t *caps_mpi = (caps_mpi_t *)args;
-    const double xi_ = x/caps_mpi->alpha; /* xi_=ξ(L+R)/c; α=2*L/(L+R) */
-
-    /* For large values of ξ the integrand logdet(Id-M(ξ)) is almost 0, but the
-     * actual computation of the matrix elements might yield warnings and
-     * errors. To save computation time and prevent warnings and errors, we
-     * estimate the integrand using the PFA assuming perfect reflectors. If the
-     * aspect ratio is sufficiently high to use the PFA estimate (we choose
-     * R/L>10), we estimate the value of the Matsubara frequency ξ where
-     *      logdet(Id-M(ξ_cutoff))=logdet_cutoff=1e-100.
-     * If ξ>ξ_cutoff and R/L>10, we return 0.
-     *
-     * Assuming perfect reflectors and that the PFA is valid, one finds
-     *      logdet(Id-M(ξ)) = -1/2 R/L Li_3(exp(-ξL/c)).
-     * As ξ is assumed to be large, the argument of the polylog becomes small,
-     * and we can use Li_3(x)=~x. With this, one finds the estimate above.
-     */
-    const double LbyR = caps_mpi->L/caps_mpi->R;
-    const double logdet_cutoff = 1e-100;
-    const double xi_cutoff = -(1+1/LbyR)*log(2*LbyR*logdet_cutoff)/2;
-
-    if(LbyR < 0.1 && xi_ > xi_cutoff)
-        logdetD = 0;
-    else
-        logdetD = F_xi(xi_, caps_mpi);
+    double drude_HT = NAN, logdetD;
+
+    /* look in cache if resumed */
+    if(_cache_lookup(caps_mpi, xi_, &logdetD))
+        return logdetD;
+
+    if(xi_ == 0)
+    {
+        /* compute Drude contribution */
+        caps_t *caps = caps_init(caps_mpi->R, caps_mpi->L);
+        caps_set_ldim(caps, caps_mpi->ldim);
+        if(caps_mpi->iepsrel > 0)
+            caps_set_epsrel(caps, caps_mpi->iepsrel);
+        drude_HT = caps_ht_drude(caps);
+        caps_free(caps);
+
+        if(!isinf(caps_mpi->omegap) && caps_mpi->gamma > 0)
+            /* omegap finite => Drude model */
+            return drude_HT;
+    }
 
-    printf("# xi*(L+R)/c=%.16g, logdetD=%.16g, t=%g\n", xi_, logdetD, now()-t0);
-    return logdetD;
+    F_xi_batch(caps_mpi, 1, &xi_, &logdetD, NULL);
+
+    if(xi_ == 0)
+        return drude_HT + logdetD;
+    else
+        return logdetD;
 }
 
-/* omegap in eV; drude, pr and plasma in units of kB*T */
+/* Compute the high-temperature limit for the requested models (drude, pr
+ * and plasma may be NULL); omegap in eV; the results are in units of kB*T.
+ *
+ * The EE block is the same for all models and is given by the Drude result
+ * caps_ht_drude; for Drude the MM block vanishes. The MM blocks of perfect
+ * reflectors and of the plasma model are computed by a single sum over m
+ * if both are requested: every task computes both determinants. */
 void F_HT(caps_mpi_t *caps_mpi, double omegap, double *drude, double *pr, double *plasma)
 {
     const double omegap_orig = caps_mpi->omegap;
     const double gamma_orig  = caps_mpi->gamma;
+    const double xi_ = 0;
+    double logdetD0, MM = 0, MM_plasma = 0;
 
-    /* Drude
-     * The actual value of omegap and gamma for the high-temperature limit are
-     * irrelevant. What is relevant is that gamma is positive and non-zero.
-     */
-    if(drude != NULL)
+    /* resumed computation: logdetD at ξ=0 is known for the model */
+    if(_cache_lookup(caps_mpi, 0, &logdetD0))
     {
-        caps_mpi->omegap = 1;
-        caps_mpi->gamma  = 1;
-        *drude = F_xi(0, caps_mpi);
+        if(drude != NULL)
+            *drude = logdetD0;
+        if(pr != NULL)
+            *pr = logdetD0;
+        if(plasma != NULL)
+            *plasma = logdetD0;
+        return;
     }
 
-    /* PR */
-    if(pr != NULL)
+    /* EE block */
+    caps_t *caps = caps_init(caps_mpi->R, caps_mpi->L);
+    caps_set_ldim(caps, caps_mpi->ldim);
+    if(caps_mpi->iepsrel > 0)
+        caps_set_epsrel(caps, caps_mpi->iepsrel);
+    const double drude_HT = caps_ht_drude(caps);
+    caps_free(caps);
+
+    /* MM blocks; the cache has been checked already */
+    caps_mpi->gamma = 0;
+    if(pr != NULL && plasma != NULL)
+    {
+        caps_mpi->omegap = omegap;
+        caps_mpi->ht_pr = true;
+        _F_xi_batch(caps_mpi, 1, &caps_mpi->L, &caps_mpi->ldim, &xi_, &MM, NULL, &MM_plasma);
+        caps_mpi->ht_pr = false;
+    }
+    else if(pr != NULL)
     {
         caps_mpi->omegap = INFINITY;
-        caps_mpi->gamma  = 0;
-        *pr = F_xi(0, caps_mpi);
+        _F_xi_batch(caps_mpi, 1, &caps_mpi->L, &caps_mpi->ldim, &xi_, &MM, NULL, NULL);
     }
-
-    /* plasma */
-    if(plasma != NULL)
+    else if(plasma != NULL)
     {
         caps_mpi->omegap = omegap;
-        caps_mpi->gamma  = 0;
-        *plasma = F_xi(0, caps_mpi);
+        _F_xi_batch(caps_mpi, 1, &caps_mpi->L, &caps_mpi->ldim, &xi_, &MM_plasma, NULL, NULL);
     }
 
     caps_mpi->omegap = omegap_orig;
     caps_mpi->gamma  = gamma_orig;
+
+    if(drude != NULL)
+        *drude = drude_HT;
+    if(pr != NULL)
+        *pr = drude_HT+MM;
+    if(plasma != NULL)
+        *plasma = drude_HT+MM_plasma;
 }
 
-/* xi_ = ξ(L+R)/c */
-double F_xi(double xi_, caps_mpi_t *caps_mpi)
+/* logdetD at ξ=0 for the chosen material model; omegap in eV. A line
+ * "# model = ..." is printed. */
+static double _logdetD_xi0(caps_mpi_t *caps_mpi, material_t *material, double omegap, double gamma_)
 {
-    int m;
-    double drude_HT = NAN;
-    double terms[4096] = { NAN };
-    bool verbose = caps_mpi->verbose;
-    const double mmax = sizeof(terms)/sizeof(double);
-    const double cutoff = caps_mpi->cutoff;
+    double drude_HT = NAN, plasma_HT = NAN, pr_HT = NAN;
 
-    /* look in cache if resumed */
-    for(int j = 0; j < caps_mpi->cache_elems; j++)
+    if(material == NULL && isinf(omegap))
     {
-        const double xi_cache = caps_mpi->cache[j][0];
-        //printf("xi_cache=%g vs xi=%g\n", xi_cache, xi);
+        F_HT(caps_mpi, 0, NULL, &pr_HT, NULL);
+        printf("# model = perfect reflectors\n");
+        return pr_HT;
+    }
+    else if(material == NULL && gamma_ == 0)
+    {
+        F_HT(caps_mpi, omegap, NULL, NULL, &plasma_HT);
+        printf("# model = plasma\n");
+        return plasma_HT;
+    }
+    else if(material == NULL)
+    {
+        F_HT(caps_mpi, 0, &drude_HT, NULL, NULL);
+        printf("# model = drude\n");
+        return drude_HT;
+    }
+    else
+    {
+        double omegap_low, gamma_low;
+        material_get_extrapolation(material, &omegap_low, &gamma_low, NULL, NULL);
+        omegap_low *= CAPS_hbar_eV; /* convert from rad/s to eV */
+        gamma_low  *= CAPS_hbar_eV; /* convert from rad/s to eV */
 
-        if(xi_ == xi_cache || fabs(1-xi_cache/xi_) < 1e-11)
+        if(gamma_low == 0)
         {
-            const double logdetD = caps_mpi->cache[j][1];
-            return logdetD;
+            F_HT(caps_mpi, omegap_low, NULL, NULL, &plasma_HT);
+            printf("# model = optical data (xi=0: Plasma)\n");
+            return plasma_HT;
+        }
+        else
+        {
+            F_HT(caps_mpi, omegap_low, &drude_HT, NULL, &plasma_HT);
+            printf("# model = optical data (xi=0: Drude)\n");
+            printf("# plasma = %.16g (logdetD(xi=0) for plasma model with omegap=%geV)\n", plasma_HT, omegap_low);
+            return drude_HT;
         }
     }
+}
 
-    if(xi_ == 0)
+/* (L+R)^k ∂_L^k logdetD at ξ=0 for k=caps_mpi->derivative. At ξ=0 the
+ * round-trip matrix is not given in terms of the integrals K, see
+ * caps_dlogdetD_dL, and the derivative is computed by finite differences of
+ * fourth order of _logdetD_xi0. */
+static double _dlogdetD_xi0(caps_mpi_t *caps_mpi, material_t *material, double omegap, double gamma_)
+{
+    const int derivative = caps_mpi->derivative;
+    const double L = caps_mpi->L, R = caps_mpi->R;
+    const double h = L/100;
+    double f[5] = { 0, 0, 0, 0, 0 };
+
+    caps_mpi->derivative = 0;
+    for(int j = 0; j < 5; j++)
     {
-        /* compute Drude contribution */
-        caps_t *caps = caps_init(caps_mpi->R, caps_mpi->L);
-        caps_set_ldim(caps, caps_mpi->ldim);
-        if(caps_mpi->iepsrel > 0)
-            caps_set_epsrel(caps, caps_mpi->iepsrel);
-        drude_HT = caps_ht_drude(caps);
-        caps_free(caps);
+        /* the first derivative does not need the value at L */
+        if(j == 2 && derivative == 1)
+            continue;
 
-        if(!isinf(caps_mpi->omegap) && caps_mpi->gamma > 0)
-            /* omegap finite => Drude model */
-            return drude_HT;
+        caps_mpi->L = L+(j-2)*h;
+        f[j] = _logdetD_xi0(caps_mpi, material, omegap, gamma_);
+    }
+    caps_mpi->L = L;
+    caps_mpi->derivative = derivative;
+
+    if(derivative == 1)
+        return (L+R)*(f[0]-8*f[1]+8*f[3]-f[4])/(12*h);
+    else
+        return pow_2(L+R)*(-f[0]+16*f[1]-30*f[2]+16*f[3]-f[4])/(12*h*h);
+}
+
+/* Chebyshev surrogate of logdetD as a function of x=2ξL/c, see
+ * _surrogate_init. The variable x is mapped to t=(x-1)/(x+1) in [-1,1]. */
+typedef struct {
+    int N;        /* number of nodes */
+    double *t;    /* Chebyshev nodes t_j = cos(π(j+1/2)/N) */
+    double *f;    /* logdetD at the nodes */
+    double *c;    /* Chebyshev coefficients */
+    double err;   /* estimated absolute error of the surrogate */
+} surrogate_t;
+
+#define SURROGATE_N0   5    /* initial number of nodes */
+#define SURROGATE_NMAX 1215 /* maximum number of nodes, 5*3^5 */
+
+static surrogate_t *_surrogate_new(void)
+{
+    surrogate_t *self = xmalloc(sizeof(surrogate_t));
+
+    self->N = 0;
+    self->t = self->f = self->c = NULL;
+    self->err = INFINITY;
+
+    return self;
+}
+
+/* Store the new nodes x=2ξL/c of the next refinement step in x and return
+ * their number. The surrogate is sampled on Chebyshev nodes of the first kind
+ * in t=(x-1)/(x+1). In every step the number of nodes is tripled; since the
+ * nodes of N points are a subset of the nodes of 3N points, no value is
+ * computed twice. x must provide space for 3N (at least SURROGATE_N0)
+ * elements. */
+static int _surrogate_nodes(surrogate_t *self, double x[])
+{
+    const int N = (self->N > 0) ? 3*self->N : SURROGATE_N0;
+    int n = 0;
+
+    for(int j = 0; j < N; j++)
+    {
+        /* node j of N/3 points is node 3j+1 of N points */
+        if(!(self->N > 0 && j % 3 == 1))
+        {
+            const double t = cos(M_PI*(j+0.5)/N);
+            x[n++] = (1+t)/(1-t);
+        }
+    }
+
+    return n;
+}
+
+/* Add the values fx of logdetD at the nodes returned by _surrogate_nodes and
+ * compute the Chebyshev coefficients. Returns true if the refinement is
+ * finished, i.e., if the coefficients that were not resolved by the previous
+ * set of nodes are smaller than epsrel times the largest value of logdetD, or
+ * if the maximum number of nodes is reached. */
+static bool _surrogate_update(surrogate_t *self, const double fx[], double epsrel)
+{
+    const int N = (self->N > 0) ? 3*self->N : SURROGATE_N0;
+    double *t = xcalloc(N, sizeof(double));
+    double *f = xcalloc(N, sizeof(double));
+    double fmax = 0;
+
+    for(int j = 0, k = 0; j < N; j++)
+    {
+        t[j] = cos(M_PI*(j+0.5)/N);
+
+        if(self->N > 0 && j % 3 == 1)
+            f[j] = self->f[j/3];
+        else
+            f[j] = fx[k++];
+
+        fmax = MAX(fmax, fabs(f[j]));
+    }
+
+    xfree(self->t);
+    xfree(self->f);
+    xfree(self->c);
+    self->t = t;
+    self->f = f;
+    self->c = xcalloc(N, sizeof(double));
+    self->N = N;
+
+    /* c_k = 2/N Σ_j f_j cos(kπ(j+1/2)/N); c_0 with weight 1/N */
+    for(int k = 0; k < N; k++)
+    {
+        double sum = 0;
+        for(int j = 0; j < N; j++)
+            sum += f[j]*cos(M_PI*k*(j+0.5)/N);
+        self->c[k] = (k == 0 ? 1. : 2.)*sum/N;
+    }
+
+    self->err = 0;
+    for(int k = N/3; k < N; k++)
+        self->err += fabs(self->c[k]);
+
+    if(N > SURROGATE_N0 && self->err < epsrel*fmax)
+        return true;
+    if(3*N > SURROGATE_NMAX)
+    {
+        WARN(1, "surrogate did not converge: N=%d, err=%g, max|logdetD|=%g", N, self->err, fmax);
+        return true;
     }
 
-    /* gather all data */
-    for(m = 0; m < mmax; m++)
-    {
-        while(1)
+    return false;
+}
+
+/* Sample logdetD(x) adaptively until the surrogate has converged, see
+ * _surrogate_nodes and _surrogate_update; all new nodes of a step are
+ * computed concurrently. */
+static surrogate_t *_surrogate_init(caps_mpi_t *caps_mpi, double epsrel)
+{
+    surrogate_t *self = _surrogate_new();
+    double *x  = xcalloc(SURROGATE_NMAX, sizeof(double));
+    double *fx = xcalloc(SURROGATE_NMAX, sizeof(double));
+    bool done = false;
+
+    while(!done)
+    {
+        const int n = _surrogate_nodes(self, x);
+
+        integrand(n, x, fx, caps_mpi);
+        done = _surrogate_update(self, fx, epsrel);
+
+        printf("# surrogate: N=%d, err=%g\n", self->N, self->err);
+    }
+
+    xfree(x);
+    xfree(fx);
+
+    return self;
+}
+
+static void _surrogate_free(surrogate_t *self)
+{
+    xfree(self->t);
+    xfree(self->f);
+    xfree(self->c);
+    xfree(self);
+}
+
+/* evaluate Σ_k c_k T_k(t), k=0,...,N-1, using Clenshaw's algorithm */
+static double _chebyshev_eval(const double c[], int N, double t)
+{
+    double b1 = 0, b2 = 0;
+
+    for(int k = N-1; k > 0; k--)
+    {
+        const double b0 = c[k] + 2*t*b1 - b2;
+        b2 = b1;
+        b1 = b0;
+    }
+
+    return c[0] + t*b1 - b2;
+}
+
+/* evaluate the surrogate at x=2ξL/c */
+static double _surrogate_eval(surrogate_t *self, double x)
+{
+    return _chebyshev_eval(self->c, self->N, (x-1)/(x+1));
+}
+
+/* ∫dx logdetD(x), x=0...∞, using Fejér's first rule on the nodes of the
+ * surrogate; dx = 2/(1-t)² dt */
+static double _surrogate_integral(surrogate_t *self)
+{
+    const int N = self->N;
+    double integral = 0;
+
+    for(int j = 0; j < N; j++)
+    {
+        const double theta = M_PI*(j+0.5)/N;
+        double w = 1;
+
+        for(int k = 1; k <= N/2; k++)
+            w -= 2*cos(2*k*theta)/(4.*k*k-1);
+        w *= 2./N;
+
+        integral += w*self->f[j]*2/pow_2(1-self->t[j]);
+    }
+
+    return integral;
+}
+
+/* Free energy E*(L+R)/(hbar*c) for temperature T from the surrogate. logdetD0
+ * is the value of logdetD at ξ=0 (only used if T>0). */
+static double _surrogate_energy(surrogate_t *surrogate, double L, double R, double T, double logdetD0, int psd_order, double epsrel)
+{
+    const double alpha = 2*L/(L+R);
+
+    if(T == 0)
+        return _surrogate_integral(surrogate)/alpha/M_PI;
+
+    const double T_scaled = 2*M_PI*CAPS_kB*(R+L)*T/(CAPS_hbar*CAPS_c);
+    double *v = NULL;
+
+    buf_push(v, logdetD0/2); /* half weight */
+
+    if(psd_order < 0)
+    {
+        const double Teff = 4*M_PI*CAPS_kB/CAPS_hbar/CAPS_c*T*L;
+        psd_order = ceil( (1-1.5*log10(epsrel))/sqrt(Teff) );
+    }
+
+    if(psd_order > 0)
+    {
+        double *psd_xi  = xcalloc(psd_order, sizeof(double));
+        double *psd_eta = xcalloc(psd_order, sizeof(double));
+
+        psd(psd_order, psd_xi, psd_eta);
+
+        for(int n = 0; n < psd_order; n++)
+        {
+            const double xi = psd_xi[n]*T_scaled/(2*M_PI);
+            buf_push(v, psd_eta[n]*_surrogate_eval(surrogate, alpha*xi));
+        }
+
+        xfree(psd_xi);
+        xfree(psd_eta);
+    }
+    else
+    {
+        /* largest node; beyond logdetD is zero for all practical purposes */
+        const double t0 = surrogate->t[0];
+        const double xmax = (1+t0)/(1-t0);
+
+        for(size_t n = 1; n*alpha*T_scaled < xmax; n++)
+        {
+            const double logdetD = _surrogate_eval(surrogate, n*alpha*T_scaled);
+            buf_push(v, logdetD);
+
+            if(fabs(logdetD/logdetD0) < epsrel)
+                break;
+        }
+    }
+
+    const double F = T_scaled/M_PI*kahan_sum(v, buf_size(v));
+    buf_free(v);
+
+    return F;
+}
+
+/* Free energies F[i] for the separations L[i] (dimension ldim[i]) at
+ * temperature T. For every separation a surrogate of logdetD is sampled (see
+ * _surrogate_nodes). The new nodes of all separations whose surrogates have
+ * not converged yet are computed together, so the tasks (L,ξ,m) of all
+ * separations share the workers. A line is printed for every separation as
+ * soon as its free energy is known. The term ξ=0 (T>0) is computed for every
+ * separation before. */
+static void _separation_sweep(caps_mpi_t *caps_mpi, material_t *material, double omegap, double gamma_, int elems, const double L[], const int ldim[], double T, int psd_order, double epsrel, double F[])
+{
+    const double R = caps_mpi->R;
+    const double L_orig = caps_mpi->L, alpha_orig = caps_mpi->alpha;
+    const int ldim_orig = caps_mpi->ldim;
+    surrogate_t **surrogates = xcalloc(elems, sizeof(surrogate_t *));
+    double *logdetD0 = xcalloc(elems, sizeof(double));
+    bool *done = xcalloc(elems, sizeof(bool));
+    int remaining = elems;
+
+    /* nodes of a step of all separations */
+    double *x       = xcalloc(elems*SURROGATE_NMAX, sizeof(double));
+    double *fx      = xcalloc(elems*SURROGATE_NMAX, sizeof(double));
+    double *xi_     = xcalloc(elems*SURROGATE_NMAX, sizeof(double));
+    double *logdetD = xcalloc(elems*SURROGATE_NMAX, sizeof(double));
+    double *t       = xcalloc(elems*SURROGATE_NMAX, sizeof(double));
+    double *Lk      = xcalloc(elems*SURROGATE_NMAX, sizeof(double));
+    int *ldimk      = xcalloc(elems*SURROGATE_NMAX, sizeof(int));
+    int *index      = xcalloc(elems*SURROGATE_NMAX, sizeof(int));
+    int *owner      = xcalloc(elems*SURROGATE_NMAX, sizeof(int));
+
+    for(int i = 0; i < elems; i++)
+    {
+        surrogates[i] = _surrogate_new();
+        logdetD0[i] = NAN;
+
+        if(T > 0)
+        {
+            const double t0 = now();
+
+            /* F_HT computes for the geometry of caps_mpi */
+            caps_mpi->L     = L[i];
+            caps_mpi->ldim  = ldim[i];
+            caps_mpi->alpha = 2*L[i]/(L[i]+R);
+
+            logdetD0[i] = _logdetD_xi0(caps_mpi, material, omegap, gamma_);
+            printf("# L=%.16g, xi*(L+R)/c=0, logdetD=%.16g, t=%g\n", L[i], logdetD0[i], now()-t0);
+        }
+    }
+
+    caps_mpi->L     = L_orig;
+    caps_mpi->ldim  = ldim_orig;
+    caps_mpi->alpha = alpha_orig;
+
+    printf("#\n");
+    printf("# L/R, L, R, T, ldim, E*(L+R)/(hbar*c)\n");
+
+    while(remaining > 0)
+    {
+        int n = 0, n_compute = 0;
+
+        for(int i = 0; i < elems; i++)
+        {
+            if(done[i])
+                continue;
+
+            const int ni = _surrogate_nodes(surrogates[i], &x[n]);
+            const double alpha = 2*L[i]/(L[i]+R);
+
+            for(int k = n; k < n+ni; k++)
+            {
+                owner[k] = i;
+                xi_[n_compute]   = x[k]/alpha;
+                Lk[n_compute]    = L[i];
+                ldimk[n_compute] = ldim[i];
+                index[n_compute] = k;
+                n_compute++;
+            }
+
+            n += ni;
+        }
+
+        _F_xi_batch(caps_mpi, n_compute, Lk, ldimk, xi_, logdetD, t, NULL);
+
+        for(int k = 0; k < n_compute; k++)
+        {
+            fx[index[k]] = logdetD[k];
+            printf("# L=%.16g, xi*(L+R)/c=%.16g, logdetD=%.16g, t=%g\n", Lk[k], xi_[k], logdetD[k], t[k]);
+        }
+
+        for(int k = 0; k < n; )
+        {
+            const int i = owner[k];
+            const int N = surrogates[i]->N;
+
+            done[i] = _surrogate_update(surrogates[i], &fx[k], epsrel);
+            k += surrogates[i]->N - N;
+
+            if(done[i])
+            {
+                F[i] = _surrogate_energy(surrogates[i], L[i], R, T, logdetD0[i], psd_order, epsrel);
+                printf("%.16g, %.16g, %.16g, %.16g, %d, %.16g\n", L[i]/R, L[i], R, T, ldim[i], F[i]);
+                remaining--;
+            }
+        }
+    }
+
+    for(int i = 0; i < elems; i++)
+        _surrogate_free(surrogates[i]);
+
+    xfree(surrogates);
+    xfree(logdetD0);
+    xfree(done);
+    xfree(x);
+    xfree(fx);
+    xfree(xi_);
+    xfree(logdetD);
+    xfree(t);
+    xfree(Lk);
+    xfree(ldimk);
+    xfree(index);
+    xfree(owner);
+}
+
+/* Chebyshev nodes of the first kind in log(L) on [Lmin,Lmax] */
+static double *_chebyshev_separations(double Lmin, double Lmax, int N)
+{
+    const double um = (log(Lmax)+log(Lmin))/2, ud = (log(Lmax)-log(Lmin))/2;
+    double *L = NULL;
+
+    for(int j = 0; j < N; j++)
+        buf_push(L, exp(um+ud*cos(M_PI*(j+0.5)/N)));
+
+    return L;
+}
+
+/* Interpolate E(L) from the free energies F[j] = E(L_j)(L_j+R)/(hbar*c) at
+ * the separations of _chebyshev_separations and print E and dE/dL at M
+ * logarithmically spaced separations in [Lmin,Lmax]. */
+static void _chebyshev_interpolation(double Lmin, double Lmax, int N, double R, const double L[], const double F[], int M)
+{
+    const double um = (log(Lmax)+log(Lmin))/2, ud = (log(Lmax)-log(Lmin))/2;
+    double *c  = xcalloc(N, sizeof(double));
+    double *dc = xcalloc(N+1, sizeof(double));
+
+    /* coefficients of E*R/(hbar*c) as a function of s=(log(L)-um)/ud */
+    for(int k = 0; k < N; k++)
+    {
+        double sum = 0;
+        for(int j = 0; j < N; j++)
+            sum += F[j]*R/(L[j]+R)*cos(M_PI*k*(j+0.5)/N);
+        c[k] = (k == 0 ? 1. : 2.)*sum/N;
+    }
+
+    /* coefficients of the derivative with respect to s */
+    for(int k = N-1; k > 0; k--)
+        dc[k-1] = (k+1 < N ? dc[k+1] : 0) + 2*k*c[k];
+    dc[0] /= 2;
+
+    printf("#\n");
+    printf("# Chebyshev interpolation of %d separations in log(L)\n", N);
+    printf("# L, E*R/(hbar*c), dE/dL*R^2/(hbar*c)\n");
+    for(int i = 0; i < M; i++)
+    {
+        const double u = log(Lmin) + (M > 1 ? i*2*ud/(M-1) : ud);
+        const double s = (u-um)/ud;
+        const double L_i = exp(u);
+        const double E = _chebyshev_eval(c, N, s);
+        const double dEdL = _chebyshev_eval(dc, N, s)/ud/L_i; /* dE/du/L */
+
+        printf("%.16g, %.16g, %.16g\n", L_i, E, dEdL*R);
+    }
+
+    xfree(c);
+    xfree(dc);
+}
+
+/* Sum (T>0) or integrate (T=0) the quantity given by caps_mpi->derivative
+ * over the Matsubara frequencies. For derivative=0 the free energy
+ * E*(L+R)/(hbar*c) is returned, for derivative=k the k-th derivative of the
+ * free energy with respect to L in units of hbar*c/(L+R)^(k+1). */
+static double _sum_xi(caps_mpi_t *caps_mpi, material_t *material, double omegap, double gamma_, bool fcqs, int psd_order, double epsrel)
+{
+    const double L = caps_mpi->L, R = caps_mpi->R, T = caps_mpi->T;
+    const char *label = _label(caps_mpi);
+    double F = NAN;
+
+    if(T == 0)
+    {
+        double integral = 0, abserr = 0;
+        int ier, neval;
+
+        if(fcqs)
+            printf("# quad = Fourier-Chebshev quadrature scheme\n");
+        else
+            printf("# quad = adaptive Gauss-Kronrod\n");
+        printf("#\n");
+
+        if(fcqs)
+            integral = fcqs_semiinf_batch(integrand, caps_mpi, &epsrel, &neval, 1, &ier);
+        else
+        {
+            integral = dqagi_batch(integrand, 0, 1, 0, epsrel, &abserr, &neval, &ier, caps_mpi);
+            epsrel = fabs(abserr/integral);
+        }
+        caps_mpi->err_xi = fmax(caps_mpi->err_xi, epsrel);
+
+        printf("#\n");
+        printf("# ier=%d, integral=%.16g, neval=%d, epsrel=%g\n", ier, integral, neval, epsrel);
+
+        WARN(ier != 0, "ier=%d", ier);
+
+        /* free energy for T=0 */
+        F = integral/caps_mpi->alpha/M_PI;
+    }
+    else
+    {
+        /* finite temperature */
+        const double T_scaled = 2*M_PI*CAPS_kB*(R+L)*T/(CAPS_hbar*CAPS_c);
+        double *v = NULL;
+        double remainder = 0; /* estimated remainder of the MSD */
+
+        /* xi = 0 */
+        {
+            const double t0 = now();
+
+            if(caps_mpi->derivative == 0)
+                buf_push(v, _logdetD_xi0(caps_mpi, material, omegap, gamma_));
+            else
+                buf_push(v, _dlogdetD_xi0(caps_mpi, material, omegap, gamma_));
+
+            printf("#\n");
+            printf("# xi*(L+R)/c=0, %s=%.16g, t=%g\n", label, v[0], now()-t0);
+        }
+
+
+        if(psd_order > 0)
+        {
+            /* Pade spectrum decomposition (PSD), see psd.c.
+             * Reference: Hu, Xu, Yan, J. Chem. Phys. 133, 101106 (2010),
+             *            https://doi.org/10.1063/1.3602466
+             */
+            double *psd_xi  = xcalloc(psd_order, sizeof(double));
+            double *psd_eta = xcalloc(psd_order, sizeof(double));
+
+            psd(psd_order, psd_xi, psd_eta);
+
+            /* all frequencies are computed concurrently */
+            double *logdetD = xcalloc(psd_order, sizeof(double));
+            double *t       = xcalloc(psd_order, sizeof(double));
+            for(int n = 0; n < psd_order; n++)
+                psd_xi[n] *= T_scaled/(2*M_PI);
+
+            F_xi_batch(caps_mpi, psd_order, psd_xi, logdetD, t);
+
+            for(int n = 0; n < psd_order; n++)
+            {
+                buf_push(v, psd_eta[n]*logdetD[n]);
+                printf("# xi*(L+R)/c=%.16g, %s=%.16g, t=%g\n", psd_xi[n], label, v[n+1], t[n]);
+            }
+
+            xfree(logdetD);
+            xfree(t);
+            xfree(psd_xi);
+            xfree(psd_eta);
+        }
+        else
         {
-            caps_task_t *task = NULL;
-
-            /* send job */
-            if(caps_mpi_submit(caps_mpi, m, xi_, m))
-                break;
+            /* Matsubara spectrum decomposition (MSD)
+             *
+             * For large frequencies the round trip decays as exp(-2ξL/c),
+             * cf. the PFA estimate in _logdetD_estimate, i.e., the ratio of
+             * consecutive terms approaches exp(-2ξ_1 L/c) from below. The
+             * remainder of the sum is estimated by v_n q/(1-q) with the
+             * ratio q of the last two terms (exponential fit). A bound of
+             * the remainder is obtained using the larger of q and the
+             * asymptotic ratio. The sum is stopped once the bound is smaller
+             * than epsrel relative to the partial sum, and the estimated
+             * remainder is added to the sum. */
+            const double q_asymptotic = exp(-caps_mpi->alpha*T_scaled);
+            double partial = v[0]/2, bound = NAN;
 
-            /* retrieve jobs */
-            while(caps_mpi_retrieve(caps_mpi, &task))
+            for(size_t n = 1; true; n++)
             {
-                double v = terms[task->m] = task->value;
+                const double t0 = now();
+                const double xi = n*T_scaled;
+                buf_push(v, F_xi(xi, caps_mpi));
+                printf("# xi*(L+R)/c=%.16g, %s=%.16g, t=%g\n", xi, label, v[n], now()-t0);
+
+                partial += v[n];
 
-                if(verbose)
-                    fprintf(stderr, "# m=%d, xi_=%.16g, logdetD=%.16g\n", task->m, xi_, task->value);
+                if(v[n] == 0)
+                {
+                    remainder = bound = 0;
+                    break;
+                }
 
-                if(v == 0 || v/terms[0] < cutoff)
-                    goto done;
+                const double q = (n > 1) ? v[n]/v[n-1] : q_asymptotic;
+                const double q_max = fmax(q, q_asymptotic);
+                if(q > 0 && q_max < 1)
+                {
+                    remainder = v[n]*q/(1-q);
+                    bound = v[n]*q_max/(1-q_max);
+                    if(fabs(bound) < epsrel*fabs(partial))
+                        break;
+                }
             }
 
-            usleep(IDLE);
+            printf("# MSD: %zu frequencies, estimated remainder=%.16g, bound=%.16g (relative %g)\n", buf_size(v)-1, remainder, bound, fabs(bound/partial));
+            caps_mpi->err_xi = fmax(caps_mpi->err_xi, fabs(bound/partial));
         }
-    }
 
-    TERMINATE(true, "sum did not converge, sorry. :(");
+        v[0] /= 2; /* half weight */
+        F = T_scaled/M_PI*(kahan_sum(v, buf_size(v))+remainder);
 
-    done:
+        buf_free(v);
+    }
 
-    /* retrieve all remaining running jobs */
-    while(caps_mpi_get_running(caps_mpi) > 0)
-    {
-        caps_task_t *task = NULL;
+    return F;
+}
 
-        while(caps_mpi_retrieve(caps_mpi, &task))
-        {
-            terms[task->m] = task->value;
-            if(verbose)
-                fprintf(stderr, "# m=%d, xi_=%.16g, logdetD=%.16g\n", task->m, xi_, task->value);
-        }
+/* Integrate the Casimir energy of two equal spheres of radius R at
+ * separation d=2L (perfect reflectors, T=0) over x = 2ξL/c = ξd/c, see
+ * --sphere-sphere. The same quadrature as for the plane-sphere geometry is
+ * used, so the integrand at most nodes is known from _sum_xi. Returns
+ * E_ss*d/(hbar*c). */
+static double _sum_xi_ss(caps_mpi_t *caps_mpi, bool fcqs, double epsrel)
+{
+    const size_t visited = buf_size(caps_mpi->ss_xi);
+    double integral = 0, abserr = 0;
+    int ier, neval;
 
-        usleep(IDLE);
+    printf("#\n");
+    printf("# sphere-sphere geometry, R1=R2=R, d=2L=%.16g\n", 2*caps_mpi->L);
+    printf("#\n");
+
+    if(fcqs)
+        integral = fcqs_semiinf_batch(integrand_ss, caps_mpi, &epsrel, &neval, 1, &ier);
+    else
+    {
+        integral = dqagi_batch(integrand_ss, 0, 1, 0, epsrel, &abserr, &neval, &ier, caps_mpi);
+        epsrel = fabs(abserr/integral);
     }
 
-    terms[0] /= 2; /* m = 0 */
+    printf("#\n");
+    printf("# ier=%d, integral=%.16g, neval=%d, epsrel=%g, %zu additional frequencies\n", ier, integral, neval, epsrel, buf_size(caps_mpi->ss_xi)-visited);
 
-    if(xi_ == 0)
-        return drude_HT + kahan_sum(terms, m);
-    else
-        return kahan_sum(terms, m);
+    WARN(ier != 0, "ier=%d", ier);
+
+    /* as for the plane-sphere geometry E_ss*(L+R)/(hbar*c) =
+     * integral/(α π), and d/(L+R) = α */
+    return integral/M_PI;
 }
 
 int main(int argc, char *argv[])
@@ -416,20 +1260,56 @@ int main(int argc, char *argv[])
     return 0;
 }
 
+/* print how much the adaptive truncation window reduced the dimension of the
+ * round-trip matrices, see --window */
+static void _print_window(caps_mpi_t *caps_mpi)
+{
+    if(caps_mpi->window > 0 && caps_mpi->dim_full > 0)
+        printf("# adaptive window: round-trip matrices reduced to %.1f%% of their dimension\n", 100*caps_mpi->dim_window/caps_mpi->dim_full);
+}
+
+/* print the predicted relative errors of the stages of the error budget,
+ * see --accuracy; a prediction of 0 means that it is not available */
+static void _print_budget(caps_mpi_t *caps_mpi)
+{
+    const double accuracy = caps_mpi->accuracy;
+    const char *stages[] = { "integration over xi", "sums over m", "integrals of matrix elements", "HODLR" };
+    const double budget[] = { BUDGET_XI, BUDGET_M, BUDGET_INT, BUDGET_HODLR };
+    const double predicted[] = { caps_mpi->err_xi, caps_mpi->tail_m, caps_mpi->err_int, caps_mpi->hodlr_eps };
+    double total = 0;
+
+    if(accuracy <= 0)
+        return;
+
+    printf("# error budget for relative accuracy %g:\n", accuracy);
+    for(int i = 0; i < 4; i++)
+    {
+        total += predicted[i];
+        printf("#   %-30s budget %.2g, predicted %.2g\n", stages[i], budget[i]*accuracy, predicted[i]);
+    }
+    printf("#   %-30s predicted %.2g (truncation ldim not included)\n", "total", total);
+}
+
 void master(int argc, char *argv[], const int cores)
 {
-    bool verbose = false, fcqs = false, ht = false;
+    bool verbose = false, fcqs = false, ht = false, force = false, gradient = false, sphere_sphere = false;
     char filename[512] = { 0 };
 	char resume[512] = { 0 };
     int ldim = 0;
     double L = 0, R = 0, T = 0, omegap = INFINITY, gamma_ = 0;
     double cutoff = CUTOFF, epsrel = EPSREL, eta = ETA;
-    double iepsrel = CAPS_EPSREL;
+    double iepsrel = CAPS_EPSREL, window = 0;
+    double accuracy = 0, hodlr_eps = KERNEL_LOGDET_TOLERANCE;
+    bool set_cutoff = false, set_epsrel = false, set_iepsrel = false;
     material_t *material = NULL;
     char time_str[128];
     int psd_order = 0;
+    double *temperatures = NULL; /* --temperatures */
+    double *separations = NULL;  /* --L-list, --L-cheb */
+    double cheb_Lmin = 0, cheb_Lmax = 0;
+    int cheb_N = 0, cheb_M = 100;
 
-    #define EXIT() do { _mpi_stop(cores); return; } while(0)
+    #define EXIT() do { caps_mpi_stop(cores); return; } while(0)
 
     /* parse command line options */
     while (1)
@@ -452,13 +1332,21 @@ void master(int argc, char *argv[], const int cores)
             { "omegap",      required_argument, 0, 'w' },
             { "gamma",       required_argument, 0, 'g' },
             { "psd-order",   required_argument, 0, 'P' },
+            { "temperatures", required_argument, 0, 'S' },
+            { "L-list",      required_argument, 0, 'A' },
+            { "L-cheb",      required_argument, 0, 'C' },
+            { "force",       no_argument,       0, 'K' },
+            { "gradient",    no_argument,       0, 'G' },
+            { "window",      required_argument, 0, 'W' },
+            { "accuracy",    required_argument, 0, 'a' },
+            { "sphere-sphere", no_argument,     0, 'Q' },
             { 0, 0, 0, 0 }
         };
 
         /* getopt_long stores the option index here. */
         int option_index = 0;
 
-        int c = getopt_long(argc, argv, "R:L:T:l:c:e:E:f:r:i:w:g:P:pFvVHh", long_options, &option_index);
+        int c = getopt_long(argc, argv, "R:L:T:l:c:e:E:f:r:i:w:g:P:S:A:C:W:a:pFKGQvVHh", long_options, &option_index);
 
         /* Detect the end of the options. */
         if(c == -1)
@@ -485,12 +1373,15 @@ void master(int argc, char *argv[], const int cores)
                 break;
             case 'c':
                 cutoff = atof(optarg);
+                set_cutoff = true;
                 break;
             case 'i':
                 iepsrel = atof(optarg);
+                set_iepsrel = true;
                 break;
             case 'e':
                 epsrel = atof(optarg);
+                set_epsrel = true;
                 break;
             case 'w':
                 omegap = atof(optarg);
@@ -519,6 +1410,33 @@ void master(int argc, char *argv[], const int cores)
             case 'P':
                 psd_order = atoi(optarg);
                 break;
+            case 'S':
+                for(char *p = strtok(optarg, ","); p != NULL; p = strtok(NULL, ","))
+                    buf_push(temperatures, atof(p));
+                break;
+            case 'A':
+                for(char *p = strtok(optarg, ","); p != NULL; p = strtok(NULL, ","))
+                    buf_push(separations, atof(p));
+                break;
+            case 'C':
+                if(sscanf(optarg, "%lf,%lf,%d,%d", &cheb_Lmin, &cheb_Lmax, &cheb_N, &cheb_M) < 3)
+                    cheb_N = -1;
+                break;
+            case 'K':
+                force = true;
+                break;
+            case 'G':
+                force = gradient = true;
+                break;
+            case 'Q':
+                sphere_sphere = true;
+                break;
+            case 'W':
+                window = atof(optarg);
+                break;
+            case 'a':
+                accuracy = atof(optarg);
+                break;
             case 'V':
                 caps_build(stdout, NULL);
                 exit(0);
@@ -535,6 +1453,33 @@ void master(int argc, char *argv[], const int cores)
         }
     }
 
+    if(cheb_N != 0)
+    {
+        if(cheb_N < 2 || cheb_M < 1 || cheb_Lmin <= 0 || cheb_Lmax <= cheb_Lmin || separations != NULL)
+        {
+            fprintf(stderr, "--L-cheb expects LMIN,LMAX,N[,M] with 0<LMIN<LMAX and N>1, and can not be combined with --L-list.\n\n");
+            usage(stderr);
+            EXIT();
+        }
+        separations = _chebyshev_separations(cheb_Lmin, cheb_Lmax, cheb_N);
+    }
+    if(separations != NULL)
+    {
+        for(size_t i = 0; i < buf_size(separations); i++)
+            if(separations[i] <= 0)
+            {
+                fprintf(stderr, "separations must be positive.\n\n");
+                usage(stderr);
+                EXIT();
+            }
+        if(ht || fcqs || temperatures != NULL || strlen(resume))
+        {
+            fprintf(stderr, "--L-list and --L-cheb can not be combined with --ht, --fcqs, --temperatures or --resume\n\n");
+            usage(stderr);
+            EXIT();
+        }
+        L = separations[0];
+    }
     if(L <= 0)
     {
         fprintf(stderr, "separation must be positive.\n\n");
@@ -571,6 +1516,33 @@ void master(int argc, char *argv[], const int cores)
         usage(stderr);
         EXIT();
     }
+    if(!(accuracy >= 0) || accuracy >= 1)
+    {
+        fprintf(stderr, "accuracy must be in [0,1).\n\n");
+        usage(stderr);
+        EXIT();
+    }
+    if(accuracy > 0)
+    {
+        /* error budget: the target relative error is distributed on the
+         * integration over ξ, the sums over m, the integrals of the matrix
+         * elements and HODLR; options given explicitly are kept. The cutoff
+         * is at least two orders of magnitude smaller than epsrel, otherwise
+         * the integrand is not smooth enough for the quadrature. */
+        if(!set_epsrel)
+            epsrel = BUDGET_XI*accuracy;
+        if(!set_cutoff)
+            cutoff = MIN(BUDGET_M*accuracy, epsrel/CUTOFF_RATIO);
+        if(!set_iepsrel)
+            iepsrel = BUDGET_INT*accuracy/2; /* see _iepsrel_task */
+        hodlr_eps = BUDGET_HODLR*accuracy;
+    }
+    if(!(window >= 0))
+    {
+        fprintf(stderr, "window must be non-negative.\n\n");
+        usage(stderr);
+        EXIT();
+    }
     if(eta <= 0)
     {
         fprintf(stderr, "eta must be positive.\n\n");
@@ -620,6 +1592,36 @@ void master(int argc, char *argv[], const int cores)
         usage(stderr);
         EXIT();
     }
+    if(temperatures != NULL)
+    {
+        if(ht || fcqs || T > 0)
+        {
+            fprintf(stderr, "--temperatures can not be combined with --ht, --fcqs or --temperature\n\n");
+            usage(stderr);
+            EXIT();
+        }
+        for(size_t i = 0; i < buf_size(temperatures); i++)
+            if(temperatures[i] < 0)
+            {
+                fprintf(stderr, "temperatures must be non-negative.\n\n");
+                usage(stderr);
+                EXIT();
+            }
+    }
+
+    if(force && (ht || temperatures != NULL || separations != NULL || strlen(resume)))
+    {
+        fprintf(stderr, "--force and --gradient can not be combined with --ht, --temperatures, --L-list, --L-cheb or --resume\n\n");
+        usage(stderr);
+        EXIT();
+    }
+
+    if(sphere_sphere && (T > 0 || ht || temperatures != NULL || separations != NULL || force || strlen(resume) || strlen(filename) || !isinf(omegap)))
+    {
+        fprintf(stderr, "--sphere-sphere is only available for perfect reflectors at T=0 and can not be combined with --ht, --temperatures, --L-list, --L-cheb, --force, --gradient or --resume\n\n");
+        usage(stderr);
+        EXIT();
+    }
 
     if(cores < 2)
     {
@@ -632,12 +1634,17 @@ void master(int argc, char *argv[], const int cores)
 
     const double LbyR = L/R;
 
-    if(psd_order < 0)
+    if(psd_order < 0 && temperatures == NULL && separations == NULL)
     {
         const double Teff = 4*M_PI*CAPS_kB/CAPS_hbar/CAPS_c*T*L;
         psd_order = ceil( (1-1.5*log10(epsrel))/sqrt(Teff) );
     }
 
+    /* ldim for every separation of a sweep */
+    int *ldims = NULL;
+    for(size_t i = 0; i < buf_size(separations); i++)
+        buf_push(ldims, ldim > 0 ? ldim : MAX(LDIM_MIN, ceil(eta/(separations[i]/R))));
+
     /* if ldim was not set */
     if(ldim <= 0)
         ldim = MAX(LDIM_MIN, ceil(eta/LbyR));
@@ -652,15 +1659,39 @@ void master(int argc, char *argv[], const int cores)
     printf("# start time: %s\n", time_str);
     printf("#\n");
 
-    printf("# LbyR = %.16g\n", LbyR);
-    printf("# RbyL = %.16g\n", 1/LbyR);
-    printf("# L = %.16g\n", L);
+    if(separations != NULL)
+    {
+        printf("# L =");
+        for(size_t i = 0; i < buf_size(separations); i++)
+            printf("%s %.16g", i ? "," : "", separations[i]);
+        printf("\n");
+    }
+    else
+    {
+        printf("# LbyR = %.16g\n", LbyR);
+        printf("# RbyL = %.16g\n", 1/LbyR);
+        printf("# L = %.16g\n", L);
+    }
     printf("# R = %.16g\n", R);
     if(ht)
         printf("# high-temperature limit\n");
+    else if(temperatures != NULL)
+    {
+        printf("# T =");
+        for(size_t i = 0; i < buf_size(temperatures); i++)
+            printf("%s %.16g", i ? "," : "", temperatures[i]);
+        printf("\n");
+        printf("# using Chebyshev surrogate of logdetD(xi)\n");
+        if(psd_order)
+            printf("# using Pade spectrum decomposition (PSD)\n");
+    }
     else
     {
         printf("# T = %.16g\n", T);
+        if(force)
+            printf("# computing force%s from derivatives of logdetD\n", gradient ? " and force gradient" : "");
+        if(sphere_sphere)
+            printf("# computing also the energy of two spheres of radius R at separation d=2L\n");
         if(T > 0)
         {
             if(psd_order)
@@ -672,7 +1703,22 @@ void master(int argc, char *argv[], const int cores)
     printf("# cutoff = %g\n", cutoff);
     printf("# epsrel = %g\n", epsrel);
     printf("# iepsrel = %g\n", iepsrel);
-    printf("# ldim = %d\n", ldim);
+    if(window > 0)
+        printf("# window = %g\n", window);
+    if(accuracy > 0)
+    {
+        printf("# accuracy = %g\n", accuracy);
+        printf("# hodlr_eps = %g\n", hodlr_eps);
+    }
+    if(separations != NULL)
+    {
+        printf("# ldim =");
+        for(size_t i = 0; i < buf_size(ldims); i++)
+            printf("%s %d", i ? "," : "", ldims[i]);
+        printf("\n");
+    }
+    else
+        printf("# ldim = %d\n", ldim);
     printf("# cores = %d\n", cores);
     if(strlen(filename))
         printf("# filename = %s\n", filename);
@@ -685,6 +1731,10 @@ void master(int argc, char *argv[], const int cores)
         printf("# resume = %s\n", resume);
 
     caps_mpi_t *caps_mpi = caps_mpi_init(L, R, T, filename, resume, omegap, gamma_, ldim, cutoff, iepsrel, cores, verbose);
+    caps_mpi->window = window;
+    caps_mpi->accuracy = accuracy;
+    caps_mpi->hodlr_eps = hodlr_eps;
+    caps_mpi->sphere_sphere = sphere_sphere;
 
     /* high-temperature limit */
     if(ht)
@@ -718,244 +1768,133 @@ void master(int argc, char *argv[], const int cores)
         return;
     }
 
-    double F = NAN;
-    if(T == 0)
+    /* temperature sweep using a surrogate of logdetD(ξ) */
+    if(temperatures != NULL)
     {
-        double integral = 0, abserr = 0;
-        int ier, neval;
-
-        if(fcqs)
-            printf("# quad = Fourier-Chebshev quadrature scheme\n");
-        else
-            printf("# quad = adaptive Gauss-Kronrod\n");
-        printf("#\n");
-
-        if(fcqs)
-            integral = fcqs_semiinf(integrand, caps_mpi, &epsrel, &neval, 1, &ier);
-        else
-        {
-            integral = dqagi(integrand, 0, 1, 0, epsrel, &abserr, &neval, &ier, caps_mpi);
-            epsrel = fabs(abserr/integral);
-        }
+        const size_t elems = buf_size(temperatures);
+        double logdetD0 = NAN;
+        double *F = xcalloc(elems, sizeof(double));
 
         printf("#\n");
-        printf("# ier=%d, integral=%.16g, neval=%d, epsrel=%g\n", ier, integral, neval, epsrel);
-
-        WARN(ier != 0, "ier=%d", ier);
-
-        /* free energy for T=0 */
-        F = integral/caps_mpi->alpha/M_PI;
-    }
-    else
-    {
-        /* finite temperature */
-        double drude_HT = NAN, plasma_HT = NAN, pr_HT = NAN;
-        const double T_scaled = 2*M_PI*CAPS_kB*(R+L)*T/(CAPS_hbar*CAPS_c);
-        double *v = NULL;
+        surrogate_t *surrogate = _surrogate_init(caps_mpi, epsrel);
 
-        /* xi = 0 */
+        for(size_t i = 0; i < elems; i++)
         {
-            const double t0 = now();
-
-            caps_t *caps = caps_init(R, L);
-            caps_set_ldim(caps, ldim);
-
-            if(material == NULL && isinf(omegap))
-            {
-                F_HT(caps_mpi, 0, NULL, &pr_HT, NULL);
-                printf("# model = perfect reflectors\n");
-                buf_push(v, pr_HT);
-            }
-            else if(material == NULL && gamma_ == 0)
+            if(temperatures[i] > 0 && isnan(logdetD0))
             {
-                F_HT(caps_mpi, omegap, NULL, NULL, &plasma_HT);
-                printf("# model = plasma\n");
-                buf_push(v, plasma_HT);
-            }
-            else if(material == NULL)
-            {
-                F_HT(caps_mpi, 0, &drude_HT, NULL, NULL);
-                printf("# model = drude\n");
-                buf_push(v, drude_HT);
+                const double t0 = now();
+                logdetD0 = _logdetD_xi0(caps_mpi, material, omegap, gamma_);
+                printf("# xi*(L+R)/c=0, logdetD=%.16g, t=%g\n", logdetD0, now()-t0);
             }
-            else
-            {
-                double omegap_low, gamma_low;
-                material_get_extrapolation(material, &omegap_low, &gamma_low, NULL, NULL);
-                omegap_low *= CAPS_hbar_eV; /* convert from rad/s to eV */
-                gamma_low  *= CAPS_hbar_eV; /* convert from rad/s to eV */
 
-                if(gamma_low == 0)
-                {
-                    F_HT(caps_mpi, omegap_low, NULL, NULL, &plasma_HT);
-                    printf("# model = optical data (xi=0: Plasma)\n");
-                    buf_push(v, plasma_HT);
-                }
-                else
-                {
-                    F_HT(caps_mpi, omegap_low, &drude_HT, NULL, &plasma_HT);
-                    printf("# model = optical data (xi=0: Drude)\n");
-                    printf("# plasma = %.16g (logdetD(xi=0) for plasma model with omegap=%geV)\n", plasma_HT, omegap_low);
+            F[i] = _surrogate_energy(surrogate, L, R, temperatures[i], logdetD0, psd_order, epsrel);
+        }
 
-                    buf_push(v, drude_HT);
-                }
-            }
+        time_as_string(time_str, sizeof(time_str)/sizeof(time_str[0]));
 
-            caps_free(caps);
+        printf("#\n");
+        printf("# %d determinants computed\n", caps_get_determinants(caps_mpi));
+        printf("# %d frequencies skipped (PFA estimate of logdetD below cutoff)\n", caps_mpi->skipped);
+        printf("# largest estimated relative remainder of the sums over m: %g\n", caps_mpi->tail_m);
+        _print_window(caps_mpi);
+        _print_budget(caps_mpi);
+        printf("# stop time: %s\n", time_str);
+        printf("#\n");
+        printf("# L/R, L, R, T, ldim, E*(L+R)/(hbar*c)\n");
+        for(size_t i = 0; i < elems; i++)
+            printf("%.16g, %.16g, %.16g, %.16g, %d, %.16g\n", LbyR, L, R, temperatures[i], ldim, F[i]);
 
-            printf("#\n");
-            printf("# xi*(L+R)/c=0, logdetD=%.16g, t=%g\n", v[0], now()-t0);
-        }
+        _surrogate_free(surrogate);
+        xfree(F);
+        buf_free(temperatures);
+        if(material != NULL)
+            material_free(material);
+        caps_mpi_free(caps_mpi);
+        return;
+    }
 
+    /* separation sweep using a surrogate of logdetD(ξ) for every separation */
+    if(separations != NULL)
+    {
+        const int elems = buf_size(separations);
+        double *F = xcalloc(elems, sizeof(double));
 
-        if(psd_order > 0)
-        {
-            /* Pade spectrum decomposition (PSD), see psd.c.
-             * Reference: Hu, Xu, Yan, J. Chem. Phys. 133, 101106 (2010),
-             *            https://doi.org/10.1063/1.3602466
-             */
-            double *psd_xi  = xcalloc(psd_order, sizeof(double));
-            double *psd_eta = xcalloc(psd_order, sizeof(double));
+        if(T > 0 && psd_order)
+            printf("# using Pade spectrum decomposition (PSD)\n");
+        printf("# using Chebyshev surrogate of logdetD(xi)\n");
 
-            psd(psd_order, psd_xi, psd_eta);
+        _separation_sweep(caps_mpi, material, omegap, gamma_, elems, separations, ldims, T, psd_order, epsrel, F);
 
-            for(int n = 0; n < psd_order; n++)
-            {
-                const double xi = psd_xi[n]*T_scaled/(2*M_PI);
-                const double t0 = now();
-                buf_push(v, psd_eta[n]*F_xi(xi, caps_mpi));
-                printf("# xi*(L+R)/c=%.16g, logdetD=%.16g, t=%g\n", xi, v[n+1], now()-t0);
-            }
+        if(cheb_N > 0)
+            _chebyshev_interpolation(cheb_Lmin, cheb_Lmax, cheb_N, R, separations, F, cheb_M);
 
-            xfree(psd_xi);
-            xfree(psd_eta);
-        }
-        else
-        {
-            /* Matsubara spectrum decomposition (MSD) */
-            for(size_t n = 1; true; n++)
-            {
-                const double t0 = now();
-                const double xi = n*T_scaled;
-                buf_push(v, F_xi(xi, caps_mpi));
-                printf("# xi*(L+R)/c=%.16g, logdetD=%.16g, t=%g\n", xi, v[n], now()-t0);
+        time_as_string(time_str, sizeof(time_str)/sizeof(time_str[0]));
 
-                if(fabs(v[n]/v[0]) < epsrel)
-                    break;
-            }
-        }
+        printf("#\n");
+        printf("# %d determinants computed\n", caps_get_determinants(caps_mpi));
+        printf("# %d frequencies skipped (PFA estimate of logdetD below cutoff)\n", caps_mpi->skipped);
+        printf("# largest estimated relative remainder of the sums over m: %g\n", caps_mpi->tail_m);
+        _print_window(caps_mpi);
+        _print_budget(caps_mpi);
+        printf("# stop time: %s\n", time_str);
+
+        xfree(F);
+        buf_free(separations);
+        buf_free(ldims);
+        if(material != NULL)
+            material_free(material);
+        caps_mpi_free(caps_mpi);
+        return;
+    }
 
-        v[0] /= 2; /* half weight */
-        F = T_scaled/M_PI*kahan_sum(v, buf_size(v));
+    /* free energy E, force F=-dE/dL and its derivative dF/dL */
+    const char *quantities[] = { "E*(L+R)/(hbar*c)", "F*(L+R)^2/(hbar*c)", "dF/dL*(L+R)^3/(hbar*c)" };
+    double results[3] = { NAN, NAN, NAN };
+    const int kmin = force ? 1 : 0, kmax = force ? (gradient ? 2 : 1) : 0;
+    for(int k = kmin; k <= kmax; k++)
+    {
+        caps_mpi->derivative = k;
+        if(force)
+            printf("#\n# %s\n", quantities[k]);
 
-        buf_free(v);
+        /* F=-dE/dL */
+        results[k] = (k == 0 ? 1 : -1)*_sum_xi(caps_mpi, material, omegap, gamma_, fcqs, psd_order, epsrel);
     }
 
+    /* sphere-sphere geometry at d=2L from the same determinants */
+    const double E_ss = sphere_sphere ? _sum_xi_ss(caps_mpi, fcqs, epsrel) : NAN;
+
     time_as_string(time_str, sizeof(time_str)/sizeof(time_str[0]));
 
     printf("#\n");
     printf("# %d determinants computed\n", caps_get_determinants(caps_mpi));
+    printf("# %d frequencies skipped (PFA estimate of logdetD below cutoff)\n", caps_mpi->skipped);
+    printf("# largest estimated relative remainder of the sums over m: %g\n", caps_mpi->tail_m);
+    _print_window(caps_mpi);
+    _print_budget(caps_mpi);
     printf("# stop time: %s\n", time_str);
     printf("#\n");
-    printf("# L/R, L, R, T, ldim, E*(L+R)/(hbar*c)\n");
-    printf("%.16g, %.16g, %.16g, %.16g, %d, %.16g\n", LbyR, L, R, T, ldim, F);
+    printf("# L/R, L, R, T, ldim");
+    for(int k = kmin; k <= kmax; k++)
+        printf(", %s", quantities[k]);
+    if(sphere_sphere)
+        printf(", E_ss*d/(hbar*c)");
+    printf("\n");
+    printf("%.16g, %.16g, %.16g, %.16g, %d", LbyR, L, R, T, ldim);
+    for(int k = kmin; k <= kmax; k++)
+        printf(", %.16g", results[k]);
+    if(sphere_sphere)
+        printf(", %.16g", E_ss);
+    printf("\n");
 
     if(material != NULL)
         material_free(material);
 
+    buf_free(caps_mpi->ss_xi);
+    buf_free(caps_mpi->ss_logdetD2);
     caps_mpi_free(caps_mpi);
 }
 
-void slave(MPI_Comm master_comm, int rank)
-{
-    char filename[512] = { 0 };
-    double userdata[2] = { 0 };
-    double buf[8] = { 0 };
-
-    MPI_Status status;
-    MPI_Request request;
-
-    while(1)
-    {
-        double logdet = NAN;
-
-        caps_t  *caps  = NULL;
-        material_t *material = NULL;
-
-        memset(buf,      0, sizeof(buf));
-        memset(filename, 0, sizeof(filename));
-        memset(userdata, 0, sizeof(userdata));
-
-        MPI_Recv(buf, 8, MPI_DOUBLE, 0, 0, master_comm, &status);
-
-        /* Matsubara frequency; xi_ = ξ(L+R)/c */
-        const double xi_ = buf[0];
-
-        /* signal to quit */
-        if(xi_ < 0)
-            break;
-
-        /* geometry */
-        const double L = buf[1]; /* in m */;
-        const double R = buf[2]; /* in m */
-        const double LbyR = L/R;
-
-        const double omegap = buf[3]/CAPS_hbar_eV; /* plasma frequency in rad/s */
-        const double gamma_ = buf[4]/CAPS_hbar_eV; /* relaxation frequency in rad/s */
-
-        const int m          = (int)buf[5];
-        const double iepsrel = buf[6];
-        const int ldim       = (int)buf[7];
-
-        /* get filename */
-        MPI_Recv(filename, 512, MPI_CHAR, 0, 0, master_comm, &status);
-
-        caps = caps_init(R,L);
-        TERMINATE(caps == NULL, "caps object is null");
-        caps_set_ldim(caps, ldim);
-
-        if(iepsrel > 0)
-            caps_set_epsrel(caps, iepsrel);
-
-        /* high-temperature case */
-        if(xi_ == 0)
-        {
-            if(isinf(omegap))
-                /* MM mode of PR */
-                caps_logdetD0(caps, m, 0, NULL, &logdet, NULL);
-            else
-                /* plasma */
-                caps_logdetD0(caps, m, omegap, NULL, NULL, &logdet);
-        }
-        else
-        {
-            /* set material properties */
-            if(strlen(filename))
-            {
-                material = material_init(filename, L+R);
-                TERMINATE(material == NULL, "material_init failed");
-                caps_set_epsilonm1(caps, material_epsilonm1, material);
-            }
-            else if(!isinf(omegap))
-            {
-                userdata[0] = omegap;
-                userdata[1] = gamma_;
-                caps_set_epsilonm1(caps, caps_epsilonm1_drude, userdata);
-            }
-
-            logdet = caps_logdetD(caps, xi_, m);
-            TERMINATE(isnan(logdet), "L/R=%.16g, xi_=%.16g, m=%d, ldim=%d", LbyR, xi_, m, ldim);
-        }
-
-        MPI_Isend(&logdet, 1, MPI_DOUBLE, 0, 0, master_comm, &request);
-        caps_free(caps);
-
-        if(material != NULL)
-            material_free(material);
-        MPI_Wait(&request, &status);
-    }
-}
-
 void usage(FILE *stream)
 {
     fprintf(stream,
@@ -997,19 +1936,38 @@ void usage(FILE *stream)
 "        --ldim. (default: eta=%g)\n"
 "\n"
 "    -c, --cutoff CUTOFF\n"
-"        Stop summation over m for a given value of ξ if\n"
-"            logdet(1-M^m(ξ))/logdet(1-M^0(ξ) < CUTOFF.\n"
-"        (default: %g)\n"
+"        Stop summation over m for a given value of ξ once the remainder\n"
+"        estimated from the geometric decay of the last terms is smaller than\n"
+"        CUTOFF relative to the sum. (default: %g)\n"
 "\n"
 "    -e, --epsrel EPSREL\n"
 "       Request relative accuracy of EPSREL for integration over xi if T=0, or\n"
-"       stop criterion logdetD(n)/logdetD(n=0) < EPSREL for T>0.\n"
+"       for the remainder of the sum over the Matsubara frequencies if T>0.\n"
 "       (default: %g)\n"
 "\n"
 "    -i, --iepsrel IEPSREL\n"
 "       Set relative accuracy of integration over k for the matrix elements to\n"
 "       IEPSREL. (default: %g)\n"
 "\n"
+"    --accuracy ACCURACY\n"
+"        Plan an error budget for the relative accuracy ACCURACY of the result:\n"
+"        %g of it go to the integration over xi (--epsrel), %g to the sums\n"
+"        over m (--cutoff), %g to the integrals of the matrix elements\n"
+"        (--iepsrel), and %g to the tolerance of HODLR. Options given\n"
+"        explicitly are kept; CUTOFF is at most EPSREL/%d. The accuracy of\n"
+"        the integrals is loosened for terms of the sums over m that\n"
+"        contribute little. The predicted error of every stage is printed\n"
+"        with the result; the error due to the truncation ldim is not\n"
+"        included.\n"
+"\n"
+"    --window EPS\n"
+"        Compute every determinant only for the window of angular momenta l\n"
+"        that contributes to it: values of l at both ends of the range are\n"
+"        discarded as long as their diagonal elements of the round-trip matrix\n"
+"        change logdetD by less than EPS relative to its trace estimate. EPS\n"
+"        should be chosen well below the desired accuracy. (default: 0, i.e.,\n"
+"        disabled)\n"
+"\n"
 "    -F, --fcqs\n"
 "      Use Fourier-Chebshev quadrature scheme to compute integral over xi. This\n"
 "      is usually faster than using Gauss-Kronrod. (only for T=0; experimental)\n"
@@ -1043,6 +2001,46 @@ void usage(FILE *stream)
 "        Use Pade spectrum decomposition (PSD) of order N. In contrast to the\n"
 "        option --psd, you can chose the order N of the PSD. (experimental)\n"
 "\n"
+"    --temperatures T1,T2,...\n"
+"        Compute the free energy for a list of temperatures (in K; T=0 is\n"
+"        allowed) from a single Chebyshev surrogate of logdetD(ξ). The\n"
+"        surrogate is sampled adaptively until its estimated error is smaller\n"
+"        than EPSREL times max|logdetD|. Use --psd or --psd-order to evaluate\n"
+"        the sums using the PSD. The sampled values may be reused with\n"
+"        --resume. (experimental)\n"
+"\n"
+"    --L-list L1,L2,...\n"
+"        Compute the free energy for a list of separations (in m) in a single\n"
+"        run; -L is ignored. The tasks of all separations are distributed to\n"
+"        the workers together. For every separation a Chebyshev surrogate of\n"
+"        logdetD(ξ) is sampled as for --temperatures, and a line is printed as\n"
+"        soon as the free energy for a separation is known. (experimental)\n"
+"\n"
+"    --L-cheb LMIN,LMAX,N[,M]\n"
+"        Same as --L-list for N separations at the Chebyshev nodes in log(L)\n"
+"        on [LMIN,LMAX]. In addition, the interpolated energy E(L) and its\n"
+"        derivative dE/dL are printed at M logarithmically spaced separations.\n"
+"        (default: M=100; experimental)\n"
+"\n"
+"    --force\n"
+"        Compute the Casimir force F=-dE/dL instead of the free energy. The\n"
+"        derivatives of logdetD with respect to L are computed directly from\n"
+"        the derivatives of the matrix elements using a dense LU decomposition;\n"
+"        for ξ=0 finite differences are used. (experimental)\n"
+"\n"
+"    --gradient\n"
+"        Same as --force, but also compute the force gradient dF/dL. This\n"
+"        needs a second pass over the Matsubara frequencies. (experimental)\n"
+"\n"
+"    --sphere-sphere\n"
+"        Also compute the Casimir energy E_ss of two spheres of radius R at\n"
+"        separation d=2L (same as cass). By mirror symmetry the round-trip\n"
+"        operator of the two spheres is M², where M is the round-trip operator\n"
+"        of the plane-sphere geometry, and log det(1-M²) = log det(1-M) +\n"
+"        log det(1+M) is obtained from the same matrix elements as logdetD.\n"
+"        E_ss*d/(hbar*c) is printed as an additional column. (only for perfect\n"
+"        reflectors and T=0)\n"
+"\n"
 "    -v, --verbose\n"
 "        Also print results for each m.\n"
 "\n"
@@ -1051,5 +2049,5 @@ void usage(FILE *stream)
 "\n"
 "    -h, --help\n"
 "        Show this help.\n",
-    LDIM_MIN, ETA, CUTOFF, EPSREL, CAPS_EPSREL);
+    LDIM_MIN, ETA, CUTOFF, EPSREL, CAPS_EPSREL, BUDGET_XI, BUDGET_M, BUDGET_INT, BUDGET_HODLR, CUTOFF_RATIO);
 }
@@ -1,5 +1,6 @@
 #include <getopt.h>
 #include <math.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,15 +30,34 @@ static void usage(FILE *stream)
 "    -l, --ldim LDIM\n"
 "        Set ldim to LDIM.\n"
 "\n"
+"    --ldim-sequence LDIM1,LDIM2,...\n"
+"        Compute logdet for every truncation LDIM1, LDIM2, ... to check the\n"
+"        convergence with respect to ldim. The matrix elements are shared and\n"
+"        dense algorithms need a single factorization. Only for xi>0.\n"
+"\n"
 "    -f, --material FILENAME\n"
 "        Use material described by FILENAME.\n"
 "\n"
 "    -d, --detalg DETALG\n"
-"        Compute the matrix using DETALG (LU, QR, CHOLESKY, HODLR)\n"
+"        Compute the matrix using DETALG (LU, QR, CHOLESKY, HODLR, AUTO)\n"
+"        AUTO (default) chooses between CHOLESKY and HODLR using a cost model.\n"
 "\n"
 "    -i, --iepsrel IEPSREL\n"
 "        Relative accuracy to evaluate integrals\n"
 "\n"
+"    --hodlr-table FILENAME\n"
+"        Choose the size of the leaves of the HODLR tree using the tuning\n"
+"        table FILENAME.\n"
+"\n"
+"    --hodlr-tune\n"
+"        Tuning mode: if the tuning table has no entry for ldim and m, find\n"
+"        the optimal size of the leaves by measurement and add it to the\n"
+"        table. Requires --hodlr-table.\n"
+"\n"
+"    --hodlr-stats\n"
+"        Print ranks of the off-diagonal blocks for every level of the HODLR\n"
+"        tree and the times for assembly and factorization.\n"
+"\n"
 "    -h,--help\n"
 "        Show this help.\n"
 "\n"
@@ -46,20 +66,27 @@ static void usage(FILE *stream)
 "   CAPS_DUMP:\n"
 "        If this variable is set, the round-trip matrix will be dumped in numpy\n"
 "        format to the filename contained in CAPS_DUMP. Please note that the\n"
-"        round-trip matrix will only be dumped if detalg is QR, LU or CHOLESKY.\n"
+"        round-trip matrix will only be dumped if a dense algorithm is used.\n"
+"        For m=0 the polarization blocks EE and MM are computed separately and\n"
+"        only the block MM will be dumped.\n"
 "\n"
 "   CAPS_CACHE_ELEMS:\n"
-"        Determines the size of the cache for the integrals I."
-"\n");
+"        Determines the size of the cache for the integrals I.\n"
+"\n"
+"   CAPS_HODLR_TABLE:\n"
+"        Filename of a tuning table for HODLR that is read if --hodlr-table is\n"
+"        not given.\n");
 }
 
 int main(int argc, char *argv[])
 {
     double iepsrel = 0;
     double start_time = now();
-    detalg_t detalg = DETALG_HODLR;
+    detalg_t detalg = DETALG_AUTO;
 
     char filename[512] = { 0 };
+    char hodlr_table[512] = { 0 };
+    bool hodlr_tune = false, hodlr_stats = false;
 
     /* geometry, Matsubara frequency */
     double L = 0, R = 0, xi_ = -1;
@@ -68,6 +95,11 @@ int main(int argc, char *argv[])
     /* numerical parameters */
     int ldim = 0;
 
+    /* sequence of truncations */
+    char ldims_str[512] = { 0 };
+    int ldims[64] = { 0 };
+    int n_ldims = 0;
+
     while(1)
     {
         struct option long_options[] = {
@@ -78,6 +110,11 @@ int main(int argc, char *argv[])
             { "material",  required_argument, 0, 'f' },
             { "xi",        required_argument, 0, 'x' },
             { "ldim",      required_argument, 0, 'l' },
+            { "ldim-sequence", required_argument, 0, 'n' },
+
+            { "hodlr-table", required_argument, 0, 't' },
+            { "hodlr-tune",  no_argument,       0, 'u' },
+            { "hodlr-stats", no_argument,       0, 's' },
 
             { 0, 0, 0, 0 }
         };
@@ -106,6 +143,32 @@ int main(int argc, char *argv[])
             case 'l':
                 ldim = atoi(optarg);
                 break;
+            case 'n':
+                /* strtok modifies its argument; keep argv intact */
+                if(strlen(optarg) >= sizeof(ldims_str))
+                {
+                    fprintf(stderr, "Argument of --ldim-sequence too long (at most %zu characters)\n\n", sizeof(ldims_str)-1);
+                    usage(stderr);
+                    exit(1);
+                }
+                strncpy(ldims_str, optarg, sizeof(ldims_str)-sizeof(char));
+                for(char *token = strtok(ldims_str, ","); token != NULL; token = strtok(NULL, ","))
+                {
+                    if(n_ldims >= (int)(sizeof(ldims)/sizeof(ldims[0])))
+                    {
+                        fprintf(stderr, "Too many values for --ldim-sequence (at most %zu)\n\n", sizeof(ldims)/sizeof(ldims[0]));
+                        usage(stderr);
+                        exit(1);
+                    }
+                    ldims[n_ldims] = atoi(token);
+                    if(ldims[n_ldims++] <= 0)
+                    {
+                        fprintf(stderr, "Invalid value for ldim: %s\n\n", token);
+                        usage(stderr);
+                        exit(1);
+                    }
+                }
+                break;
             case 'm':
                 m = atoi(optarg);
                 break;
@@ -121,6 +184,8 @@ int main(int argc, char *argv[])
                     detalg = DETALG_QR;
                 else if(strcasecmp(optarg, "CHOLESKY") == 0)
                     detalg = DETALG_CHOLESKY;
+                else if(strcasecmp(optarg, "AUTO") == 0)
+                    detalg = DETALG_AUTO;
                 else
                 {
                     fprintf(stderr, "Unknown algorithm: %s\n\n", optarg);
@@ -131,6 +196,15 @@ int main(int argc, char *argv[])
             case 'i':
                 iepsrel = atof(optarg);
                 break;
+            case 't':
+                strncpy(hodlr_table, optarg, sizeof(hodlr_table)-sizeof(char));
+                break;
+            case 'u':
+                hodlr_tune = true;
+                break;
+            case 's':
+                hodlr_stats = true;
+                break;
             case 'h':
                 usage(stdout);
                 exit(0);
@@ -157,6 +231,10 @@ int main(int argc, char *argv[])
             fprintf(stderr, "--xi must be non-negative value.");
         else if(m < 0)
             fprintf(stderr, "m >= 0\n\n");
+        else if(hodlr_tune && strlen(hodlr_table) == 0)
+            fprintf(stderr, "--hodlr-tune requires --hodlr-table");
+        else if(n_ldims > 0 && xi_ == 0)
+            fprintf(stderr, "--ldim-sequence requires xi>0");
         else
             /* everything ok */
             break;
@@ -199,12 +277,36 @@ int main(int argc, char *argv[])
 
     caps_set_detalg(caps, detalg);
 
+    if(strlen(hodlr_table) > 0 && caps_set_hodlr_tuning(caps, hodlr_table, hodlr_tune) < 0)
+    {
+        fprintf(stderr, "Can't read %s\n", hodlr_table);
+        exit(1);
+    }
+
     caps_info(caps, stdout, "# ");
     printf("#\n");
 
-    if(xi_ > 0)
+    if(n_ldims > 0)
     {
-        double logdet = caps_logdetD(caps, xi_, m);
+        double logdets[64];
+        caps_logdetD_sequence(caps, xi_, m, ldims, n_ldims, logdets);
+
+        printf("# L, R, ξ*(L+R)/c, m, logdet(Id-M), ldim, time\n");
+        for(int k = 0; k < n_ldims; k++)
+            printf("%g, %g, %g, %d, %.16g, %d, %g\n", L, R, xi_, m, logdets[k], ldims[k], now()-start_time);
+    }
+    else if(xi_ > 0)
+    {
+        hodlr_stats_t stats;
+        double logdet = caps_logdetD_stats(caps, xi_, m, &stats);
+
+        if(hodlr_stats && stats.n_levels > 0)
+        {
+            printf("# HODLR: nLeaf=%u, levels=%d, assembly=%gs, factorization=%gs\n", stats.nLeaf, stats.n_levels, stats.t_assemble, stats.t_factorize);
+            printf("# level, size of blocks, mean rank, max rank\n");
+            for(int j = 0; j < stats.n_levels && j < HODLR_STATS_LEVELS; j++)
+                printf("# %d, %g, %g, %d\n", j, stats.size[j], stats.rank_mean[j], stats.rank_max[j]);
+        }
 
         printf("# L, R, ξ*(L+R)/c, m, logdet(Id-M), ldim, time\n");
         printf("%g, %g, %g, %d, %.16g, %d, %g\n", L, R, xi_, m, logdet, caps_get_ldim(caps), now()-start_time);
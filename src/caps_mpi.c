@@ -0,0 +1,469 @@
+#include <math.h>
+#include <mpi.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "caps_mpi.h"
+
+#include "constants.h"
+#include "libcaps.h"
+#include "material.h"
+#include "matrix.h"
+#include "misc.h"
+#include "utils.h"
+
+/* Distribution of the terms (ξ,m) of the sums over the Matsubara frequencies
+ * and over m to MPI worker processes. The master submits tasks to idle
+ * workers by caps_mpi_submit and collects the results by caps_mpi_retrieve;
+ * the workers run slave. The scheduler is shared by caps and cass.
+ */
+
+#define STATE_RUNNING 1
+#define STATE_IDLE    0
+
+/* @brief Create caps_mpi object
+ *
+ * @param [in] L separation between sphere and plate in meter
+ * @param [in] R radius of sphere in meter
+ * @param [in] T temperature in Kelvin
+ * @param [in] filename filename of material description or NULL
+ * @param [in] resume filename of partial output to be resumed
+ * @param [in] omegap plasma frequency of the Drude model in eV
+ * @param [in] gamma_ relaxation frequency of the Drude model eV
+ * @param [in] ldim dimension of vector space
+ * @param [in] cutoff cutoff for summation over m
+ * @param [in] iepsrel relative accuracy for integration of k for matrix elements
+ * @param [in] cores number of cores to use
+ * @param [in] verbose flag if verbose
+ * @retval object caps_mpi_t object
+ */
+caps_mpi_t *caps_mpi_init(double L, double R, double T, const char *filename, const char *resume, double omegap, double gamma_, int ldim, double cutoff, double iepsrel, int cores, bool verbose)
+{
+    caps_mpi_t *self = xmalloc(sizeof(caps_mpi_t));
+
+    self->L       = L;
+    self->R       = R;
+    self->T       = T;
+    self->omegap  = omegap;
+    self->gamma   = gamma_;
+    self->ldim    = ldim;
+    self->cutoff  = cutoff;
+    self->iepsrel = iepsrel;
+    self->cores   = cores;
+    self->verbose = verbose;
+    self->tasks   = xmalloc(cores*sizeof(caps_task_t *));
+    self->alpha   = 2*L/(L+R); /* used to scale integration if T=0 */
+    self->derivative = 0;
+
+    /* number of determinants we have computed */
+    self->determinants = 0;
+    self->tail_m = 0;
+
+    /* adaptive truncation window (disabled) */
+    self->window = 0;
+    self->dim_full = self->dim_window = 0;
+
+    /* error budget (not planned) */
+    self->accuracy = 0;
+    self->hodlr_eps = KERNEL_LOGDET_TOLERANCE;
+    self->err_xi = self->err_int = 0;
+
+    /* frequencies that do not contribute, see _F_xi_batch */
+    self->scale_elems = self->scale_next = 0;
+    self->skipped = 0;
+
+    /* sphere-sphere geometry (disabled) */
+    self->sphere_sphere = false;
+    self->ss_xi = self->ss_logdetD2 = NULL;
+
+    /* both MM blocks at ξ=0 (disabled), see F_HT */
+    self->ht_pr = false;
+
+    TERMINATE(strlen(filename) > 511, "filename too long: %s", filename);
+    memset(self->filename, '\0', sizeof(self->filename));
+    strncpy(self->filename, filename, sizeof(self->filename)-sizeof(char));
+
+    /* cache for resume */
+    self->cache_elems = 0;
+    if(resume && strlen(resume) > 0)
+    {
+        char line[512];
+        FILE *fh = fopen(resume, "r");
+        TERMINATE(fh == NULL, "cannot open %s for reading", resume);
+
+        while(fgets(line, sizeof(line)/sizeof(char), fh) != NULL)
+        {
+            char *p1 = strstr(line, "# xi*(L+R)/c=");
+            char *p2 = strstr(line, "logdetD=");
+            if(p1 && p2)
+            {
+                char *p3;
+
+                p1 += 13;
+                p3 = strchr(p1, ',');
+                TERMINATE(p3 == NULL, "%s has wrong format", resume);
+                *p3 = '\0';
+                self->cache[self->cache_elems][0] = atof(p1); /* xi */
+
+                p2 += 8;
+                p3 = strchr(p2, ',');
+                TERMINATE(p3 == NULL, "%s has wrong format", resume);
+                *p3 = '\0';
+                self->cache[self->cache_elems][1] = atof(p2); /* logdetD */
+
+                self->cache_elems++;
+            }
+        }
+
+        fclose(fh);
+    }
+
+    self->tasks[0] = NULL;
+    for(int i = 1; i < cores; i++)
+    {
+        caps_task_t *task = xmalloc(sizeof(caps_task_t));
+        task->index    = -1;
+        task->state    = STATE_IDLE;
+        self->tasks[i] = task;
+    }
+
+    return self;
+}
+
+/** @brief Stop all workers
+ *
+ * Send the signal to quit to the workers 1,...,cores-1.
+ *
+ * @param [in] cores number of processes
+ */
+void caps_mpi_stop(int cores)
+{
+    double buf[] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+
+    for(int i = 1; i < cores; i++)
+        MPI_Send(buf, 14, MPI_DOUBLE, i, 0, MPI_COMM_WORLD);
+}
+
+/** @brief Free mpi object
+ *
+ * Stop all running jobs and free allocated memory.
+ *
+ * @param [in] self caps_mpit_t object
+ */
+void caps_mpi_free(caps_mpi_t *self)
+{
+    caps_mpi_stop(self->cores);
+
+    for(int i = 1; i < self->cores; i++)
+        xfree(self->tasks[i]);
+
+    xfree(self->tasks);
+    xfree(self);
+}
+
+/** @brief Get number of running jobs
+ *
+ * @param [in] self caps_mpit_t object
+ * @retval running number of processes that are running
+ */
+int caps_mpi_get_running(caps_mpi_t *self)
+{
+    int running = 0;
+
+    for(int i = 1; i < self->cores; i++)
+        if(self->tasks[i]->state == STATE_RUNNING)
+            running++;
+
+    return running;
+}
+
+/* xi_ = ξ(L+R)/c; for m=0 and xi_>0, block selects the polarization block
+ * EE (0) or MM (1) that is computed, otherwise block is -1 */
+int caps_mpi_submit(caps_mpi_t *self, int index, double xi_, int m, int block)
+{
+    return caps_mpi_submit_L(self, index, self->L, self->ldim, self->iepsrel, xi_, m, block);
+}
+
+/* same as caps_mpi_submit, but for the separation L, the dimension ldim and
+ * the accuracy iepsrel of the integrals instead of the values of self; xi_ =
+ * ξ(L+R)/c */
+int caps_mpi_submit_L(caps_mpi_t *self, int index, double L, int ldim, double iepsrel, double xi_, int m, int block)
+{
+    for(int i = 1; i < self->cores; i++)
+    {
+        caps_task_t *task = self->tasks[i];
+
+        if(task->state == STATE_IDLE)
+        {
+            double buf[] = { xi_, L, self->R, self->omegap, self->gamma, m, iepsrel, ldim, block, self->derivative, self->window, self->hodlr_eps, self->sphere_sphere, self->ht_pr };
+
+            task->index = index;
+            task->xi_   = xi_;
+            task->iepsrel = iepsrel;
+            task->m     = m;
+            task->block = block;
+            task->state = STATE_RUNNING;
+
+            MPI_Send (buf,             14, MPI_DOUBLE, i, 0, MPI_COMM_WORLD);
+            MPI_Send (self->filename, 512, MPI_CHAR,   i, 0, MPI_COMM_WORLD);
+            MPI_Irecv(task->recv,      4,  MPI_DOUBLE, i, 0, MPI_COMM_WORLD, &task->request);
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/** @brief Get number of computed determinants
+ *
+ * Get the number of determinants that have been computed.
+ *
+ * @param [in] self caps_mpit_t object
+ * @retval determinants number of computed determinants
+ */
+int caps_get_determinants(caps_mpi_t *self)
+{
+    return self->determinants;
+}
+
+/* retrieve a finished task; returns 0 if no task has finished */
+int caps_mpi_retrieve(caps_mpi_t *self, caps_task_t **task_out)
+{
+    *task_out = NULL;
+
+    for(int i = 1; i < self->cores; i++)
+    {
+        caps_task_t *task = self->tasks[i];
+
+        if(task->state == STATE_RUNNING)
+        {
+            int flag = 0;
+            MPI_Status status;
+
+            MPI_Test(&task->request, &flag, &status);
+
+            if(flag)
+            {
+                MPI_Wait(&task->request, &status);
+
+                task->value = task->recv[0];
+                task->value2 = task->recv[3];
+                task->state = STATE_IDLE;
+                self->determinants += 1;
+                self->dim_full   += task->recv[1];
+                self->dim_window += task->recv[2];
+
+                *task_out = self->tasks[i];
+
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/* Store the result value of a task in terms. For m=0 the contributions of
+ * the polarization blocks EE and MM may be computed by separate tasks; they
+ * are collected in terms0 and terms[0] is set once both are available.
+ * Returns the term of the task or NAN if the term is not complete yet. */
+double caps_mpi_store_term(double terms[], double terms0[2], caps_task_t *task, double value)
+{
+    if(task->block < 0)
+        return terms[task->m] = value;
+
+    terms0[task->block] = value;
+    if(isnan(terms0[0]) || isnan(terms0[1]))
+        return NAN;
+
+    return terms[0] = terms0[0]+terms0[1];
+}
+
+
+/* context of a worker for a geometry and a material; the caps object and the
+ * material are kept across tasks, so a worker that computes tasks for several
+ * separations (see --L-list) does not set them up again for every task */
+typedef struct {
+    double L, R, omegap, gamma_;
+    int ldim;
+    char filename[512];
+    caps_t *caps;
+    material_t *material;
+    double userdata[2];
+} worker_context_t;
+
+#define WORKER_CONTEXTS 32 /* number of contexts kept by a worker */
+
+static void _worker_context_free(worker_context_t *context)
+{
+    if(context->caps != NULL)
+        caps_free(context->caps);
+    if(context->material != NULL)
+        material_free(context->material);
+
+    context->caps = NULL;
+    context->material = NULL;
+}
+
+/* Return the context for the given parameters. If it does not exist yet, the
+ * least recently created context is replaced. omegap and gamma_ in rad/s. */
+static worker_context_t *_worker_context(worker_context_t contexts[], int *next, double L, double R, double omegap, double gamma_, int ldim, const char *filename)
+{
+    for(int i = 0; i < WORKER_CONTEXTS; i++)
+    {
+        worker_context_t *context = &contexts[i];
+
+        if(context->caps != NULL && context->L == L && context->R == R &&
+           context->ldim == ldim &&
+           context->omegap == omegap && context->gamma_ == gamma_ &&
+           strcmp(context->filename, filename) == 0)
+            return context;
+    }
+
+    worker_context_t *context = &contexts[*next];
+    *next = (*next+1) % WORKER_CONTEXTS;
+
+    _worker_context_free(context);
+
+    context->L       = L;
+    context->R       = R;
+    context->omegap  = omegap;
+    context->gamma_  = gamma_;
+    context->ldim    = ldim;
+    snprintf(context->filename, sizeof(context->filename), "%s", filename);
+
+    context->caps = caps_init(R,L);
+    TERMINATE(context->caps == NULL, "caps object is null");
+    caps_set_ldim(context->caps, ldim);
+
+    /* set material properties; not used for xi=0 */
+    if(strlen(filename))
+    {
+        context->material = material_init(filename, L+R);
+        TERMINATE(context->material == NULL, "material_init failed");
+        caps_set_epsilonm1(context->caps, material_epsilonm1, context->material);
+    }
+    else if(!isinf(omegap))
+    {
+        context->userdata[0] = omegap;
+        context->userdata[1] = gamma_;
+        caps_set_epsilonm1(context->caps, caps_epsilonm1_drude, context->userdata);
+    }
+
+    return context;
+}
+
+void slave(MPI_Comm master_comm, int rank)
+{
+    char filename[512] = { 0 };
+    double buf[14] = { 0 };
+    worker_context_t contexts[WORKER_CONTEXTS];
+    int next = 0;
+
+    MPI_Status status;
+    MPI_Request request;
+
+    memset(contexts, 0, sizeof(contexts));
+
+    while(1)
+    {
+        double logdet = NAN;
+        size_t dim_full0, dim_window0, dim_full1, dim_window1;
+
+        memset(buf,      0, sizeof(buf));
+        memset(filename, 0, sizeof(filename));
+
+        MPI_Recv(buf, 14, MPI_DOUBLE, 0, 0, master_comm, &status);
+
+        /* Matsubara frequency; xi_ = ξ(L+R)/c */
+        const double xi_ = buf[0];
+
+        /* signal to quit */
+        if(xi_ < 0)
+            break;
+
+        /* geometry */
+        const double L = buf[1]; /* in m */;
+        const double R = buf[2]; /* in m */
+        const double LbyR = L/R;
+
+        const double omegap = buf[3]/CAPS_hbar_eV; /* plasma frequency in rad/s */
+        const double gamma_ = buf[4]/CAPS_hbar_eV; /* relaxation frequency in rad/s */
+
+        const int m          = (int)buf[5];
+        const double iepsrel = buf[6];
+        const int ldim       = (int)buf[7];
+        const int block      = (int)buf[8]; /* -1: all, 0: EE, 1: MM (only m=0) */
+        const int derivative = (int)buf[9]; /* (L+R)^k ∂_L^k logdetD, see caps_mpi_t */
+        const double window  = buf[10];     /* tolerance of adaptive truncation window */
+        const double hodlr_eps = buf[11];   /* relative tolerance of HODLR */
+        const bool sphere_sphere = buf[12]; /* also compute log det(1-M²) */
+        const bool ht_pr = buf[13];         /* ξ=0: MM blocks of perfect reflectors and plasma */
+        double logdet2 = 0;
+
+        /* get filename */
+        MPI_Recv(filename, 512, MPI_CHAR, 0, 0, master_comm, &status);
+
+        /* for xi=0 the material is given by omegap only */
+        caps_t *caps = _worker_context(contexts, &next, L, R, omegap, gamma_, ldim, xi_ == 0 ? "" : filename)->caps;
+
+        /* the accuracies may change from task to task, see --accuracy */
+        caps_set_epsrel(caps, iepsrel > 0 ? iepsrel : CAPS_EPSREL);
+        kernel_logdet_set_tolerance(hodlr_eps);
+        caps_set_window(caps, window);
+        caps_get_window_stats(caps, &dim_full0, &dim_window0);
+
+        /* high-temperature case */
+        if(xi_ == 0)
+        {
+            if(ht_pr)
+                /* MM modes of PR and plasma */
+                caps_logdetD0(caps, m, omegap, NULL, &logdet, &logdet2);
+            else if(isinf(omegap))
+                /* MM mode of PR */
+                caps_logdetD0(caps, m, 0, NULL, &logdet, NULL);
+            else
+                /* plasma */
+                caps_logdetD0(caps, m, omegap, NULL, NULL, &logdet);
+        }
+        else
+        {
+            if(derivative == 1)
+                logdet = (L+R)*caps_dlogdetD_dL(caps, xi_, m, NULL);
+            else if(derivative == 2)
+            {
+                caps_dlogdetD_dL(caps, xi_, m, &logdet);
+                logdet *= pow_2(L+R);
+            }
+            else if(sphere_sphere)
+            {
+                /* log det(1-M²) = log det(1-M) + log det(1+M) */
+                double plus;
+                logdet  = caps_logdetD_pm(caps, xi_, m, block, &plus);
+                logdet2 = logdet+plus;
+            }
+            else if(block == 0)
+                caps_logdetD_m0(caps, xi_, &logdet, NULL);
+            else if(block == 1)
+                caps_logdetD_m0(caps, xi_, NULL, &logdet);
+            else
+                logdet = caps_logdetD(caps, xi_, m);
+            TERMINATE(isnan(logdet), "L/R=%.16g, xi_=%.16g, m=%d, ldim=%d", LbyR, xi_, m, ldim);
+        }
+
+        /* dimensions of the matrices of this task and of their windows */
+        caps_get_window_stats(caps, &dim_full1, &dim_window1);
+        double reply[] = { logdet, dim_full1-dim_full0, dim_window1-dim_window0, logdet2 };
+
+        MPI_Isend(reply, 4, MPI_DOUBLE, 0, 0, master_comm, &request);
+        MPI_Wait(&request, &status);
+    }
+
+    for(int i = 0; i < WORKER_CONTEXTS; i++)
+        _worker_context_free(&contexts[i]);
+}
+
@@ -1,9 +1,14 @@
+#define _DEFAULT_SOURCE /* make usleep work */
+
+#include <mpi.h>
 #include <stdio.h>
 #include <math.h>
+#include <unistd.h>
 
 #include "argparse.h"
 #include "cquadpack.h"
 
+#include "caps_mpi.h"
 #include "constants.h"
 #include "libcaps.h"
 #include "misc.h"
@@ -12,84 +17,126 @@
  * perfect reflectors. It is assumed that both spheres have the same radius
  * R=R1=R2.
  *
+ * The contributions of the Matsubara frequencies ξ and the azimuthal quantum
+ * numbers m are computed by worker processes if the program is started with
+ * mpirun; the tasks are distributed by the scheduler of caps (caps_mpi.h).
+ * Without mpirun the program runs serially.
+ *
  * For more information see the user manual.
  */
 
+#define IDLE 25 /**< idle time in ms */
+
 typedef struct {
     double cutoff;
+    int cores;
     caps_t *self;
+    caps_mpi_t *caps_mpi;
 } args_t;
 
-static double logdetD2(caps_t *caps, int m, double xi_)
+/* Compute log det(Id-M²) where M² is the round-trip operator in the
+ * sphere-sphere geometry. As Id-M² = (Id-M)(Id+M), the determinant is given
+ * by two determinants of the round-trip matrix M of the sphere-plane
+ * geometry that are computed from the same matrix elements, see
+ * caps_logdetD_pm. For m=0 the polarizations EE and MM decouple.
+ *
+ * If |tr M| < 1e-8, both determinants are given by the trace approximation
+ * ±tr(M) and the sum vanishes; the correct value is of order tr(M)² < 1e-16.
+ */
+static double logdetD2(caps_t *caps, int m, double xi_, int block)
 {
-    size_t lmin, lmax;
-    caps_estimate_lminmax(caps, m, &lmin, &lmax);
-    int ldim = lmax-lmin;
+    double plus;
+    const double minus = caps_logdetD_pm(caps, xi_, m, block, &plus);
+
+    return minus+plus;
+}
 
-    matrix_t *M = matrix_alloc(2*ldim);
-    matrix_setall(M, NAN);
+/* Compute the terms m=0,1,2,... of the sum over m using the workers. Tasks
+ * are submitted in the order of m (m=0 as two tasks for the blocks EE and
+ * MM); no further tasks are submitted once a term is smaller than cutoff
+ * relative to the term m=0, but all running tasks are collected. */
+static void _terms_mpi(args_t *args, double xi_, double terms[], int mmax)
+{
+    caps_mpi_t *caps_mpi = args->caps_mpi;
+    double terms0[2] = { NAN, NAN };
+    terms[0] = NAN;
 
-    /* compute the round-trip matrix M of the sphere-plane geometry */
-    caps_M_t *self = caps_M_init(caps, m, xi_);
-    for(int i = 0; i < ldim; i++)
+    for(int m = 0; m < mmax; m++)
     {
-        const int l1 = i+lmin;
-        for(int j = 0; j < ldim; j++)
+        const int blocks = (m == 0) ? 2 : 1;
+
+        for(int block = 0; block < blocks; block++)
         {
-            const int l2 = j+lmin;
-            
-            matrix_set(M, i, j,           caps_M_elem(self, l1, l2, 'E', 'E'));
-            matrix_set(M, i, j+ldim,      caps_M_elem(self, l1, l2, 'E', 'M'));
-            matrix_set(M, i+ldim, j,      caps_M_elem(self, l1, l2, 'M', 'E'));
-            matrix_set(M, i+ldim, j+ldim, caps_M_elem(self, l1, l2, 'M', 'M'));
+            while(1)
+            {
+                caps_task_t *task = NULL;
+
+                /* send job */
+                if(caps_mpi_submit(caps_mpi, m, xi_, m, blocks == 2 ? block : -1))
+                    break;
+
+                /* retrieve jobs; the second quantity of a task is
+                 * log det(1-M²), see caps_mpi_t.sphere_sphere */
+                while(caps_mpi_retrieve(caps_mpi, &task))
+                {
+                    const double v = caps_mpi_store_term(terms, terms0, task, task->value2);
+
+                    if(v == 0 || v/terms[0] < args->cutoff)
+                        goto done;
+                }
+
+                usleep(IDLE);
+            }
         }
     }
-    caps_M_free(self);
 
-    /* M2 = M² = M*M: round-trip operator in the sphere-sphere geometry */
-    matrix_t *M2 = matrix_mult(M, M, 1);
-    matrix_free(M);
+    TERMINATE(true, "sum did not converge, sorry. :(");
 
-    /* check if we can use the trace approximation: logdet(1-A) =~ trace(A) */
-    double trace2 = matrix_trace(M2);
-    if(trace2 < 1e-8)
-        return -trace2;
+    done:
 
-    /* logdet(Id-M²) */
-    double logdet2 = matrix_logdet_dense(M2, -1, DETALG_LU);
+    /* retrieve all remaining running jobs */
+    while(caps_mpi_get_running(caps_mpi) > 0)
+    {
+        caps_task_t *task = NULL;
 
-    matrix_free(M2);
+        while(caps_mpi_retrieve(caps_mpi, &task))
+            caps_mpi_store_term(terms, terms0, task, task->value2);
 
-    return logdet2;
+        usleep(IDLE);
+    }
 }
 
 /* d = 2*L */
 static double integrand(double xidbyc, void *args_)
 {
+    const double t0 = now();
     args_t *args = (args_t *)args_;
     caps_t *self = args->self;
     double xi_ = xidbyc*(self->L+self->R)/(2*self->L);
     double terms[4096] = { 0 };
+    const int mmax = sizeof(terms)/sizeof(terms[0]);
 
-    double cutoff = args->cutoff;
-
-    for(unsigned int m = 0; m < sizeof(terms)/sizeof(terms[0]); m++)
+    if(args->cores > 1)
+        _terms_mpi(args, xi_, terms, mmax);
+    else
     {
-        terms[m] = logdetD2(self, m, xi_);
-        //printf("m=%d, xi_=%g, %g\n", m, xi_, terms[m]);
+        for(int m = 0; m < mmax; m++)
+        {
+            terms[m] = logdetD2(self, m, xi_, -1);
 
-        if(terms[m] == 0 || terms[m]/terms[0] < cutoff)
-            break;
+            if(terms[m] == 0 || terms[m]/terms[0] < args->cutoff)
+                break;
+        }
     }
 
-    double logdet = 2*kahan_sum(terms, sizeof(terms)/sizeof(terms[0]))-terms[0];
+    double logdet = 2*kahan_sum(terms, mmax)-terms[0];
 
-    printf("# xi*d/c=%.12g, logdet=%.12g\n", xidbyc, logdet);
+    printf("# xi*d/c=%.12g, logdet=%.12g, t=%g\n", xidbyc, logdet, now()-t0);
 
     return logdet;
 }
 
-int main(int argc, const char *argv[])
+static int master(int argc, const char *argv[], int cores)
 {
     double R = NAN, d = NAN;
     double cutoff = 1e-10;
@@ -196,17 +243,23 @@ int main(int argc, const char *argv[])
     printf("# epsrel = %g\n", epsrel);
     printf("# iepsrel = %g\n", iepsrel);
     printf("# cutoff = %g\n", cutoff);
+    printf("# cores = %d\n", cores);
     printf("#\n");
 
     caps_t *self = caps_init(R, L);
 
     caps_set_epsrel(self, iepsrel);
     caps_set_ldim(self, ldim);
-    caps_set_detalg(self, DETALG_LU);
+
+    /* the workers compute log det(1-M²) for perfect reflectors */
+    caps_mpi_t *caps_mpi = caps_mpi_init(L, R, 0, "", NULL, INFINITY, 0, ldim, cutoff, iepsrel, cores, false);
+    caps_mpi->sphere_sphere = true;
 
     args_t args = {
-        .cutoff = cutoff,
-        .self   = self
+        .cutoff   = cutoff,
+        .cores    = cores,
+        .self     = self,
+        .caps_mpi = caps_mpi
     };
 
     double abserr;
@@ -222,5 +275,32 @@ int main(int argc, const char *argv[])
     printf("# R1, R2, L, E*d/(hbar*c), relative error (due to integration)\n");
     printf("%.12g, %.12g, %.12g, %.12g, %g\n", R, R, d, E_, fabs(abserr/integral));
 
+    caps_mpi_free(caps_mpi);
+    caps_free(self);
+
     return 0;
 }
+
+int main(int argc, const char *argv[])
+{
+    int cores, rank, ret = 0;
+
+    /* initialize MPI; without mpirun there is a single process */
+    MPI_Init(NULL, NULL);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &cores);
+
+    if(rank == 0)
+    {
+        /* on success, master stops the workers by caps_mpi_free */
+        ret = master(argc, argv, cores);
+        if(ret != 0)
+            caps_mpi_stop(cores);
+    }
+    else
+        slave(MPI_COMM_WORLD, rank);
+
+    MPI_Finalize();
+
+    return ret;
+}
@@ -32,6 +32,9 @@ extern "C" {
 
 typedef double(*dq_function_type)(double, void*);
 
+/* Batch of function values: fx[i] = f(x[i]) for i=0,...,n-1. */
+typedef void(*dq_batch_function_type)(int n, const double x[], double fx[], void*);
+
 /* Integration routines */
 /* Gauss-Kronrod for integration over finite range. */
 CQUADPACK_EXPORT double G_K15(dq_function_type f,double a,double b,double *abserr,
@@ -50,6 +53,8 @@ CQUADPACK_EXPORT double G_K61(dq_function_type f, double a, double b, double *ab
 /* Gauss-Kronrod for integration over infinite range. */
 CQUADPACK_EXPORT double G_K15I(dq_function_type f, double boun, int inf, double a, double b,
     double *abserr,double *resabs, double *resasc, void* user_data);
+CQUADPACK_EXPORT double G_K15I_batch(dq_batch_function_type f, double boun, int inf, double a, double b,
+    double *abserr,double *resabs, double *resasc, void* user_data);
 
 /* Gauss-Kronrod for integration of weighted function. */
 CQUADPACK_EXPORT double G_K15W(dq_function_type f, double w(), double p1, double p2, double p3,
@@ -98,6 +103,13 @@ CQUADPACK_EXPORT void dqsort(int limit, int last, int *maxerr, double *ermax,
 CQUADPACK_EXPORT double dqagi(dq_function_type f, double bound, int inf, double epsabs,
     double epsrel,double *abserr,int *neval,int *ier, void* user_data);
 
+/* DQAGI_BATCH - Same as DQAGI, but the integrand is evaluated at all
+ *    abscissae of a Gauss-Kronrod rule (15 nodes, 30 for inf=2) by a single
+ *    call of f, e.g., to evaluate the nodes in parallel.
+ */
+CQUADPACK_EXPORT double dqagi_batch(dq_batch_function_type f, double bound, int inf, double epsabs,
+    double epsrel,double *abserr,int *neval,int *ier, void* user_data);
+
 /* DQAGS - Integration over finite intervals. (From QUADPACK)
  *
  *    Adaptive integration routine which handles functions
@@ -68,6 +68,15 @@ extern "C" {
  */
 double dqagi(double f(double, void *), double bound, int inf, double epsabs, double epsrel, double *abserr, int *neval, int *ier, void *user_data);
 
+/** @brief Integration over (semi-) infinite intervals (batch version)
+ *
+ * Same as \ref dqagi, but the integrand is evaluated at all abscissae of a
+ * Gauss-Kronrod rule (15 nodes, 30 for inf=2) by a single call of f.
+ * f(n, x, fx, user_data) must store the values of the integrand at the n
+ * nodes x in fx.
+ */
+double dqagi_batch(void f(int, const double[], double[], void *), double bound, int inf, double epsabs, double epsrel, double *abserr, int *neval, int *ier, void *user_data);
+
 
 /** @brief Integration over finite intervals
  *
@@ -1,3 +1,4 @@
+#include <stddef.h>
 #include "cquadpack.h"
 
 /* DQAGI - Integration over (semi-) infinite intervals. (From QUADPACK)
@@ -35,8 +36,9 @@
  *
  *    epsrel - relative accuracy requested.
  */
-double dqagi(dq_function_type f,double bound,int inf,double epsabs,
-    double epsrel,double *abserr,int *neval,int *ier, void* user_data)
+static double _dqagi(dq_function_type f,dq_batch_function_type fb,double bound,
+    int inf,double epsabs,double epsrel,double *abserr,int *neval,int *ier,
+    void* user_data)
 {
     double abseps = 0, area = 0, area1 = 0, area12 = 0, area2 = 0, a1 = 0, a2 = 0, b1 = 0, b2 = 0;
     double boun = 0, correc = 0, defabs = 0, defab1 = 0, defab2 = 0, dres = 0, erlarg = 0;
@@ -69,7 +71,9 @@ double dqagi(dq_function_type f,double bound,int inf,double epsabs,
     boun = bound;
     if (inf == 2) boun = 0.0;
 
-    result = G_K15I(f,boun,inf,0.0,1.0,abserr,&defabs,&resabs, user_data);
+    result = (fb != NULL) ?
+        G_K15I_batch(fb,boun,inf,0.0,1.0,abserr,&defabs,&resabs, user_data) :
+        G_K15I(f,boun,inf,0.0,1.0,abserr,&defabs,&resabs, user_data);
 
 /* Test on accuracy. */
     rlist[0] = result;
@@ -111,8 +115,13 @@ double dqagi(dq_function_type f,double bound,int inf,double epsabs,
         a2 = b1;
         b2 = blist[maxerr];
         erlast = errmax;
-        area1 = G_K15I(f,boun,inf,a1,b1,&error1,&resabs,&defab1, user_data);
-        area2 = G_K15I(f,boun,inf,a2,b2,&error2,&resabs,&defab2, user_data);
+        if (fb != NULL) {
+            area1 = G_K15I_batch(fb,boun,inf,a1,b1,&error1,&resabs,&defab1, user_data);
+            area2 = G_K15I_batch(fb,boun,inf,a2,b2,&error2,&resabs,&defab2, user_data);
+        } else {
+            area1 = G_K15I(f,boun,inf,a1,b1,&error1,&resabs,&defab1, user_data);
+            area2 = G_K15I(f,boun,inf,a2,b2,&error2,&resabs,&defab2, user_data);
+        }
 
 /* Improve previous approxminations to integral and error
       and test for accuracy. */
@@ -270,3 +279,15 @@ _130:
     if (*ier > 2) (*ier)--;
     return result;
 }
+
+double dqagi(dq_function_type f,double bound,int inf,double epsabs,
+    double epsrel,double *abserr,int *neval,int *ier, void* user_data)
+{
+    return _dqagi(f,NULL,bound,inf,epsabs,epsrel,abserr,neval,ier,user_data);
+}
+
+double dqagi_batch(dq_batch_function_type f,double bound,int inf,double epsabs,
+    double epsrel,double *abserr,int *neval,int *ier, void* user_data)
+{
+    return _dqagi(NULL,f,bound,inf,epsabs,epsrel,abserr,neval,ier,user_data);
+}
@@ -1,6 +1,10 @@
+#include <stddef.h>
 #include "cquadpack.h"
 
-double G_K15I(dq_function_type f, double boun, int inf, double a, double b,
+/* The integrand is evaluated at all 15 (30 for inf=2) abscissae either by
+ * calls of f or by a single call of the batch function fb. */
+static double _G_K15I(dq_function_type f, dq_batch_function_type fb,
+    double boun, int inf, double a, double b,
     double *abserr,double *resabs,double *resasc, void* user_data)
 {
     static double XGK15[8] = {
@@ -29,16 +33,39 @@ double G_K15I(dq_function_type f, double boun, int inf, double a, double b,
     double fv1[8],fv2[8];
     double absc,absc1,absc2,centr,dinf;
     double fc,fsum,fval1,fval2,hlgth,resg,resk;
-    double reskh,result,tabsc1,tabsc2;
-    int j;
+    double reskh,result;
+    double x[30],fx[30];
+    int j,n;
 
     dinf = MIN((double)(1.0),(double)inf);
     centr = 0.5 * (a + b);
     hlgth = 0.5 * (b - a);
-    tabsc1 = boun + dinf * (1.0 - centr)/centr;
-    fval1 = (*f)(tabsc1, user_data);
+
+    /* abscissae: x[0] center, x[2j+1] and x[2j+2] the pairs of nodes;
+     * for inf=2 the negative abscissae are stored in x[15..29] */
+    n = (inf == 2) ? 30 : 15;
+    x[0] = boun + dinf * (1.0 - centr)/centr;
+    for (j = 0; j < 7; j++) {
+        absc = hlgth * XGK15[j];
+        absc1 = centr - absc;
+        absc2 = centr + absc;
+        x[2*j+1] = boun + dinf * (1.0 - absc1)/absc1;
+        x[2*j+2] = boun + dinf * (1.0 - absc2)/absc2;
+    }
     if (inf == 2)
-        fval1 += (*f)(-tabsc1, user_data);
+        for (j = 0; j < 15; j++)
+            x[15+j] = -x[j];
+
+    if (fb != NULL)
+        (*fb)(n, x, fx, user_data);
+    else
+        for (j = 0; j < n; j++)
+            fx[j] = (*f)(x[j], user_data);
+    if (inf == 2)
+        for (j = 0; j < 15; j++)
+            fx[j] += fx[15+j];
+
+    fval1 = fx[0];
     fc=(fval1/centr)/centr;
     resg = fc * WG7[3];
     resk = fc * WGK15[7];
@@ -47,14 +74,8 @@ double G_K15I(dq_function_type f, double boun, int inf, double a, double b,
         absc = hlgth * XGK15[j];
         absc1 = centr - absc;
         absc2 = centr + absc;
-        tabsc1 = boun + dinf * (1.0 - absc1)/absc1;
-        tabsc2 = boun + dinf * (1.0 - absc2)/absc2;
-        fval1 = (*f)(tabsc1, user_data);
-        fval2 = (*f)(tabsc2, user_data);
-        if (inf == 2) {
-            fval1 += (*f)(-tabsc1, user_data);
-            fval2 += (*f)(-tabsc2, user_data);
-        }
+        fval1 = fx[2*j+1];
+        fval2 = fx[2*j+2];
         fval1 = (fval1/absc1)/absc1;
         fval2 = (fval2/absc2)/absc2;
         fv1[j] = fval1;
@@ -79,3 +100,15 @@ double G_K15I(dq_function_type f, double boun, int inf, double a, double b,
         *abserr = MAX(epmach * 50.0 * (*resabs),(*abserr));
     return result;
 }
+
+double G_K15I(dq_function_type f, double boun, int inf, double a, double b,
+    double *abserr,double *resabs,double *resasc, void* user_data)
+{
+    return _G_K15I(f,NULL,boun,inf,a,b,abserr,resabs,resasc,user_data);
+}
+
+double G_K15I_batch(dq_batch_function_type f, double boun, int inf, double a, double b,
+    double *abserr,double *resabs,double *resasc, void* user_data)
+{
+    return _G_K15I(NULL,f,boun,inf,a,b,abserr,resabs,resasc,user_data);
+}
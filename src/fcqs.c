@@ -82,35 +82,49 @@ static double wi_finite(double ti, double N)
     return 4*sin(ti)/(N+1)*sum;
 }
 
-/** @brief Integrate function \f$f(x)\f$ over interval \f$[0,\infty)\f$
+/** @brief Evaluate integrand at the new nodes of a level
  *
- * This method uses an adaptive exponentially convergent Fourier-Chebshev
- * quadrature to compute the integral over the interval \f$[0,\infty)\f$. The
- * method approximately doubles the number of nodes until the desired accuracy
- * is achieved.
+ * The integrand is evaluated at the n nodes x either by calls of f or by a
+ * single call of the batch function fb. The results are stored in f_cache at
+ * the positions given by index.
  *
- * Values of ier after integration:
- * * ier=0: evaluation successful
- * * ier=1: relative accuracy epsrel must be positive
- * * ier=2: integrand returned NAN
- * * ier=3: integrand returned +inf or -inf
- * * ier=4: could not achieve desired accuracy
- *
- * @param [in]     f integrand
- * @param [in]     args pointer given to f when called
- * @param [in,out] epsrel on begin desired accuracy, afterwards achieved accuracy
- * @param [in]     neval number of evaluations of integrand (may be set to NULL)
- * @param [in]     L boosting parameter
- * @param [out]    ier exit code
- * @retval integral numerical value of integral
+ * @retval ier 0 if successful, 2 if the integrand returned NAN, 3 if the
+ * integrand returned +inf or -inf
  */
-double fcqs_semiinf(double f(double, void *), void *args, double *epsrel, int *neval, double L, int *ier)
+static int _fcqs_eval(double f(double, void *), void fb(int, const double[], double[], void *), void *args, int n, const double x[], const int index[], double f_cache[])
+{
+    double fx[MMAX];
+
+    if(fb != NULL)
+        fb(n, x, fx, args);
+    else
+        for(int i = 0; i < n; i++)
+            fx[i] = f(x[i], args);
+
+    for(int i = 0; i < n; i++)
+    {
+        if(isnan(fx[i]))
+            return 2;
+        if(isinf(fx[i]))
+            return 3;
+
+        f_cache[index[i]] = fx[i];
+    }
+
+    return 0;
+}
+
+static double _fcqs_semiinf(double f(double, void *), void fb(int, const double[], double[], void *), void *args, double *epsrel, int *neval, double L, int *ier)
 {
     /* initialize cache */
     double f_cache[MMAX];
     for(size_t i = 0; i < sizeof(f_cache)/sizeof(f_cache[0]); i++)
         f_cache[i] = NAN;
 
+    /* new nodes of a level */
+    double x[MMAX];
+    int index[MMAX];
+
     if(neval)
         *neval = 0;
 
@@ -128,36 +142,30 @@ double fcqs_semiinf(double f(double, void *), void *args, double *epsrel, int *n
         const int N = M-1;
         double I = 0;
 
+        /* compute f(ti) for all nodes that are not cached */
+        int n = 0;
         for(int i = 1; i <= N; i++)
         {
-            const int index = ratio*i;
-            double fti = f_cache[index];
-
-            const double ti = M_PI*i/(N+1);
-
-            /* if necessary compute fti=f(ti) */
-            if(isnan(fti))
+            if(isnan(f_cache[ratio*i]))
             {
-                const double xi = L*cot2(ti/2);
-
-                if(neval)
-                    *neval = *neval+1;
-                fti = f(xi, args);
-
-                f_cache[index] = fti;
-                if(isnan(fti))
-                {
-                    *ier = 2;
-                    return Ilast;
-                }
-                if(isinf(fti))
-                {
-                    *ier = 3;
-                    return Ilast;
-                }
+                const double ti = M_PI*i/(N+1);
+
+                x[n] = L*cot2(ti/2);
+                index[n] = ratio*i;
+                n++;
             }
+        }
+
+        if(neval)
+            *neval = *neval+n;
+        *ier = _fcqs_eval(f, fb, args, n, x, index, f_cache);
+        if(*ier != 0)
+            return Ilast;
 
-            I += wi_semiinf(ti,L,N)*fti;
+        for(int i = 1; i <= N; i++)
+        {
+            const double ti = M_PI*i/(N+1);
+            I += wi_semiinf(ti,L,N)*f_cache[ratio*i];
         }
 
         /* check estimated accuracy */
@@ -182,30 +190,7 @@ double fcqs_semiinf(double f(double, void *), void *args, double *epsrel, int *n
     return Ilast;
 }
 
-/** @brief Integrate function \f$f(x)\f$ over interval \f$[a,b]\f$
- *
- * This method uses an adaptive exponentially convergent Fourier-Chebshev
- * quadrature to compute the integral over the interval \f$[a,b]\f$. The method
- * approximately doubles the number of nodes until the desired accuracy is
- * achieved.
- *
- * Values of ier after integration:
- * * ier=0: evaluation successful
- * * ier=1: relative accuracy epsrel must be positive
- * * ier=2: integrand returned NAN
- * * ier=3: integrand returned +inf or -inf
- * * ier=4: could not achieve desired accuracy
- *
- * @param [in]     f integrand
- * @param [in]     args pointer given to f when called
- * @param [in]     a left border of integration
- * @param [in]     b right border of integration
- * @param [in,out] epsrel on begin desired accuracy, afterwards achieved accuracy
- * @param [out]    neval number of evaluations of integrand (may be set to NULL)
- * @param [out]    ier exit code
- * @retval integral numerical value of integral
- */
-double fcqs_finite(double f(double, void *), void *args, double a, double b, double *epsrel, int *neval, int *ier)
+static double _fcqs_finite(double f(double, void *), void fb(int, const double[], double[], void *), void *args, double a, double b, double *epsrel, int *neval, int *ier)
 {
     const double dx = (b-a)/2;
 
@@ -214,6 +199,10 @@ double fcqs_finite(double f(double, void *), void *args, double a, double b, dou
     for(size_t i = 0; i < sizeof(f_cache)/sizeof(f_cache[0]); i++)
         f_cache[i] = NAN;
 
+    /* new nodes of a level */
+    double x[MMAX];
+    int index[MMAX];
+
     if(neval)
         *neval = 0;
 
@@ -231,36 +220,30 @@ double fcqs_finite(double f(double, void *), void *args, double a, double b, dou
         const int N = M-1;
         double I = 0;
 
+        /* compute f(xi) for all nodes that are not cached */
+        int n = 0;
         for(int i = 1; i <= N; i++)
         {
-            const int index = ratio*i;
-            double fxi = f_cache[index];
-
-            const double ti = M_PI*i/(N+1);
-
-            /* if necessary compute fti=f(ti) */
-            if(isnan(fxi))
+            if(isnan(f_cache[ratio*i]))
             {
-                const double xi = (cos(ti)*(b-a)+a+b)/2;
-
-                if(neval)
-                    *neval = *neval+1;
-                fxi = f(xi, args);
-
-                f_cache[index] = fxi;
-                if(isnan(fxi))
-                {
-                    *ier = 2;
-                    return Ilast;
-                }
-                if(isinf(fxi))
-                {
-                    *ier = 3;
-                    return Ilast;
-                }
+                const double ti = M_PI*i/(N+1);
+
+                x[n] = (cos(ti)*(b-a)+a+b)/2;
+                index[n] = ratio*i;
+                n++;
             }
+        }
+
+        if(neval)
+            *neval = *neval+n;
+        *ier = _fcqs_eval(f, fb, args, n, x, index, f_cache);
+        if(*ier != 0)
+            return Ilast;
 
-            I += wi_finite(ti,N)*fxi*dx;
+        for(int i = 1; i <= N; i++)
+        {
+            const double ti = M_PI*i/(N+1);
+            I += wi_finite(ti,N)*f_cache[ratio*i]*dx;
         }
 
         /* check estimated accuracy */
@@ -284,3 +267,96 @@ double fcqs_finite(double f(double, void *), void *args, double a, double b, dou
 
     return Ilast;
 }
+
+/** @brief Integrate function \f$f(x)\f$ over interval \f$[0,\infty)\f$
+ *
+ * This method uses an adaptive exponentially convergent Fourier-Chebshev
+ * quadrature to compute the integral over the interval \f$[0,\infty)\f$. The
+ * method approximately doubles the number of nodes until the desired accuracy
+ * is achieved.
+ *
+ * Values of ier after integration:
+ * * ier=0: evaluation successful
+ * * ier=1: relative accuracy epsrel must be positive
+ * * ier=2: integrand returned NAN
+ * * ier=3: integrand returned +inf or -inf
+ * * ier=4: could not achieve desired accuracy
+ *
+ * @param [in]     f integrand
+ * @param [in]     args pointer given to f when called
+ * @param [in,out] epsrel on begin desired accuracy, afterwards achieved accuracy
+ * @param [in]     neval number of evaluations of integrand (may be set to NULL)
+ * @param [in]     L boosting parameter
+ * @param [out]    ier exit code
+ * @retval integral numerical value of integral
+ */
+double fcqs_semiinf(double f(double, void *), void *args, double *epsrel, int *neval, double L, int *ier)
+{
+    return _fcqs_semiinf(f, NULL, args, epsrel, neval, L, ier);
+}
+
+/** @brief Integrate function \f$f(x)\f$ over interval \f$[0,\infty)\f$ (batch version)
+ *
+ * Same as \ref fcqs_semiinf, but the integrand is evaluated at all new nodes
+ * of a level by a single call of f. f(n, x, fx, args) must store the values
+ * of the integrand at the n nodes x in fx.
+ *
+ * @param [in]     f integrand (batch)
+ * @param [in]     args pointer given to f when called
+ * @param [in,out] epsrel on begin desired accuracy, afterwards achieved accuracy
+ * @param [in]     neval number of evaluations of integrand (may be set to NULL)
+ * @param [in]     L boosting parameter
+ * @param [out]    ier exit code
+ * @retval integral numerical value of integral
+ */
+double fcqs_semiinf_batch(void f(int, const double[], double[], void *), void *args, double *epsrel, int *neval, double L, int *ier)
+{
+    return _fcqs_semiinf(NULL, f, args, epsrel, neval, L, ier);
+}
+
+/** @brief Integrate function \f$f(x)\f$ over interval \f$[a,b]\f$
+ *
+ * This method uses an adaptive exponentially convergent Fourier-Chebshev
+ * quadrature to compute the integral over the interval \f$[a,b]\f$. The method
+ * approximately doubles the number of nodes until the desired accuracy is
+ * achieved.
+ *
+ * Values of ier after integration:
+ * * ier=0: evaluation successful
+ * * ier=1: relative accuracy epsrel must be positive
+ * * ier=2: integrand returned NAN
+ * * ier=3: integrand returned +inf or -inf
+ * * ier=4: could not achieve desired accuracy
+ *
+ * @param [in]     f integrand
+ * @param [in]     args pointer given to f when called
+ * @param [in]     a left border of integration
+ * @param [in]     b right border of integration
+ * @param [in,out] epsrel on begin desired accuracy, afterwards achieved accuracy
+ * @param [out]    neval number of evaluations of integrand (may be set to NULL)
+ * @param [out]    ier exit code
+ * @retval integral numerical value of integral
+ */
+double fcqs_finite(double f(double, void *), void *args, double a, double b, double *epsrel, int *neval, int *ier)
+{
+    return _fcqs_finite(f, NULL, args, a, b, epsrel, neval, ier);
+}
+
+/** @brief Integrate function \f$f(x)\f$ over interval \f$[a,b]\f$ (batch version)
+ *
+ * Same as \ref fcqs_finite, but the integrand is evaluated at all new nodes
+ * of a level by a single call of f, see \ref fcqs_semiinf_batch.
+ *
+ * @param [in]     f integrand (batch)
+ * @param [in]     args pointer given to f when called
+ * @param [in]     a left border of integration
+ * @param [in]     b right border of integration
+ * @param [in,out] epsrel on begin desired accuracy, afterwards achieved accuracy
+ * @param [out]    neval number of evaluations of integrand (may be set to NULL)
+ * @param [out]    ier exit code
+ * @retval integral numerical value of integral
+ */
+double fcqs_finite_batch(void f(int, const double[], double[], void *), void *args, double a, double b, double *epsrel, int *neval, int *ier)
+{
+    return _fcqs_finite(NULL, f, args, a, b, epsrel, neval, ier);
+}
@@ -29,6 +29,9 @@ double bessel_logKn_recursive(int n, double x) __attribute__ ((pure));
 double bessel_logIn(int n, double x) __attribute__ ((pure));
 double bessel_logKn(int n, double x) __attribute__ ((pure));
 
+void bessel_logIn_array(int nmax, double x, double logIn[]);
+void bessel_logKn_array(int nmax, double x, double logKn[]);
+
 double bessel_ratioI(double nu, double x) __attribute__ ((pure));
 
 double bessel_logInu_series(double nu, double x) __attribute__ ((pure));
@@ -0,0 +1,55 @@
+#ifndef CAPS_MPI_H
+#define CAPS_MPI_H
+
+#include <mpi.h>
+#include <stdbool.h>
+
+typedef struct {
+    int index, m;
+    int block; /* polarization block for m=0: -1 (all), 0 (EE), 1 (MM) */
+    double xi_;
+    double iepsrel; /* accuracy of the integrals used for the task */
+    double recv[4]; /* logdetD, dimensions of the matrices and of their windows, second quantity */
+    double value;
+    double value2;  /* second quantity of the task, see caps_mpi_t.sphere_sphere and caps_mpi_t.ht_pr */
+    MPI_Request request;
+    int state;
+} caps_task_t;
+
+typedef struct {
+    double L, R, T, omegap, gamma, cutoff, iepsrel, alpha;
+    int ldim, cores;
+    int derivative; /* 0: logdetD, k=1,2: (L+R)^k ∂_L^k logdetD at fixed ξ */
+    bool verbose;
+    caps_task_t **tasks;
+    int determinants;
+    double tail_m; /* largest estimated relative remainder of the sums over m */
+    double window; /* tolerance of the adaptive truncation window, see caps_set_window */
+    double dim_full, dim_window; /* summed dimensions of the matrices and of their windows */
+    double accuracy; /* target relative error of the error budget, 0 if not planned (see --accuracy) */
+    double hodlr_eps; /* relative tolerance of HODLR, see kernel_logdet_set_tolerance */
+    double err_xi, err_int; /* predicted relative errors of the integration over ξ and of the integrals */
+    double scale[64][3]; /* L, derivative and largest |logdetD| computed so far, see _logdetD_scale */
+    int scale_elems, scale_next;
+    int skipped; /* number of frequencies skipped by the PFA estimate _logdetD_estimate */
+    bool sphere_sphere; /* also compute logdetD2 = log det(1-M²) for two spheres at d=2L */
+    double *ss_xi, *ss_logdetD2; /* logdetD2 computed so far at xi_ (buf.h, freed by caps), see --sphere-sphere */
+    bool ht_pr; /* ξ=0: the tasks compute the MM blocks for perfect reflectors and for the plasma model, see F_HT */
+    char filename[512];
+    double cache[4096][2];
+    int cache_elems;
+} caps_mpi_t;
+
+void caps_mpi_stop(int cores);
+caps_mpi_t *caps_mpi_init(double L, double R, double T, const char *filename, const char *resume, double omegap, double gamma_, int ldim, double cutoff, double iepsrel, int cores, bool verbose);
+void caps_mpi_free(caps_mpi_t *self);
+int caps_mpi_submit(caps_mpi_t *self, int index, double xi, int m, int block);
+int caps_mpi_submit_L(caps_mpi_t *self, int index, double L, int ldim, double iepsrel, double xi, int m, int block);
+int caps_mpi_retrieve(caps_mpi_t *self, caps_task_t **task_out);
+double caps_mpi_store_term(double terms[], double terms0[2], caps_task_t *task, double value);
+int caps_mpi_get_running(caps_mpi_t *self);
+int caps_get_determinants(caps_mpi_t *self);
+
+void slave(MPI_Comm master_comm, int rank);
+
+#endif
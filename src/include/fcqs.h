@@ -8,6 +8,9 @@ extern "C" {
 double fcqs_semiinf(double f(double, void *), void *args, double *epsrel, int *neval, double L, int *ier);
 double fcqs_finite(double f(double, void *), void *args, double a, double b, double *epsrel, int *neval, int *ier);
 
+double fcqs_semiinf_batch(void f(int, const double[], double[], void *), void *args, double *epsrel, int *neval, double L, int *ier);
+double fcqs_finite_batch(void f(int, const double[], double[], void *), void *args, double a, double b, double *epsrel, int *neval, int *ier);
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,6 +12,7 @@ extern "C" {
 
 integration_t *caps_integrate_init(caps_t *self, double xi_, int m, double epsrel);
 void caps_integrate_free(integration_t *integration);
+int caps_integrate_set_derivative(integration_t *self, int derivative);
 
 double caps_integrate_I(integration_t *self, int l1, int l2, polarization_t p, sign_t *sign);
 double caps_integrate_K(integration_t *self, int nu, polarization_t p, sign_t *sign);
@@ -32,6 +32,29 @@ typedef enum { TE, TM } polarization_t;
 
 #define CAPS_CACHE_ELEMS 10000000 /**< default number of elems of the cache for I integrals */
 
+/**
+ * Entry of the tuning table for the HODLR parameters, see \ref
+ * caps_set_hodlr_tuning. Entries are indexed by the dimension of the matrix
+ * and the regime of m.
+ */
+typedef struct {
+    int log2dim;        /**< dimension of round-trip matrix: round(log2(dim)) */
+    int regime;         /**< regime of m: floor(log2(1+m)) */
+    unsigned int nLeaf; /**< size of the leaves of the HODLR tree */
+    double time;        /**< time in seconds to compute the determinant using nLeaf */
+} caps_hodlr_tuning_entry_t;
+
+/**
+ * Tuning table for the HODLR parameters.
+ */
+typedef struct {
+    char filename[512];                  /**< file the table is read from and saved to */
+    bool tune;                           /**< determine missing entries by measuring */
+    size_t elems;                        /**< number of entries */
+    size_t size;                         /**< maximal number of entries before reallocation */
+    caps_hodlr_tuning_entry_t *entries;  /**< entries of table */
+} caps_hodlr_tuning_t;
+
 /**
  * The CaPS object. This structure stores all essential information about
  * temperature, geometry and the reflection properties of the mirrors.
@@ -74,6 +97,11 @@ typedef struct caps
     int ldim;        /**< truncation value for vector space \f$\ell_\mathrm{max}\f$ */
     double epsrel;   /**< relative error for integration */
     detalg_t detalg; /**< algorithm to calculate determinant */
+    caps_hodlr_tuning_t *tuning; /**< tuning table for HODLR parameters or NULL */
+    double window_eps;   /**< tolerance of the adaptive truncation window, 0 if disabled; see \ref caps_set_window */
+    size_t dim_full;     /**< sum of the dimensions of the round-trip matrices */
+    size_t dim_window;   /**< sum of the dimensions of the windows of the round-trip matrices */
+    int threads;         /**< number of threads for the sums over m in the high-temperature limit, see \ref caps_set_threads */
     /*@}*/
 } caps_t;
 
@@ -89,6 +117,9 @@ typedef struct {
     double *cache_K[2];
     size_t elems_cache_K;
     bool is_pr;
+    int derivative;       /**< order of derivative with respect to alpha, see \ref caps_integrate_set_derivative */
+    cache_t *cache_dI[2]; /**< caches for the first and second derivatives of I */
+    unsigned int elems_cache_I;
 } integration_t;
 
 typedef struct {
@@ -106,6 +137,9 @@ typedef struct
     integration_plasma_t *integration_plasma;
     double xi_;
     double *al, *bl;
+    double *logd; /* diagonal scaling: log(√a_l Λ_l) at 2(l-lmin), log(√b_l Λ_l) at 2(l-lmin)+1 (for ξ=0 see _caps_M0_scaling) */
+    double *hankel; /* ξ=0: log((l1+l2)!) at l1+l2-2lmin, see _caps_M0_scaling */
+    int offset; /* first row/column of the block kernels, see caps_set_window */
 } caps_M_t;
 
 
@@ -126,6 +160,10 @@ void caps_set_epsilonm1_plate(caps_t *self, double (*epsilonm1)(double xi_, void
 void caps_set_epsilonm1_sphere(caps_t *self, double (*epsilonm1)(double xi_, void *userdata), void *userdata);
 
 int caps_get_ldim(caps_t *self);
+int caps_set_window(caps_t *self, double eps);
+void caps_get_window_stats(caps_t *self, size_t *dim_full, size_t *dim_window);
+int caps_get_threads(caps_t *self);
+int caps_set_threads(caps_t *self, int threads);
 int caps_set_ldim(caps_t *self, int ldim);
 
 detalg_t caps_get_detalg(caps_t *self);
@@ -134,16 +172,27 @@ int caps_set_detalg(caps_t *self, detalg_t detalg);
 double caps_get_epsrel(caps_t *self);
 int    caps_set_epsrel(caps_t *self, double epsrel);
 
+int caps_set_hodlr_tuning(caps_t *self, const char *filename, bool tune);
+unsigned int caps_get_hodlr_nleaf(caps_t *self, int dim, int m);
+
 void caps_mie(caps_t *self, double xi_, int l, double *lna, double *lnb);
 void caps_mie_perf(caps_t *self, double xi_, int l, double *lna, double *lnb);
 
 double caps_kernel_M(int i, int j, void *args_);
+void caps_kernel_M_block(int i0, int j0, int ni, int nj, double *out, int ld, void *args_);
+void caps_kernel_M_block_EE(int i0, int j0, int ni, int nj, double *out, int ld, void *args_);
+void caps_kernel_M_block_MM(int i0, int j0, int ni, int nj, double *out, int ld, void *args_);
 
 caps_M_t *caps_M_init(caps_t *self, int m, double xi_);
 double caps_M_elem(caps_M_t *self, int l1, int l2, char p1, char p2);
 void caps_M_free(caps_M_t *self);
 
 double caps_logdetD(caps_t *self, double xi_, int m);
+double caps_logdetD_stats(caps_t *self, double xi_, int m, hodlr_stats_t *stats);
+double caps_logdetD_pm(caps_t *self, double xi_, int m, int block, double *logdetD_plus);
+void caps_logdetD_m0(caps_t *self, double xi_, double *EE, double *MM);
+void caps_logdetD_sequence(caps_t *self, double xi_, int m, const int ldims[], int n, double out[]);
+double caps_dlogdetD_dL(caps_t *self, double xi_, int m, double *d2);
 
 void caps_fresnel(caps_t *self, double xi_, double k, double *r_TE, double *r_TM);
 
@@ -9,9 +9,26 @@ extern "C" {
 #include <stdbool.h>
 #include <math.h>
 
+#include "hodlr.h"
 #include "utils.h"
 
-typedef enum { DETALG_HODLR, DETALG_LU, DETALG_QR, DETALG_CHOLESKY } detalg_t;
+/** default size of the leaves of the HODLR tree, see \ref kernel_logdet_block_stats */
+#define KERNEL_LOGDET_NLEAF 50
+
+/** default relative tolerance of HODLR, see \ref kernel_logdet_set_tolerance */
+#define KERNEL_LOGDET_TOLERANCE 1e-13
+
+typedef enum { DETALG_HODLR, DETALG_LU, DETALG_QR, DETALG_CHOLESKY, DETALG_AUTO } detalg_t;
+
+/** maximal dimension for which DETALG_AUTO considers dense algorithms */
+#define KERNEL_LOGDET_DENSE_MAX 8192
+
+/** cost model to choose between dense algorithms and HODLR, see \ref kernel_logdet_detalg */
+typedef struct {
+    double flops; /**< throughput of dense factorizations in floating point operations per second */
+    double kappa; /**< cost of a matrix element for HODLR relative to dense assembly */
+    double rank;  /**< typical rank of the off-diagonal blocks */
+} kernel_logdet_model_t;
 
 /** define matrix type */
 typedef struct {
@@ -47,11 +64,22 @@ double matrix_trace2(matrix_t *A);
 double matrix_norm_frobenius(matrix_t *A);
 
 double kernel_logdet(int dim, double (*M)(int,int,void *), void *args, int sym_spd, detalg_t detalg);
+double kernel_logdet_block(int dim, void (*M_block)(int,int,int,int,double *,int,void *), void *args, int sym_spd, detalg_t detalg);
+void kernel_logdet_calibrate(kernel_logdet_model_t *model);
+void kernel_logdet_set_model(const kernel_logdet_model_t *model);
+kernel_logdet_model_t kernel_logdet_get_model(void);
+int kernel_logdet_set_tolerance(double eps);
+double kernel_logdet_get_tolerance(void);
+detalg_t kernel_logdet_detalg(int dim, int sym_spd, double t_elem, double rank, unsigned int nLeaf);
+double kernel_logdet_block_stats(int dim, void (*M_block)(int,int,int,int,double *,int,void *), void *args, int sym_spd, detalg_t detalg, unsigned int nLeaf, hodlr_stats_t *stats);
+double kernel_logdet_block_pm(int dim, void (*M_block)(int,int,int,int,double *,int,void *), void *args, int sym_spd, detalg_t detalg, unsigned int nLeaf, hodlr_stats_t *stats, double *plus);
+void kernel_logdet_block_nested(int n, const int start[], const int size[], void (*M_block)(int,int,int,int,double *,int,void *), void *args, int sym_spd, detalg_t detalg, unsigned int nLeaf, double logdet[]);
 
 double matrix_logdet_triangular(matrix_t *A);
 double matrix_logdet_dense(matrix_t *A, double z, detalg_t detalg);
 double matrix_logdet_cholesky(matrix_t *A, char uplo);
 double matrix_logdet_lu(matrix_t *A);
+double matrix_dlogdet_lu(matrix_t *D, matrix_t *dD, matrix_t *d2D, double *d2);
 double matrix_logdet_qr(matrix_t *A);
 
 matrix_t *matrix_mult(matrix_t *A, matrix_t *B, double alpha);
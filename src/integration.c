@@ -8,6 +8,7 @@
 #include <math.h>
 #include <stdint.h>
 #include <inttypes.h>
+#include <string.h>
 
 #include "quadpack.h"
 
@@ -488,6 +489,65 @@ double caps_integrate_K(integration_t *self, int nu, polarization_t p, sign_t *s
     return K;
 }
 
+/* Derivative of order self->derivative of K with respect to α,
+ *      ∂_α^k K_ν = (-1)^k ∫dx x^k r_p e^{-αx} P_ν^μ(x) [/(x²-1)],
+ * with μ=2m for m>0 and μ=2 for m=0. Using the recurrence relation
+ *      x P_ν^μ(x) = [(ν-μ+1) P_{ν+1}^μ(x) + (ν+μ) P_{ν-1}^μ(x)]/(2ν+1),
+ * the derivatives are linear combinations of K_{ν-k},...,K_{ν+k} with
+ * positive coefficients, so no additional quadratures are needed and there is
+ * no loss of significance. */
+static double _caps_integrate_K_derivative(integration_t *self, int nu, polarization_t p, sign_t *sign)
+{
+    const int k = self->derivative;
+
+    if(k == 0)
+        return caps_integrate_K(self, nu, p, sign);
+
+    const int mu = (self->m > 0) ? 2*self->m : 2;
+    /* coefficients of x^k P_ν^μ in terms of P_{ν-k}^μ,...,P_{ν+k}^μ */
+    double c[5] = { 0, 0, 1, 0, 0 }; /* index j: P_{ν+j-2}^μ */
+
+    for(int i = 0; i < k; i++)
+    {
+        double cnew[5] = { 0, 0, 0, 0, 0 };
+
+        /* k <= 2: before the last step only P_{ν-1},P_ν,P_{ν+1} contribute */
+        for(int j = 1; j < 4; j++)
+        {
+            const int n = nu+j-2;
+            if(c[j] == 0)
+                continue;
+
+            cnew[j+1] += c[j]*(n-mu+1.)/(2*n+1.);
+            if(n-1 >= mu)
+                cnew[j-1] += c[j]*(n+mu+0.)/(2*n+1.);
+        }
+
+        memcpy(c, cnew, sizeof(c));
+    }
+
+    log_t terms[5];
+    int elems = 0;
+    for(int j = 0; j < 5; j++)
+    {
+        if(c[j] > 0)
+        {
+            sign_t s;
+            terms[elems].v = caps_integrate_K(self, nu+j-2, p, &s)+log(c[j]);
+            terms[elems].s = s;
+            elems++;
+        }
+    }
+
+    const double v = logadd_ms(terms, elems, sign);
+
+    /* (-1)^k */
+    if(k % 2)
+        *sign = -*sign;
+
+    return v;
+}
+
 /* eq. (3) */
 static double _alpha(double p, double n, double nu)
 {
@@ -520,7 +580,7 @@ static double _caps_integrate_I(integration_t *self, int l1, int l2, polarizatio
     /* q = 0 */
     int q = 0;
     aq[q] = 1;
-    double K = caps_integrate_K(self, l1pl2-2*q, p_, &s);
+    double K = _caps_integrate_K_derivative(self, l1pl2-2*q, p_, &s);
     array[q].s = s;
     array[q].v = K;
 
@@ -531,7 +591,7 @@ static double _caps_integrate_I(integration_t *self, int l1, int l2, polarizatio
     q = 1;
     /* eq. (29) */
     aq[q] = (n+nu-1.5)*(1-(2*n+2*nu-1)/(n4*(n4-1))*((m-n)*(m-n+1)/(2*n-1)+(m-nu)*(m-nu+1)/(2*nu-1)));
-    K = caps_integrate_K(self, l1pl2-2*q, p_, &s);
+    K = _caps_integrate_K_derivative(self, l1pl2-2*q, p_, &s);
     array[q].s = SGN(aq[q])*s;
     array[q].v = K+log(fabs(aq[q]));
     if(qmax == 1)
@@ -545,7 +605,7 @@ static double _caps_integrate_I(integration_t *self, int l1, int l2, polarizatio
                 + (m-nu)*(m-nu+1)*(m-nu+2)*(m-nu+3)/(2*nu-1)/(2*nu-3) ) - (m-n)*(m-n+1)/(2*n-1) \
                 - (m-nu)*(m-nu+1)/(2*nu-1) ) +0.5);
 
-    K = caps_integrate_K(self, l1pl2-2*q, p_, &s);
+    K = _caps_integrate_K_derivative(self, l1pl2-2*q, p_, &s);
     array[q].s = SGN(aq[q])*s;
     array[q].v = K+log(fabs(aq[q]));
 
@@ -586,7 +646,7 @@ static double _caps_integrate_I(integration_t *self, int l1, int l2, polarizatio
             aq[q] = SGN(aq[q]);
         }
 
-        K = caps_integrate_K(self, l1pl2-2*q, p_, &s);
+        K = _caps_integrate_K_derivative(self, l1pl2-2*q, p_, &s);
         array[q].s = SGN(aq[q])*s;
         array[q].v = log_scaling+K+log(fabs(aq[q]));
 
@@ -638,7 +698,7 @@ double caps_integrate_I(integration_t *self, int l1, int l2, polarization_t p, s
     if(self->is_pr && p == TE)
     {
         const double v = caps_integrate_I(self, l1, l2, TM, sign);
-        *sign = -1;
+        *sign = -*sign;
         return v;
     }
 
@@ -657,14 +717,27 @@ double caps_integrate_I(integration_t *self, int l1, int l2, polarization_t p, s
     else
         *sign = -1;
 
+    if(self->derivative > 0)
+        *sign *= (self->derivative % 2) ? -1 : 1;
+
+    /* derivatives with respect to alpha have their own caches */
+    cache_t *cache = self->cache_I;
+    if(self->derivative > 0)
+    {
+        cache_t **cache_dI = &self->cache_dI[self->derivative-1];
+        if(*cache_dI == NULL)
+            *cache_dI = cache_new(self->elems_cache_I);
+        cache = *cache_dI;
+    }
+
     const uint64_t key = hash(l1,l2,p);
-    double I = cache_lookup(self->cache_I, key);
+    double I = cache_lookup(cache, key);
 
     if(isnan(I))
     {
         /* compute and save integral */
         I = _caps_integrate_I(self, l1, l2, p, sign);
-        cache_insert(self->cache_I, key, I);
+        cache_insert(cache, key, I);
     }
 
     return I;
@@ -710,6 +783,11 @@ integration_t *caps_integrate_init(caps_t *caps, double xi_, int m, double epsre
         elems = atoi(s);
 
     self->cache_I = cache_new(elems);
+    self->elems_cache_I = elems;
+
+    /* no derivatives, caches for derivatives are allocated on demand */
+    self->derivative = 0;
+    self->cache_dI[0] = self->cache_dI[1] = NULL;
 
     self->elems_cache_K = 5*(caps->ldim+2*m+100);
     self->cache_K[0] = xmalloc(self->elems_cache_K*sizeof(double));
@@ -739,12 +817,40 @@ void caps_integrate_free(integration_t *integration)
     if(integration != NULL)
     {
         cache_free(integration->cache_I);
+        for(int k = 0; k < 2; k++)
+            if(integration->cache_dI[k] != NULL)
+                cache_free(integration->cache_dI[k]);
         xfree(integration->cache_K[0]);
         xfree(integration->cache_K[1]);
         xfree(integration);
     }
 }
 
+/** @brief Set order of derivative with respect to \f$\alpha\f$
+ *
+ * After a call to this function with derivative=k, the functions \ref
+ * caps_integrate_I, \ref caps_integrate_A, \ref caps_integrate_B, \ref
+ * caps_integrate_C and \ref caps_integrate_D return the k-th derivative of
+ * the integrals with respect to \f$\alpha=2\xi\mathcal{L}/c\f$ at fixed
+ * \f$\xi\f$. Since the Fresnel coefficients do not depend on
+ * \f$\alpha\f$, the derivatives are computed from the integrals
+ * \f$\mathcal{K}_{\nu,p}^{(m)}\f$ for neighbouring \f$\nu\f$, see
+ * \ref caps_integrate_K. The derivatives are cached separately.
+ *
+ * @param [in,out] self integration object
+ * @param [in] derivative order of derivative, 0, 1 or 2
+ * @retval 0 on success
+ * @retval -1 if derivative is not 0, 1 or 2
+ */
+int caps_integrate_set_derivative(integration_t *self, int derivative)
+{
+    if(derivative < 0 || derivative > 2)
+        return -1;
+
+    self->derivative = derivative;
+    return 0;
+}
+
 /** Compute integral \f$A_{\ell_1,\ell_2,p}^{(m)}(\xi)\f$
  *
  * Compute the integral
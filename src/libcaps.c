@@ -6,9 +6,11 @@
  */
 
 #include <math.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -47,23 +49,29 @@ double caps_lnLambda(int l1, int l2, int m)
     return (logi(2*l1+1)+logi(2*l2+1)-logi(l1)-logi(l1+1)-logi(l2)-logi(l2+1)+lfac(l1-m)+lfac(l2-m)-lfac(l1+m)-lfac(l2+m))/2.0;
 }
 
-/** @brief Estimate \f$\ell_\mathrm{min}\f$ and \f$\ell_\mathrm{max}\f$
+/** @brief Calculate the part of \f$\log\Lambda_{\ell_1 \ell_2}^{(m)}\f$ that depends on \f$\ell\f$
  *
- * Estimate the vector space: The main contributions comes from the vicinity
- * \f$\ell_1=\ell_2=X\f$ and only depend on geometry, \f$L/R\f$, and the quantum number \f$m\f$. This
- * function calculates \f$X\f$ using the formula in the high-temperature limit and
- * calculates \f$\ell_\mathrm{min}\f$, \f$\ell_\mathrm{max}\f$.
+ * \f$\log\Lambda_{\ell_1 \ell_2}^{(m)}\f$ is separable, i.e.,
+ * \f[
+ *      \log\Lambda_{\ell_1,\ell_2}^{(m)} = \lambda_{\ell_1}^{(m)} + \lambda_{\ell_2}^{(m)} \,.
+ * \f]
+ * This function returns \f$\lambda_\ell^{(m)}\f$.
  *
- * @param [in] self CaPS object
- * @param [in] m quantum number
- * @param [out] lmin_p minimum value of \f$\ell\f$
- * @param [out] lmax_p maximum value of \f$\ell\f$
- * @retval l approximately the value of \f$\ell\f$ where \f$\mathcal{M}^m_{\ell\ell}\f$ is maximal
+ * See also \ref caps_lnLambda.
+ *
+ * @param [in]  l  l>0
+ * @param [in]  m  m <= l
+ * @retval lnLambda_l \f$\lambda_\ell^{(m)}\f$
  */
-int caps_estimate_lminmax(caps_t *self, int m, size_t *lmin_p, size_t *lmax_p)
+static double caps_lnLambda_l(int l, int m)
 {
-    const int ldim = self->ldim;
+    return (logi(2*l+1)-logi(l)-logi(l+1)+lfac(l-m)-lfac(l+m))/2.0;
+}
 
+/* same as caps_estimate_lminmax, but for the dimension ldim instead of
+ * self->ldim */
+static int _caps_estimate_lminmax(caps_t *self, int m, int ldim, size_t *lmin_p, size_t *lmax_p)
+{
     if(m == 0)
     {
         *lmin_p = 1;
@@ -87,6 +95,24 @@ int caps_estimate_lminmax(caps_t *self, int m, size_t *lmin_p, size_t *lmax_p)
     return l;
 }
 
+/** @brief Estimate \f$\ell_\mathrm{min}\f$ and \f$\ell_\mathrm{max}\f$
+ *
+ * Estimate the vector space: The main contributions comes from the vicinity
+ * \f$\ell_1=\ell_2=X\f$ and only depend on geometry, \f$L/R\f$, and the quantum number \f$m\f$. This
+ * function calculates \f$X\f$ using the formula in the high-temperature limit and
+ * calculates \f$\ell_\mathrm{min}\f$, \f$\ell_\mathrm{max}\f$.
+ *
+ * @param [in] self CaPS object
+ * @param [in] m quantum number
+ * @param [out] lmin_p minimum value of \f$\ell\f$
+ * @param [out] lmax_p maximum value of \f$\ell\f$
+ * @retval l approximately the value of \f$\ell\f$ where \f$\mathcal{M}^m_{\ell\ell}\f$ is maximal
+ */
+int caps_estimate_lminmax(caps_t *self, int m, size_t *lmin_p, size_t *lmax_p)
+{
+    return _caps_estimate_lminmax(self, m, self->ldim, lmin_p, lmax_p);
+}
+
 
 /*@}*/
 
@@ -207,8 +233,33 @@ caps_t *caps_init(double R, double L)
     /* relative error for integration */
     self->epsrel = CAPS_EPSREL;
 
-    /* use LU decomposition by default */
-    self->detalg = DETALG_HODLR;
+    /* choose between dense Cholesky and HODLR for every determinant */
+    self->detalg = DETALG_AUTO;
+
+    /* tuning table for HODLR parameters */
+    self->tuning = NULL;
+    {
+        const char *filename = getenv("CAPS_HODLR_TABLE");
+        if(filename != NULL && strlen(filename) > 0)
+            caps_set_hodlr_tuning(self, filename, false);
+    }
+
+    /* adaptive truncation window, disabled by default */
+    self->window_eps = 0;
+    self->dim_full = self->dim_window = 0;
+    {
+        const char *eps = getenv("CAPS_WINDOW");
+        if(eps != NULL && strlen(eps) > 0)
+            WARN(!caps_set_window(self, atof(eps)), "invalid value of CAPS_WINDOW: %s", eps);
+    }
+
+    /* sums over m in the high-temperature limit, serial by default */
+    self->threads = 1;
+    {
+        const char *threads = getenv("CAPS_THREADS");
+        if(threads != NULL && strlen(threads) > 0)
+            WARN(!caps_set_threads(self, atoi(threads)), "invalid value of CAPS_THREADS: %s", threads);
+    }
 
     return self;
 }
@@ -223,6 +274,7 @@ caps_t *caps_init(double R, double L)
  */
 void caps_free(caps_t *self)
 {
+    caps_set_hodlr_tuning(self, NULL, false);
     xfree(self);
 }
 
@@ -282,6 +334,7 @@ void caps_info(caps_t *self, FILE *stream, const char *prefix)
         case DETALG_LU:       detalg_str = "LU";       break;
         case DETALG_QR:       detalg_str = "QR";       break;
         case DETALG_CHOLESKY: detalg_str = "CHOLESKY"; break;
+        case DETALG_AUTO:     detalg_str = "AUTO";     break;
         default:              detalg_str = "unknown";
     }
 
@@ -291,6 +344,8 @@ void caps_info(caps_t *self, FILE *stream, const char *prefix)
     fprintf(stream, "%sldim   = %d\n",    prefix, self->ldim);
     fprintf(stream, "%sepsrel = %.1e\n",  prefix, self->epsrel);
     fprintf(stream, "%sdetalg = %s\n",    prefix, detalg_str);
+    if(self->tuning != NULL)
+        fprintf(stream, "%shodlr  = %s (%zu entries%s)\n", prefix, self->tuning->filename, self->tuning->elems, self->tuning->tune ? ", tuning" : "");
 }
 
 /**
@@ -388,7 +443,10 @@ void caps_set_epsilonm1_sphere(caps_t *self, double (*epsilonm1)(double xi_, voi
  * The algorithm is given by detalg. Usually you don't want to change the
  * algorithm to compute the determinant.
  *
- * detalg may be: DETALG_HODLR or DETALG_LU, DETALG_QR, DETALG_CHOLESKY.
+ * detalg may be: DETALG_AUTO, DETALG_HODLR or DETALG_LU, DETALG_QR,
+ * DETALG_CHOLESKY. The default DETALG_AUTO chooses dense Cholesky
+ * decomposition for small and HODLR for large round-trip matrices using the
+ * cost model of \ref kernel_logdet_detalg.
  *
  * If successul, the function returns 1. If the algorithm is not supported
  * because of missing LAPACK support, 0 is returned.
@@ -420,6 +478,202 @@ detalg_t caps_get_detalg(caps_t *self)
     return self->detalg;
 }
 
+/* regime of m used as key of the HODLR tuning table */
+static int _hodlr_regime(int m)
+{
+    return floor(log2(1+m));
+}
+
+/* Default size of the leaves. For m=0 the polarization blocks EE and MM are
+ * factorized separately; half the size gives leaves that cover the same
+ * range of l as the leaves of the interleaved round-trip matrix. */
+static unsigned int _hodlr_nleaf_default(int m)
+{
+    return (m == 0) ? KERNEL_LOGDET_NLEAF/2 : KERNEL_LOGDET_NLEAF;
+}
+
+/* dimension of the round-trip matrix used as key of the HODLR tuning table */
+static int _hodlr_log2dim(int dim)
+{
+    return round(log2(dim));
+}
+
+/* Look up the entry for a round-trip matrix of dimension dim and quantum
+ * number m. If exact is false and there is no entry for the key, the entry
+ * of the same regime of m with the closest dimension is returned. Returns
+ * NULL if no entry is found. */
+static caps_hodlr_tuning_entry_t *_hodlr_tuning_lookup(caps_hodlr_tuning_t *tuning, int dim, int m, bool exact)
+{
+    const int log2dim = _hodlr_log2dim(dim), regime = _hodlr_regime(m);
+    caps_hodlr_tuning_entry_t *closest = NULL;
+
+    for(size_t i = 0; i < tuning->elems; i++)
+    {
+        caps_hodlr_tuning_entry_t *entry = &tuning->entries[i];
+        if(entry->regime != regime)
+            continue;
+
+        if(entry->log2dim == log2dim)
+            return entry;
+
+        if(closest == NULL || abs(entry->log2dim-log2dim) < abs(closest->log2dim-log2dim))
+            closest = entry;
+    }
+
+    return exact ? NULL : closest;
+}
+
+/* add entry to tuning table; an existing entry with the same key is replaced */
+static void _hodlr_tuning_add(caps_hodlr_tuning_t *tuning, caps_hodlr_tuning_entry_t *entry)
+{
+    for(size_t i = 0; i < tuning->elems; i++)
+    {
+        if(tuning->entries[i].log2dim == entry->log2dim && tuning->entries[i].regime == entry->regime)
+        {
+            tuning->entries[i] = *entry;
+            return;
+        }
+    }
+
+    if(tuning->elems >= tuning->size)
+    {
+        tuning->size *= 2;
+        tuning->entries = xrealloc(tuning->entries, tuning->size*sizeof(caps_hodlr_tuning_entry_t));
+    }
+
+    tuning->entries[tuning->elems++] = *entry;
+}
+
+/* write tuning table to its file; returns 1 on success, 0 otherwise */
+static int _hodlr_tuning_save(caps_hodlr_tuning_t *tuning)
+{
+    FILE *f = fopen(tuning->filename, "w");
+    if(f == NULL)
+        return 0;
+
+    fprintf(f, "# HODLR tuning table\n");
+    fprintf(f, "# depth of tree: n_levels = max(1, log2(dim/nLeaf))\n");
+    fprintf(f, "# round(log2(dim)), floor(log2(1+m)), nLeaf, time [s]\n");
+    for(size_t i = 0; i < tuning->elems; i++)
+    {
+        caps_hodlr_tuning_entry_t *entry = &tuning->entries[i];
+        fprintf(f, "%d %d %u %.6g\n", entry->log2dim, entry->regime, entry->nLeaf, entry->time);
+    }
+
+    fclose(f);
+    return 1;
+}
+
+/**
+ * @brief Use a tuning table for the parameters of the HODLR algorithm
+ *
+ * The optimal size of the leaves nLeaf of the HODLR tree (and thus the depth
+ * of the tree, log2(dim/nLeaf)) depends on the dimension of the round-trip
+ * matrix and on m: for large values of m the ranks of the off-diagonal
+ * blocks collapse and larger blocks can be compressed. The tuning table
+ * stores the optimal value of nLeaf for each dimension and regime of m. The
+ * key of the table is (round(log2(dim)), floor(log2(1+m))).
+ *
+ * The table is read from filename. If tune is true, entries that are missing
+ * are determined by measurement the first time \ref caps_logdetD is called
+ * for a key: the determinant is computed for a sequence of increasingly
+ * deeper trees until the computation becomes slower or the off-diagonal
+ * blocks at the deepest level are no longer of low rank. The fastest value of
+ * nLeaf is added to the table and the table is saved to filename. Tuning mode
+ * is not thread-safe.
+ *
+ * If tune is false, the table is only read. If there is no entry for a key,
+ * the entry of the same regime of m with the closest dimension is used; if
+ * there is none, the default KERNEL_LOGDET_NLEAF is used (KERNEL_LOGDET_NLEAF/2
+ * for m=0).
+ *
+ * The tuning table is also read in \ref caps_init if the environment
+ * variable CAPS_HODLR_TABLE contains a filename.
+ *
+ * If filename is NULL, the tuning table is removed.
+ *
+ * @param [in,out] self CaPS object
+ * @param [in] filename filename of tuning table or NULL
+ * @param [in] tune determine missing entries by measurement
+ * @retval entries number of entries read from filename
+ * @retval -1 if filename cannot be read (and tune is false) or is too long
+ */
+int caps_set_hodlr_tuning(caps_t *self, const char *filename, bool tune)
+{
+    char line[512];
+
+    if(self->tuning != NULL)
+    {
+        xfree(self->tuning->entries);
+        xfree(self->tuning);
+        self->tuning = NULL;
+    }
+
+    if(filename == NULL)
+        return 0;
+
+    if(strlen(filename) >= sizeof(self->tuning->filename))
+        return -1;
+
+    FILE *f = fopen(filename, "r");
+    if(f == NULL && !tune)
+        return -1;
+
+    caps_hodlr_tuning_t *tuning = xmalloc(sizeof(caps_hodlr_tuning_t));
+    memset(tuning->filename, '\0', sizeof(tuning->filename));
+    strncpy(tuning->filename, filename, sizeof(tuning->filename)-sizeof(char));
+    tuning->tune    = tune;
+    tuning->elems   = 0;
+    tuning->size    = 32;
+    tuning->entries = xmalloc(tuning->size*sizeof(caps_hodlr_tuning_entry_t));
+
+    if(f != NULL)
+    {
+        while(fgets(line, sizeof(line)/sizeof(char), f) != NULL)
+        {
+            caps_hodlr_tuning_entry_t entry;
+
+            strim(line);
+            if(line[0] == '#')
+                continue;
+
+            if(sscanf(line, "%d %d %u %lg", &entry.log2dim, &entry.regime, &entry.nLeaf, &entry.time) == 4 && entry.nLeaf > 0)
+                _hodlr_tuning_add(tuning, &entry);
+        }
+
+        fclose(f);
+    }
+
+    self->tuning = tuning;
+
+    return tuning->elems;
+}
+
+/**
+ * @brief Get size of leaves of the HODLR tree
+ *
+ * Return the size of the leaves nLeaf of the HODLR tree used to compute the
+ * determinant of a round-trip matrix of dimension dim for the quantum number
+ * m. For m=0 dim is the dimension of the polarization blocks EE and MM, see
+ * \ref caps_logdetD_m0. See \ref caps_set_hodlr_tuning.
+ *
+ * @param [in] self CaPS object
+ * @param [in] dim dimension of round-trip matrix
+ * @param [in] m quantum number m
+ * @retval nLeaf size of the leaves
+ */
+unsigned int caps_get_hodlr_nleaf(caps_t *self, int dim, int m)
+{
+    if(self->tuning != NULL)
+    {
+        caps_hodlr_tuning_entry_t *entry = _hodlr_tuning_lookup(self->tuning, dim, m, false);
+        if(entry != NULL)
+            return entry->nLeaf;
+    }
+
+    return _hodlr_nleaf_default(m);
+}
+
 /**
  * @brief Set dimension of vector space
  *
@@ -456,6 +710,101 @@ int caps_get_ldim(caps_t *self)
     return self->ldim;
 }
 
+/**
+ * @brief Set tolerance of the adaptive truncation window
+ *
+ * The vector space is truncated to \f$\ell_\mathrm{dim}\f$ values of
+ * \f$\ell\f$, see \ref caps_set_ldim. For a given round-trip matrix only a
+ * part of this range contributes appreciably to the determinant. If eps > 0,
+ * the diagonal of every round-trip matrix is computed first; the values of
+ * \f$\ell\f$ at both ends of the range are then discarded as long as the sum of
+ * the discarded diagonal elements is smaller than
+ * \f$\epsilon\,\mathrm{tr}\mathcal{M}/(1+\mathrm{tr}\mathcal{M})\f$, and
+ * the determinant is computed for the remaining window only.
+ *
+ * Discarding rows and columns with diagonal elements \f$\tau\f$ changes
+ * \f$\log\det\mathcal{D}\f$ by roughly \f$\tau(1+\mathrm{tr}\mathcal{M})\f$
+ * while \f$|\log\det\mathcal{D}| \ge \mathrm{tr}\mathcal{M}\f$, so eps is
+ * an estimate of the relative error. The estimate neglects the amplification
+ * by \f$(1-\lambda_\mathrm{max})^{-1}\f$ at small separations; eps should
+ * therefore be chosen well below the desired accuracy.
+ *
+ * The window is applied in \ref caps_logdetD, \ref caps_logdetD_stats and
+ * \ref caps_logdetD_m0. The dimensions of the full matrices and of the
+ * windows are accumulated, see \ref caps_get_window_stats. The default is
+ * eps=0 unless the environment variable CAPS_WINDOW is set when \ref
+ * caps_init is called.
+ *
+ * @param [in,out] self CaPS object
+ * @param [in] eps tolerance, 0 disables the window
+ * @retval 1 if successful
+ * @retval 0 if eps < 0
+ */
+int caps_set_window(caps_t *self, double eps)
+{
+    if(!(eps >= 0))
+        return 0;
+
+    self->window_eps = eps;
+    return 1;
+}
+
+/**
+ * @brief Get dimensions accumulated by the adaptive truncation window
+ *
+ * Return the sum of the dimensions of all round-trip matrices computed so far
+ * and the sum of the dimensions of their windows, see \ref caps_set_window.
+ * If the window is disabled, both numbers are equal.
+ *
+ * @param [in] self CaPS object
+ * @param [out] dim_full sum of dimensions of the round-trip matrices (may be NULL)
+ * @param [out] dim_window sum of dimensions of the windows (may be NULL)
+ */
+void caps_get_window_stats(caps_t *self, size_t *dim_full, size_t *dim_window)
+{
+    if(dim_full != NULL)
+        *dim_full = self->dim_full;
+    if(dim_window != NULL)
+        *dim_window = self->dim_window;
+}
+
+/**
+ * @brief Set number of threads for the high-temperature limit
+ *
+ * The terms of the sums over m in \ref caps_ht_perf and \ref caps_ht_plasma
+ * are independent; threads terms are computed in parallel. The terms are
+ * added in the order of m and the sum stops at the same m as with a single
+ * thread, so at most threads-1 terms are computed in vain. The default is 1
+ * unless the environment variable CAPS_THREADS is set when \ref caps_init is
+ * called.
+ *
+ * @param [in,out] self CaPS object
+ * @param [in] threads number of threads, threads >= 1
+ * @retval 1 if successful
+ * @retval 0 if threads < 1
+ */
+int caps_set_threads(caps_t *self, int threads)
+{
+    if(threads < 1)
+        return 0;
+
+    self->threads = threads;
+    return 1;
+}
+
+/**
+ * @brief Get number of threads for the high-temperature limit
+ *
+ * See \ref caps_set_threads.
+ *
+ * @param [in] self CaPS object
+ * @retval threads number of threads
+ */
+int caps_get_threads(caps_t *self)
+{
+    return self->threads;
+}
+
 /*@}*/
 
 
@@ -655,30 +1004,15 @@ void caps_fresnel(caps_t *self, double xi_, double k_, double *r_TE, double *r_T
 */
 /*@{*/
 
-/**
- * @brief Initialize caps_M_t object
- *
- * This object contains all information necessary to compute the matrix
- * elements of the round-trip operator \f$\mathcal{M}^{(m)}(\xi)\f$. It also
- * contains a cache for the Mie coefficients.
- *
- * The returned object can be given to \ref caps_kernel_M to compute the
- * matrix elements of the round-trip operator.
- *
- * @param [in] caps CaPS object
- * @param [in] m azimuthal quantum number \f$m\f$
- * @param [in] xi_ \f$\xi\mathcal{L}/c\f$
- * @retval obj caps_M_t object that can be given to \ref caps_kernel_M
- */
-caps_M_t *caps_M_init(caps_t *caps, int m, double xi_)
+/* same as caps_M_init, but for the dimension ldim instead of caps->ldim */
+static caps_M_t *_caps_M_init(caps_t *caps, int m, double xi_, int ldim)
 {
     TERMINATE(xi_ <= 0, "Matsubara frequency must be positive");
 
     size_t lmin, lmax;
-    const int ldim = caps->ldim;
     caps_M_t *self = xmalloc(sizeof(caps_M_t));
 
-    caps_estimate_lminmax(caps, m, &lmin, &lmax);
+    _caps_estimate_lminmax(caps, m, ldim, &lmin, &lmax);
 
     self->caps = caps;
     self->m = m;
@@ -687,8 +1021,11 @@ caps_M_t *caps_M_init(caps_t *caps, int m, double xi_)
     self->integration = caps_integrate_init(caps, xi_, m, caps->epsrel);
     self->integration_plasma = NULL;
     self->xi_ = xi_;
+    self->offset = 0;
     self->al = xmalloc(ldim*sizeof(double));
     self->bl = xmalloc(ldim*sizeof(double));
+    self->logd = xmalloc(2*ldim*sizeof(double));
+    self->hankel = NULL;
 
     for(int j = 0; j < ldim; j++)
         self->al[j] = self->bl[j] = NAN;
@@ -696,6 +1033,48 @@ caps_M_t *caps_M_init(caps_t *caps, int m, double xi_)
     return self;
 }
 
+/* Compute the Mie coefficients and the diagonal scaling for l=lmin+j.
+ *
+ * The matrix elements are products D_l1 K_l1,l2 D_l2 of a kernel K given by
+ * the integrals and of diagonal scalings D_l = √a_l Λ_l (EE, EM) resp.
+ * D_l = √b_l Λ_l (MM, ME) that depend on l only, where
+ * log Λ_l1,l2 = log Λ_l1 + log Λ_l2, see caps_lnLambda_l. The scalings are
+ * computed once per l and object. The determinants are nevertheless computed
+ * for the matrix itself: K and D_l over- and underflow separately, and the
+ * off-diagonal blocks of K are not of lower rank than those of M. */
+static void _caps_M_scaling(caps_M_t *self, int j)
+{
+    if(!isnan(self->al[j]))
+        return;
+
+    const int l = self->lmin+j;
+    caps_mie(self->caps, self->xi_, l, &self->al[j], &self->bl[j]);
+
+    const double lnLambda_l = caps_lnLambda_l(l, self->m);
+    self->logd[2*j]   = self->al[j]/2 + lnLambda_l;
+    self->logd[2*j+1] = self->bl[j]/2 + lnLambda_l;
+}
+
+/**
+ * @brief Initialize caps_M_t object
+ *
+ * This object contains all information necessary to compute the matrix
+ * elements of the round-trip operator \f$\mathcal{M}^{(m)}(\xi)\f$. It also
+ * contains a cache for the Mie coefficients.
+ *
+ * The returned object can be given to \ref caps_kernel_M to compute the
+ * matrix elements of the round-trip operator.
+ *
+ * @param [in] caps CaPS object
+ * @param [in] m azimuthal quantum number \f$m\f$
+ * @param [in] xi_ \f$\xi\mathcal{L}/c\f$
+ * @retval obj caps_M_t object that can be given to \ref caps_kernel_M
+ */
+caps_M_t *caps_M_init(caps_t *caps, int m, double xi_)
+{
+    return _caps_M_init(caps, m, xi_, caps->ldim);
+}
+
 /**
  * @brief Kernel of round-trip matrix
  *
@@ -742,6 +1121,164 @@ double caps_kernel_M(int i, int j, void *args_)
     return caps_M_elem(args, l1, l2, p1, p2);
 }
 
+/* index into the arrays of Mie coefficients and polarization (0: E, 1: M)
+ * corresponding to the index i of the round-trip matrix */
+static inline int _l_index(int pol, int i)
+{
+    return pol < 0 ? i/2 : i;
+}
+
+static inline int _p_index(int pol, int i)
+{
+    return pol < 0 ? i%2 : pol;
+}
+
+/* Compute a block of the round-trip matrix. If pol < 0, the polarizations
+ * are interleaved as in caps_kernel_M, i.e., the index i corresponds to
+ * l=lmin+i/2 and polarization i%2. Otherwise only the polarization block pol
+ * (0: EE, 1: MM) is computed and the index i corresponds to l=lmin+i. The
+ * indices are shifted by self->offset, see _caps_logdet_window. */
+static void _caps_kernel_M_block(caps_M_t *self, int i0, int j0, int ni, int nj, double *out, int ld, int pol)
+{
+    i0 += self->offset;
+    j0 += self->offset;
+
+    integration_t *integration = self->integration;
+    const int lmin = self->lmin, m = self->m;
+
+    /* Mie coefficients and diagonal scalings */
+    const int first[2] = { _l_index(pol, i0), _l_index(pol, j0) }, last[2] = { _l_index(pol, i0+ni-1), _l_index(pol, j0+nj-1) };
+    for(int k = 0; k < 2; k++)
+        for(int j = first[k]; j <= last[k]; j++)
+            _caps_M_scaling(self, j);
+
+    const double *logd = self->logd;
+
+    for(int j = 0; j < nj; j++)
+    {
+        const int l2 = lmin+_l_index(pol, j0+j);
+        const int p2 = _p_index(pol, j0+j); /* 0: E, 1: M */
+
+        for(int i = 0; i < ni; i++)
+        {
+            const int l1 = lmin+_l_index(pol, i0+i);
+            const int p1 = _p_index(pol, i0+i);
+            const double prefactor = logd[2*(l1-lmin)+p1]+logd[2*(l2-lmin)+p2];
+            sign_t sign1, sign2;
+            double log1, log2;
+
+            if(p1 == p2)
+            {
+                if(p1 == 0)
+                {
+                    /* EE: √(a_l1*a_l2)*(B_TM - A_TE) */
+                    log1 = caps_integrate_B(integration, l1, l2, TM, &sign1);
+                    log2 = caps_integrate_A(integration, l1, l2, TE, &sign2);
+                }
+                else
+                {
+                    /* MM: √(b_l1*b_l2)*(A_TM - B_TE) */
+                    log1 = caps_integrate_A(integration, l1, l2, TM, &sign1);
+                    log2 = caps_integrate_B(integration, l1, l2, TE, &sign2);
+                }
+            }
+            else if(m == 0)
+            {
+                out[i+j*ld] = 0;
+                continue;
+            }
+            else if(p1 == 0)
+            {
+                /* EM: D_TM - C_TE */
+                log1 = caps_integrate_D(integration, l1, l2, TM, &sign1);
+                log2 = caps_integrate_C(integration, l1, l2, TE, &sign2);
+            }
+            else
+            {
+                /* ME: C_TM - D_TE */
+                log1 = caps_integrate_C(integration, l1, l2, TM, &sign1);
+                log2 = caps_integrate_D(integration, l1, l2, TE, &sign2);
+            }
+
+            out[i+j*ld] = exp(log1+prefactor)*sign1-exp(log2+prefactor)*sign2;
+        }
+    }
+}
+
+/**
+ * @brief Block kernel of round-trip matrix
+ *
+ * This function computes the block of the round-trip matrix
+ * \f$\mathcal{M}^{(m)}\f$ with rows \f$i_0,\dots,i_0+n_i-1\f$ and columns
+ * \f$j_0,\dots,j_0+n_j-1\f$. The indices are the same as for \ref
+ * caps_kernel_M. The block is written to out in column-major order with
+ * leading dimension ld, i.e., \f$\mathcal{M}_{ij}\f$ is stored in
+ * out[(i-i0)+(j-j0)*ld].
+ *
+ * The Mie coefficients and \f$\log\Lambda\f$ enter the matrix elements as
+ * diagonal scalings, \f$\mathcal{M}_{\ell_1\ell_2} = D_{\ell_1}
+ * K_{\ell_1\ell_2} D_{\ell_2}\f$. The scalings are computed once for every
+ * \f$\ell\f$ and stored in the caps_M_t object, so that a matrix element
+ * only needs the integrals.
+ *
+ * This function is intended to be passed as a callback to \ref
+ * kernel_logdet_block.
+ *
+ * @param [in] i0 first row
+ * @param [in] j0 first column
+ * @param [in] ni number of rows
+ * @param [in] nj number of columns
+ * @param [out] out block of round-trip matrix
+ * @param [in] ld leading dimension of out
+ * @param [in] args_ caps_M_t object, see \ref caps_M_init
+ */
+void caps_kernel_M_block(int i0, int j0, int ni, int nj, double *out, int ld, void *args_)
+{
+    _caps_kernel_M_block((caps_M_t *)args_, i0, j0, ni, nj, out, ld, -1);
+}
+
+/**
+ * @brief Block kernel of EE polarization block of round-trip matrix
+ *
+ * Same as \ref caps_kernel_M_block, but only for the polarization block EE
+ * of the round-trip matrix. The matrix has dimension \f$\ell_\mathrm{dim}\f$
+ * and the index i corresponds to \f$\ell=\ell_\mathrm{min}+i\f$.
+ *
+ * For m=0 the polarization blocks EM and ME vanish and the determinant
+ * factorizes into the determinants of the blocks EE and MM, see \ref
+ * caps_logdetD_m0.
+ *
+ * @param [in] i0 first row
+ * @param [in] j0 first column
+ * @param [in] ni number of rows
+ * @param [in] nj number of columns
+ * @param [out] out block of round-trip matrix
+ * @param [in] ld leading dimension of out
+ * @param [in] args_ caps_M_t object, see \ref caps_M_init
+ */
+void caps_kernel_M_block_EE(int i0, int j0, int ni, int nj, double *out, int ld, void *args_)
+{
+    _caps_kernel_M_block((caps_M_t *)args_, i0, j0, ni, nj, out, ld, 0);
+}
+
+/**
+ * @brief Block kernel of MM polarization block of round-trip matrix
+ *
+ * Same as \ref caps_kernel_M_block_EE, but for the polarization block MM.
+ *
+ * @param [in] i0 first row
+ * @param [in] j0 first column
+ * @param [in] ni number of rows
+ * @param [in] nj number of columns
+ * @param [out] out block of round-trip matrix
+ * @param [in] ld leading dimension of out
+ * @param [in] args_ caps_M_t object, see \ref caps_M_init
+ */
+void caps_kernel_M_block_MM(int i0, int j0, int ni, int nj, double *out, int ld, void *args_)
+{
+    _caps_kernel_M_block((caps_M_t *)args_, i0, j0, ni, nj, out, ld, 1);
+}
+
 /**
  * @brief Compute matrix elements of round-trip operator
  *
@@ -760,20 +1297,15 @@ double caps_kernel_M(int i, int j, void *args_)
  */
 double caps_M_elem(caps_M_t *self, int l1, int l2, char p1, char p2)
 {
-    const double xi_ = self->xi_; /* xi_ = xi*(L+R)/c */
     const int lmin = self->lmin;
-    caps_t *caps = self->caps;
     integration_t *integration = self->integration;
 
-    if(isnan(self->al[l1-lmin]))
-        caps_mie(caps, xi_, l1, &self->al[l1-lmin], &self->bl[l1-lmin]);
+    _caps_M_scaling(self, l1-lmin);
+    _caps_M_scaling(self, l2-lmin);
 
-    if(isnan(self->al[l2-lmin]))
-        caps_mie(caps, xi_, l2, &self->al[l2-lmin], &self->bl[l2-lmin]);
-
-    const double lnLambda = caps_lnLambda(l1,l2,self->m);
-    const double al1 = self->al[l1-lmin], bl1 = self->bl[l1-lmin];
-    const double al2 = self->al[l2-lmin], bl2 = self->bl[l2-lmin];
+    /* log(√a_l Λ_l) resp. log(√b_l Λ_l) */
+    const double dE1 = self->logd[2*(l1-lmin)], dM1 = self->logd[2*(l1-lmin)+1];
+    const double dE2 = self->logd[2*(l2-lmin)], dM2 = self->logd[2*(l2-lmin)+1];
 
     if(p1 == p2) /* EE or MM */
     {
@@ -784,8 +1316,8 @@ double caps_M_elem(caps_M_t *self, int l1, int l2, char p1, char p2)
             double log_B_TM = caps_integrate_B(integration, l1, l2, TM, &signB_TM);
 
             /* √(a_l1*a_l2)*(B_TM - A_TE) */
-            double mie = (al1+al2)/2;
-            return exp(log_B_TM+mie+lnLambda)*signB_TM-exp(log_A_TE+mie+lnLambda)*signA_TE;
+            const double d = dE1+dE2;
+            return exp(log_B_TM+d)*signB_TM-exp(log_A_TE+d)*signA_TE;
         }
         else /* MM */
         {
@@ -794,8 +1326,8 @@ double caps_M_elem(caps_M_t *self, int l1, int l2, char p1, char p2)
             double log_B_TE = caps_integrate_B(integration, l1, l2, TE, &signB_TE);
 
             /* √(b_l1*b_l2)*(A_TM - B_TE) */
-            double mie = (bl1+bl2)/2;
-            return exp(log_A_TM+mie+lnLambda)*signA_TM-exp(log_B_TE+mie+lnLambda)*signB_TE;
+            const double d = dM1+dM2;
+            return exp(log_A_TM+d)*signA_TM-exp(log_B_TE+d)*signB_TE;
         }
     }
     else /* EM or ME */
@@ -813,8 +1345,8 @@ double caps_M_elem(caps_M_t *self, int l1, int l2, char p1, char p2)
             double log_D_TM = caps_integrate_D(integration, l1, l2, TM, &signD_TM);
 
             /* D_TM - C_TE */
-            double mie1 = (al1+bl2)/2;
-            return exp(log_D_TM+mie1+lnLambda)*signD_TM-exp(log_C_TE+mie1+lnLambda)*signC_TE;
+            const double d = dE1+dM2;
+            return exp(log_D_TM+d)*signD_TM-exp(log_C_TE+d)*signC_TE;
         }
         else /* ME */
         {
@@ -824,8 +1356,8 @@ double caps_M_elem(caps_M_t *self, int l1, int l2, char p1, char p2)
             double log_D_TE = caps_integrate_D(integration, l1, l2, TE, &signD_TE);
 
             /* C_TM - D_TE */
-            const double mie2 = (bl1+al2)/2;
-            return exp(log_C_TM+mie2+lnLambda)*signC_TM-exp(log_D_TE+mie2+lnLambda)*signD_TE;
+            const double d = dM1+dE2;
+            return exp(log_C_TM+d)*signC_TM-exp(log_D_TE+d)*signD_TE;
         }
     }
 }
@@ -841,6 +1373,8 @@ void caps_M_free(caps_M_t *self)
 {
     xfree(self->al);
     xfree(self->bl);
+    xfree(self->logd);
+    xfree(self->hankel);
     caps_integrate_free(self->integration);
     xfree(self);
 }
@@ -940,6 +1474,9 @@ double caps_kernel_M0_MM(int i, int j, void *args_)
  * matrix for the frequency \f$\xi\mathcal{L}/c\f$ and quantum number
  * \f$m\f$.
  *
+ * For m=0 the polarization blocks EE and MM decouple and the determinants of
+ * both blocks are computed separately, see \ref caps_logdetD_m0.
+ *
  * For \f$\xi=0\f$ see \ref caps_logdetD0.
  *
  * @param self CaPS object
@@ -949,18 +1486,600 @@ double caps_kernel_M0_MM(int i, int j, void *args_)
  */
 double caps_logdetD(caps_t *self, double xi_, int m)
 {
-    TERMINATE(xi_ <= 0, "Matsubara frequency must be positive");
+    return caps_logdetD_stats(self, xi_, m, NULL);
+}
 
+/* dimension of the matrices of which the determinant is computed: for m=0
+ * the polarization blocks EE and MM decouple */
+static int _caps_logdetD_dim(caps_t *self, int m)
+{
+    return (m == 0) ? self->ldim : 2*self->ldim;
+}
+
+/* Combine the statistics of the HODLR computations of the polarization
+ * blocks EE and MM. The trees of both blocks have the same depth; if the
+ * determinant of one block was computed without HODLR, the statistics of the
+ * other block are used. */
+static void _hodlr_stats_merge(hodlr_stats_t *EE, const hodlr_stats_t *MM)
+{
+    if(EE->n_levels == 0)
+    {
+        const double t_assemble = EE->t_assemble, t_factorize = EE->t_factorize;
+        *EE = *MM;
+        EE->t_assemble  += t_assemble;
+        EE->t_factorize += t_factorize;
+        return;
+    }
+
+    if(MM->n_levels == EE->n_levels)
+    {
+        for(int level = 0; level < MIN(EE->n_levels, HODLR_STATS_LEVELS); level++)
+        {
+            EE->rank_max[level]  = MAX(EE->rank_max[level], MM->rank_max[level]);
+            EE->rank_mean[level] = (EE->rank_mean[level]+MM->rank_mean[level])/2;
+        }
+    }
+
+    EE->t_assemble  += MM->t_assemble;
+    EE->t_factorize += MM->t_factorize;
+}
+
+/* Determine the window of the round-trip matrix (or of its polarization
+ * block pol, see _caps_kernel_M_block) of dimension dim, see caps_set_window.
+ * The window is a contiguous range of l; every l corresponds to unit rows of
+ * the matrix. Sets args->offset to the first row of the window and returns
+ * the dimension of the window. */
+static int _caps_window(caps_M_t *args, int pol, int dim)
+{
+    caps_t *caps = args->caps;
+    const int unit = pol < 0 ? 2 : 1, n = dim/unit;
+    double *w = xcalloc(n, sizeof(double));
+    double tr = 0;
+
+    args->offset = 0;
+    for(int i = 0; i < dim; i++)
+    {
+        double d;
+        _caps_kernel_M_block(args, i, i, 1, 1, &d, 1, pol);
+        w[i/unit] += fabs(d);
+        tr += fabs(d);
+    }
+
+    /* discard the end with the smaller weight as long as the discarded
+     * weight stays below the budget */
+    const double budget = caps->window_eps*tr/(1+tr);
+    double discarded = 0;
+    int lo = 0, hi = n;
+    while(hi-lo > 1)
+    {
+        const bool front = w[lo] <= w[hi-1];
+        const double wl = front ? w[lo] : w[hi-1];
+        if(discarded+wl > budget)
+            break;
+
+        discarded += wl;
+        if(front)
+            lo++;
+        else
+            hi--;
+    }
+    xfree(w);
+
+    caps->dim_full   += dim;
+    caps->dim_window += unit*(hi-lo);
+
+    args->offset = unit*lo;
+    return unit*(hi-lo);
+}
+
+/* Same as kernel_logdet_block_stats for the round-trip matrix (pol<0) or its
+ * polarization block pol of dimension dim, but restricted to the adaptive
+ * window if enabled, see caps_set_window. If plus is not NULL, log det(Id+M)
+ * of the same window is stored in plus, see kernel_logdet_block_pm. */
+static double _caps_logdet_window(caps_M_t *args, int pol, int dim, detalg_t detalg, unsigned int nLeaf, hodlr_stats_t *stats, double *plus)
+{
     const int sym_spd = 2; /* matrix is symmetric and positive definite */
-    const int dim = 2*self->ldim;
+    void (*kernels[])(int, int, int, int, double *, int, void *) = { &caps_kernel_M_block, &caps_kernel_M_block_EE, &caps_kernel_M_block_MM };
+    caps_t *caps = args->caps;
+
+    if(caps->window_eps > 0)
+        dim = _caps_window(args, pol, dim);
+    else
+    {
+        caps->dim_full   += dim;
+        caps->dim_window += dim;
+    }
+
+    double logdet;
+    if(plus == NULL)
+        logdet = kernel_logdet_block_stats(dim, kernels[pol+1], args, sym_spd, detalg, nLeaf, stats);
+    else
+        logdet = kernel_logdet_block_pm(dim, kernels[pol+1], args, sym_spd, detalg, nLeaf, stats, plus);
+    args->offset = 0;
+
+    return logdet;
+}
+
+/* Compute log det(Id-M) for the round-trip matrix given by args. For m=0 the
+ * polarization blocks EM and ME vanish and the determinant is computed as
+ * the sum of the determinants of the blocks EE and MM. */
+static double _caps_logdetD_M(caps_M_t *args, detalg_t detalg, unsigned int nLeaf, hodlr_stats_t *stats)
+{
+    const int ldim = args->ldim;
+
+    if(args->m != 0)
+        return _caps_logdet_window(args, -1, 2*ldim, detalg, nLeaf, stats, NULL);
+
+    hodlr_stats_t stats_MM;
+    const double EE = _caps_logdet_window(args, 0, ldim, detalg, nLeaf, stats, NULL);
+    const double MM = _caps_logdet_window(args, 1, ldim, detalg, nLeaf, stats == NULL ? NULL : &stats_MM, NULL);
+
+    if(stats != NULL)
+        _hodlr_stats_merge(stats, &stats_MM);
+
+    return EE+MM;
+}
+
+/* Determine the optimal size of the leaves of the HODLR tree for the
+ * dimension of the round-trip matrix and the regime of m by measurement, see
+ * \ref caps_set_hodlr_tuning. The candidates are tried from shallow to deep
+ * trees; every candidate starts with empty caches for the integrals, so the
+ * times include the computation of the matrix elements. Returns the
+ * determinant computed with the best candidate. */
+static double _caps_hodlr_tune(caps_t *self, double xi_, int m, hodlr_stats_t *stats)
+{
+    const unsigned int candidates[] = { 800, 400, 200, 100, 50, 25, 12 };
+    const int dim = _caps_logdetD_dim(self, m);
+    int n_levels_last = 0;
+    double logdet = NAN, score_best = INFINITY;
+    hodlr_stats_t stats_candidate, stats_best = { .n_levels = 0 };
+    caps_hodlr_tuning_entry_t best = {
+        .log2dim = _hodlr_log2dim(dim),
+        .regime  = _hodlr_regime(m),
+        .nLeaf   = _hodlr_nleaf_default(m),
+        .time    = INFINITY
+    };
+
+    for(size_t i = 0; i < sizeof(candidates)/sizeof(candidates[0]); i++)
+    {
+        const unsigned int nLeaf = candidates[i];
+
+        /* the tree is determined by its depth; skip candidates that give
+         * the same tree as the previous one */
+        const int n_levels = fmax(1, log2((double)dim/nLeaf));
+        if(n_levels == n_levels_last)
+            continue;
+        n_levels_last = n_levels;
+
+        const double t0 = now();
+        caps_M_t *args = caps_M_init(self, m, xi_);
+        const double v = _caps_logdetD_M(args, DETALG_HODLR, nLeaf, &stats_candidate);
+        caps_M_free(args);
+        const double t = now()-t0;
+
+        /* trace approximation was used: nothing to tune */
+        if(stats_candidate.n_levels == 0)
+        {
+            if(stats != NULL)
+                *stats = stats_candidate;
+            return v;
+        }
+
+        /* timings fluctuate by a few percent: the default is only replaced
+         * by a candidate that is faster by more than 5% */
+        const double score = (nLeaf == _hodlr_nleaf_default(m)) ? t/1.05 : t;
+        if(score < score_best)
+        {
+            best.nLeaf = nLeaf;
+            best.time  = t;
+            score_best = score;
+            stats_best = stats_candidate;
+            logdet     = v;
+        }
+        else if(t > 1.5*best.time)
+            /* deeper trees will be even slower */
+            break;
+
+        /* the off-diagonal blocks at the deepest level are not of low rank;
+         * a deeper tree will not pay off */
+        const int deepest = MIN(stats_candidate.n_levels, HODLR_STATS_LEVELS)-1;
+        if(stats_candidate.rank_mean[deepest] > stats_candidate.size[deepest]/2)
+            break;
+    }
+
+    _hodlr_tuning_add(self->tuning, &best);
+    const int saved = _hodlr_tuning_save(self->tuning);
+    WARN(!saved, "cannot write HODLR tuning table to %s", self->tuning->filename);
+
+    if(stats != NULL)
+        *stats = stats_best;
+
+    return logdet;
+}
+
+/** @brief Compute \f$\log\det\mathcal{D}^{(m)}\left(\frac{\xi\mathcal{L}}{c}\right)\f$ and record statistics
+ *
+ * Same as \ref caps_logdetD. If stats is not NULL and the determinant is
+ * computed using HODLR, the rank statistics of the HODLR tree and the times
+ * for assembly and factorization are stored in stats, see \ref
+ * kernel_logdet_block_stats.
+ *
+ * If a tuning table in tuning mode is set (see \ref caps_set_hodlr_tuning)
+ * and the table has no entry for the dimension of the round-trip matrix and
+ * m, the optimal size of the leaves is determined and added to the table.
+ *
+ * @param self CaPS object
+ * @param xi_ \f$\xi\mathcal{L}/c > 0\f$
+ * @param m quantum number \f$m\f$
+ * @param [out] stats statistics of HODLR computation (may be NULL)
+ * @retval logdetD
+ */
+double caps_logdetD_stats(caps_t *self, double xi_, int m, hodlr_stats_t *stats)
+{
+    TERMINATE(xi_ <= 0, "Matsubara frequency must be positive");
+
+    const int dim = _caps_logdetD_dim(self, m);
+    caps_hodlr_tuning_t *tuning = self->tuning;
+
+    const bool hodlr = (self->detalg == DETALG_HODLR || self->detalg == DETALG_AUTO);
+    if(hodlr && tuning != NULL && tuning->tune && _hodlr_tuning_lookup(tuning, dim, m, true) == NULL)
+        return _caps_hodlr_tune(self, xi_, m, stats);
+
+    const unsigned int nLeaf = caps_get_hodlr_nleaf(self, dim, m);
+
+    caps_M_t *args = caps_M_init(self, m, xi_);
+    double logdet = _caps_logdetD_M(args, self->detalg, nLeaf, stats);
+    caps_M_free(args);
+
+    return logdet;
+}
+
+/** @brief Compute contributions of the polarization blocks EE and MM to \f$\log\det\mathcal{D}^{(0)}\left(\frac{\xi\mathcal{L}}{c}\right)\f$
+ *
+ * For m=0 the polarization blocks EM and ME of the round-trip matrix vanish
+ * and \f$\log\det\mathcal{D}^{(0)}\f$ is the sum of the contributions of the
+ * polarization blocks EE and MM. Both matrices have dimension
+ * \f$\ell_\mathrm{dim}\f$ and can be computed independently, e.g., in
+ * parallel. If EE or MM is NULL, the value will not be computed.
+ *
+ * \ref caps_logdetD computes both contributions for m=0 and returns their
+ * sum.
+ *
+ * @param [in]  self CaPS object
+ * @param [in]  xi_ \f$\xi\mathcal{L}/c > 0\f$
+ * @param [out] EE pointer to store contribution for EE block
+ * @param [out] MM pointer to store contribution for MM block
+ */
+void caps_logdetD_m0(caps_t *self, double xi_, double *EE, double *MM)
+{
+    TERMINATE(xi_ <= 0, "Matsubara frequency must be positive");
+
+    const int ldim = self->ldim;
+    const unsigned int nLeaf = caps_get_hodlr_nleaf(self, ldim, 0);
+
+    caps_M_t *args = caps_M_init(self, 0, xi_);
+
+    if(EE != NULL)
+        *EE = _caps_logdet_window(args, 0, ldim, self->detalg, nLeaf, NULL, NULL);
+
+    if(MM != NULL)
+        *MM = _caps_logdet_window(args, 1, ldim, self->detalg, nLeaf, NULL, NULL);
+
+    caps_M_free(args);
+}
+
+/** @brief Compute \f$\log\det(1-\mathcal{M}^{(m)})\f$ and \f$\log\det(1+\mathcal{M}^{(m)})\f$ from one round-trip matrix
+ *
+ * For two equal spheres of radius R at surface-to-surface separation
+ * \f$d=2L\f$, the plane of symmetry acts as a perfect mirror. For perfect
+ * reflectors the round-trip operator of the sphere-sphere geometry is then
+ * given by \f$\mathcal{M}^2\f$, where \f$\mathcal{M}\f$ is the round-trip
+ * operator of the plane-sphere geometry at separation L, and
+ * \f[
+ *  \log\det(1-\mathcal{M}^2) = \log\det(1-\mathcal{M}) + \log\det(1+\mathcal{M}).
+ * \f]
+ * This function computes both determinants using the same matrix elements,
+ * see \ref kernel_logdet_block_pm. The first is returned (and equals \ref
+ * caps_logdetD), the second is stored in logdetD_plus.
+ *
+ * For m=0 block selects the polarization block EE (0) or MM (1); if block is
+ * -1, the contributions of both blocks are added (see \ref caps_logdetD_m0).
+ * For m≠0 block must be -1.
+ *
+ * @param [in]  self CaPS object
+ * @param [in]  xi_ \f$\xi\mathcal{L}/c > 0\f$
+ * @param [in]  m quantum number \f$m\f$
+ * @param [in]  block polarization block for m=0: -1 (all), 0 (EE), 1 (MM)
+ * @param [out] logdetD_plus \f$\log\det(1+\mathcal{M}^{(m)})\f$
+ * @retval logdetD \f$\log\det(1-\mathcal{M}^{(m)})\f$
+ */
+double caps_logdetD_pm(caps_t *self, double xi_, int m, int block, double *logdetD_plus)
+{
+    TERMINATE(xi_ <= 0, "Matsubara frequency must be positive");
+    TERMINATE(m != 0 && block >= 0, "polarization blocks only decouple for m=0");
+
+    const int ldim = self->ldim;
+    const int dim = _caps_logdetD_dim(self, m);
+    const unsigned int nLeaf = caps_get_hodlr_nleaf(self, dim, m);
+    double logdet = 0, plus = 0;
 
     caps_M_t *args = caps_M_init(self, m, xi_);
-    double logdet = kernel_logdet(dim, &caps_kernel_M, args, sym_spd, self->detalg);
+
+    if(m != 0)
+        logdet = _caps_logdet_window(args, -1, 2*ldim, self->detalg, nLeaf, NULL, &plus);
+    else
+    {
+        for(int pol = 0; pol < 2; pol++)
+        {
+            if(block >= 0 && block != pol)
+                continue;
+
+            double plus_pol;
+            logdet += _caps_logdet_window(args, pol, ldim, self->detalg, nLeaf, NULL, &plus_pol);
+            plus   += plus_pol;
+        }
+    }
+
     caps_M_free(args);
 
+    *logdetD_plus = plus;
     return logdet;
 }
 
+/** @brief Compute \f$\log\det\mathcal{D}^{(m)}\left(\frac{\xi\mathcal{L}}{c}\right)\f$ for a sequence of truncations
+ *
+ * Compute \f$\log\det\mathcal{D}^{(m)}\f$ for the truncations
+ * \f$\ell_\mathrm{dim}=\f$ldims[0],...,ldims[n-1] of the vector space and
+ * store the results in out. This is useful to check the convergence with
+ * respect to \f$\ell_\mathrm{dim}\f$, see \ref caps_set_ldim. The value of
+ * ldim of the CaPS object is not used.
+ *
+ * The vector spaces of smaller truncations are contained in the vector
+ * spaces of larger truncations, see \ref caps_estimate_lminmax, i.e., the
+ * truncated round-trip matrices are principal submatrices of the round-trip
+ * matrix of the largest truncation. All matrices share the Mie coefficients
+ * and the caches of the integrals. If a dense algorithm is used, a single
+ * Cholesky decomposition of the largest round-trip matrix gives the
+ * determinants of all truncations, see \ref kernel_logdet_block_nested.
+ *
+ * @param [in]  self CaPS object
+ * @param [in]  xi_ \f$\xi\mathcal{L}/c > 0\f$
+ * @param [in]  m quantum number \f$m\f$
+ * @param [in]  ldims truncations \f$\ell_\mathrm{dim}\f$ (in any order)
+ * @param [in]  n number of truncations
+ * @param [out] out \f$\log\det\mathcal{D}^{(m)}\f$ for truncation ldims[k] stored in out[k]
+ */
+void caps_logdetD_sequence(caps_t *self, double xi_, int m, const int ldims[], int n, double out[])
+{
+    TERMINATE(xi_ <= 0, "Matsubara frequency must be positive");
+    TERMINATE(n < 1, "n=%d", n);
+
+    const int sym_spd = 2; /* matrix is symmetric and positive definite */
+
+    /* order[k] is the index of the k-th smallest truncation */
+    int *order = xmalloc(5*(size_t)n*sizeof(int));
+    int *start = order+n, *size = order+2*n, *start_l = order+3*n, *size_l = order+4*n;
+    double *logdet = xmalloc(2*(size_t)n*sizeof(double));
+    double *logdet_MM = logdet+n;
+
+    for(int k = 0; k < n; k++)
+    {
+        TERMINATE(ldims[k] < 1, "ldims[%d]=%d", k, ldims[k]);
+
+        int i = k;
+        for(; i > 0 && ldims[order[i-1]] > ldims[k]; i--)
+            order[i] = order[i-1];
+        order[i] = k;
+    }
+
+    const int ldim = ldims[order[n-1]];
+    size_t lmin, lmin_k, lmax;
+    _caps_estimate_lminmax(self, m, ldim, &lmin, &lmax);
+
+    /* windows of the truncations in terms of l: l = lmin+start_l, ..., lmin+start_l+size_l-1 */
+    for(int k = 0; k < n; k++)
+    {
+        _caps_estimate_lminmax(self, m, ldims[order[k]], &lmin_k, &lmax);
+        start_l[k] = lmin_k-lmin;
+        size_l[k]  = ldims[order[k]];
+    }
+
+    caps_M_t *args = _caps_M_init(self, m, xi_, ldim);
+
+    if(m == 0)
+    {
+        /* polarization blocks EE and MM decouple, see caps_logdetD_m0 */
+        const unsigned int nLeaf = caps_get_hodlr_nleaf(self, ldim, m);
+        kernel_logdet_block_nested(n, start_l, size_l, &caps_kernel_M_block_EE, args, sym_spd, self->detalg, nLeaf, logdet);
+        kernel_logdet_block_nested(n, start_l, size_l, &caps_kernel_M_block_MM, args, sym_spd, self->detalg, nLeaf, logdet_MM);
+
+        for(int k = 0; k < n; k++)
+            logdet[k] += logdet_MM[k];
+    }
+    else
+    {
+        /* polarizations are interleaved, see caps_kernel_M */
+        for(int k = 0; k < n; k++)
+        {
+            start[k] = 2*start_l[k];
+            size[k]  = 2*size_l[k];
+        }
+
+        const unsigned int nLeaf = caps_get_hodlr_nleaf(self, 2*ldim, m);
+        kernel_logdet_block_nested(n, start, size, &caps_kernel_M_block, args, sym_spd, self->detalg, nLeaf, logdet);
+    }
+
+    caps_M_free(args);
+
+    for(int k = 0; k < n; k++)
+        out[order[k]] = logdet[k];
+
+    xfree(logdet);
+    xfree(order);
+}
+
+/* Compute the block of D=Id-M (k=0) or of its derivative -∂_α^k M (k=1,2)
+ * with respect to α=2ξ𝓛/c for the polarization block given by kernel_block
+ * and store it in A. */
+static void _caps_D_alpha(caps_M_t *args, int k, void (*kernel_block)(int,int,int,int,double *,int,void *), matrix_t *A)
+{
+    const int dim = A->dim;
+
+    caps_integrate_set_derivative(args->integration, k);
+    kernel_block(0, 0, dim, dim, A->M, A->lda, args);
+    caps_integrate_set_derivative(args->integration, 0);
+
+    for(size_t i = 0; i < A->dim2; i++)
+        A->M[i] = -A->M[i];
+
+    if(k == 0)
+        for(int i = 0; i < dim; i++)
+            matrix_get(A, i, i) += 1;
+}
+
+/* derivatives of log det D with respect to α for the polarization block
+ * given by kernel_block, see caps_dlogdetD_dL */
+static double _caps_dlogdetD_alpha(caps_M_t *args, int dim, void (*kernel_block)(int,int,int,int,double *,int,void *), double *d2)
+{
+    matrix_t *D   = matrix_alloc(dim);
+    matrix_t *dD  = matrix_alloc(dim);
+    matrix_t *d2D = (d2 == NULL) ? NULL : matrix_alloc(dim);
+
+    _caps_D_alpha(args, 0, kernel_block, D);
+    _caps_D_alpha(args, 1, kernel_block, dD);
+    if(d2D != NULL)
+        _caps_D_alpha(args, 2, kernel_block, d2D);
+
+    const double d1 = matrix_dlogdet_lu(D, dD, d2D, d2);
+
+    matrix_free(D);
+    matrix_free(dD);
+    if(d2D != NULL)
+        matrix_free(d2D);
+
+    return d1;
+}
+
+/** @brief Compute derivative of \f$\log\det\mathcal{D}^{(m)}(\xi)\f$ with respect to the separation
+ *
+ * Compute \f$\partial_L \log\det\mathcal{D}^{(m)}(\xi)\f$ at fixed
+ * frequency \f$\xi\f$ and, if d2 is not NULL, the second derivative
+ * \f$\partial_L^2 \log\det\mathcal{D}^{(m)}(\xi)\f$. The derivatives
+ * are in units of \f$1/\mathrm{m}\f$ and \f$1/\mathrm{m}^2\f$,
+ * respectively. The force is obtained by summing the first derivative over
+ * \f$m\f$ and the Matsubara frequencies in the same way as the free energy
+ * is obtained from \ref caps_logdetD.
+ *
+ * At fixed \f$\xi\f$ the round-trip matrix depends on \f$L\f$ only through
+ * the factor \f$e^{-\alpha x}\f$ in the integrals
+ * \f$\mathcal{K}_{\nu,p}^{(m)}\f$ with \f$\alpha=2\xi\mathcal{L}/c\f$,
+ * see \ref caps_integrate_set_derivative. The derivatives are computed as
+ * \f[
+ *  \partial_\alpha \log\det\mathcal{D} = -\mathrm{tr}\left(\mathcal{D}^{-1}\partial_\alpha\mathcal{M}\right),
+ *  \quad
+ *  \partial_\alpha^2 \log\det\mathcal{D} = -\mathrm{tr}\left(\mathcal{D}^{-1}\partial_\alpha^2\mathcal{M}\right) - \mathrm{tr}\left[\left(\mathcal{D}^{-1}\partial_\alpha\mathcal{M}\right)^2\right]
+ * \f]
+ * using an LU decomposition of the round-trip matrix, see \ref
+ * matrix_dlogdet_lu. In contrast to \ref caps_logdetD the matrices are
+ * dense, i.e., the costs grow with the third power of
+ * \f$\ell_\mathrm{dim}\f$ and HODLR is not used.
+ *
+ * @param [in]  self CaPS object
+ * @param [in]  xi_ \f$\xi\mathcal{L}/c > 0\f$
+ * @param [in]  m quantum number \f$m\f$
+ * @param [out] d2 \f$\partial_L^2 \log\det\mathcal{D}^{(m)}\f$ if not NULL
+ * @retval d1 \f$\partial_L \log\det\mathcal{D}^{(m)}\f$
+ */
+double caps_dlogdetD_dL(caps_t *self, double xi_, int m, double *d2)
+{
+    TERMINATE(xi_ <= 0, "Matsubara frequency must be positive");
+
+    const int ldim = self->ldim;
+    double d1, d2_alpha = 0;
+    caps_M_t *args = caps_M_init(self, m, xi_);
+
+    if(m == 0)
+    {
+        /* polarization blocks EE and MM decouple, see caps_logdetD_m0 */
+        double d2_EE, d2_MM;
+        d1  = _caps_dlogdetD_alpha(args, ldim, &caps_kernel_M_block_EE, d2 == NULL ? NULL : &d2_EE);
+        d1 += _caps_dlogdetD_alpha(args, ldim, &caps_kernel_M_block_MM, d2 == NULL ? NULL : &d2_MM);
+        if(d2 != NULL)
+            d2_alpha = d2_EE+d2_MM;
+    }
+    else
+        d1 = _caps_dlogdetD_alpha(args, 2*ldim, &caps_kernel_M_block, d2 == NULL ? NULL : &d2_alpha);
+
+    caps_M_free(args);
+
+    /* α = 2ξ(L+R)/c, i.e., ∂_L = 2ξ/c ∂_α */
+    const double dalpha_dL = 2*xi_/self->calL;
+
+    if(d2 != NULL)
+        *d2 = pow_2(dalpha_dL)*d2_alpha;
+
+    return dalpha_dL*d1;
+}
+
+
+/* Diagonal scalings and Hankel generator of the blocks EE and MM at ξ=0.
+ *
+ * The matrix elements (see caps_kernel_M0_EE and caps_kernel_M0_MM) are
+ *      M_l1,l2 = D_l1 (l1+l2)! D_l2,
+ * i.e., a Hankel matrix in l1+l2 scaled by
+ *      log D_l = (l+1/2)y - (log((l+m)!) + log((l-m)!))/2
+ * and, for MM, in addition by √(l/(l+1)). The scalings are stored in
+ * self->logd (EE at 2(l-lmin), MM at 2(l-lmin)+1) and the generator
+ * log((l1+l2)!) in self->hankel, so every matrix element needs a single
+ * exponential. As (l1+l2)! overflows and D_l underflows, the elements are
+ * assembled in log space; fast Hankel products are not an option. */
+static void _caps_M0_scaling(caps_M_t *self)
+{
+    const int lmin = self->lmin, ldim = self->ldim, m = self->m;
+    const double y = self->caps->y;
+
+    self->logd   = xmalloc(2*ldim*sizeof(double));
+    self->hankel = xmalloc(2*ldim*sizeof(double));
+
+    for(int j = 0; j < ldim; j++)
+    {
+        const int l = lmin+j;
+        const double logd = (l+0.5)*y - 0.5*(lfac(l+m)+lfac(l-m));
+
+        self->logd[2*j]   = logd;
+        self->logd[2*j+1] = logd + 0.5*log(l/(l+1.));
+    }
+
+    for(int k = 0; k < 2*ldim-1; k++)
+        self->hankel[k] = lfac(2*lmin+k);
+}
+
+/* block kernel of the polarization block p (0: EE, 1: MM) at ξ=0, see
+ * _caps_M0_scaling */
+static void _caps_kernel_M0_block(caps_M_t *self, int i0, int j0, int ni, int nj, double *out, int ld, int p)
+{
+    const double *logd = self->logd;
+
+    for(int j = 0; j < nj; j++)
+    {
+        const double logd_j = logd[2*(j0+j)+p];
+        const double *hankel = &self->hankel[i0+j0+j];
+        double *column = &out[(size_t)j*ld];
+
+        for(int i = 0; i < ni; i++)
+            column[i] = exp(hankel[i] + logd[2*(i0+i)+p] + logd_j);
+    }
+}
+
+static void _caps_kernel_M0_block_EE(int i0, int j0, int ni, int nj, double *out, int ld, void *args)
+{
+    _caps_kernel_M0_block((caps_M_t *)args, i0, j0, ni, nj, out, ld, 0);
+}
+
+static void _caps_kernel_M0_block_MM(int i0, int j0, int ni, int nj, double *out, int ld, void *args)
+{
+    _caps_kernel_M0_block((caps_M_t *)args, i0, j0, ni, nj, out, ld, 1);
+}
 
 /** @brief Compute \f$\log\det\mathcal{D}^{(m)}(\xi=0)\f$ for EE and/or MM contribution
  *
@@ -999,14 +2118,24 @@ void caps_logdetD0(caps_t *self, int m, double omegap, double *EE, double *MM, d
         .integration_plasma = NULL,
         .al = NULL,
         .bl = NULL,
-        .lmin = lmin
+        .logd = NULL,
+        .hankel = NULL,
+        .lmin = lmin,
+        .ldim = ldim
     };
 
+    /* EE and MM: structured kernels, see _caps_M0_scaling */
+    if(EE != NULL || MM != NULL)
+        _caps_M0_scaling(&args);
+
     if(EE != NULL)
-        *EE = kernel_logdet(ldim, &caps_kernel_M0_EE, &args, sym_spd, detalg);
+        *EE = kernel_logdet_block(ldim, &_caps_kernel_M0_block_EE, &args, sym_spd, detalg);
 
     if(MM != NULL)
-        *MM = kernel_logdet(ldim, &caps_kernel_M0_MM, &args, sym_spd, detalg);
+        *MM = kernel_logdet_block(ldim, &_caps_kernel_M0_block_MM, &args, sym_spd, detalg);
+
+    xfree(args.logd);
+    xfree(args.hankel);
 
     if(MM_plasma != NULL)
     {
@@ -1064,6 +2193,74 @@ double caps_ht_drude(caps_t *caps)
     return 0.5*(sum1 + log1p(-(1-pow_2(Z))*sum2));
 }
 
+/* term m of a sum over m in the high-temperature limit, see _caps_ht_sum_m */
+typedef struct {
+    caps_t *caps;
+    int m;
+    double omegap; /* plasma frequency for the plasma model, 0 for perfect reflectors */
+    double v;      /* MM contribution of m */
+    pthread_t thread;
+} caps_ht_term_t;
+
+static void *_caps_ht_term(void *args)
+{
+    caps_ht_term_t *term = (caps_ht_term_t *)args;
+
+    if(term->omegap > 0)
+        caps_logdetD0(term->caps, term->m, term->omegap, NULL, NULL, &term->v);
+    else
+        caps_logdetD0(term->caps, term->m, 0, NULL, &term->v, NULL);
+
+    return NULL;
+}
+
+/* Add the MM contributions of m=m0,m0+1,... (m=0 with half weight) to sum
+ * until the contribution of m relative to the sum is smaller than eps; the
+ * contributions of the plasma model with plasma frequency omegap (in rad/s)
+ * if omegap > 0, of perfect reflectors otherwise. self->threads terms are
+ * computed in parallel, see caps_set_threads. */
+static double _caps_ht_sum_m(caps_t *self, int m0, double omegap, double sum, double eps)
+{
+    const int threads = self->threads;
+    caps_ht_term_t *terms = xmalloc(threads*sizeof(caps_ht_term_t));
+
+    /* the cost model is initialized on first use, which is not thread-safe */
+    if(threads > 1 && self->detalg == DETALG_AUTO)
+        kernel_logdet_get_model();
+
+    for(int m = m0; true; m += threads)
+    {
+        for(int k = 0; k < threads; k++)
+        {
+            caps_ht_term_t *term = &terms[k];
+            term->caps = self;
+            term->m = m+k;
+            term->omegap = omegap;
+
+            if(threads == 1)
+                _caps_ht_term(term);
+            else
+                TERMINATE(pthread_create(&term->thread, NULL, _caps_ht_term, term) != 0, "cannot create thread");
+        }
+
+        if(threads > 1)
+            for(int k = 0; k < threads; k++)
+                pthread_join(terms[k].thread, NULL);
+
+        for(int k = 0; k < threads; k++)
+        {
+            const double v = terms[k].v;
+            sum += (m+k == 0) ? v/2 : v;
+
+            if(fabs(v/sum) < eps)
+            {
+                xfree(terms);
+                return sum;
+            }
+        }
+    }
+}
+
 /** @brief Compute free energy in the high-temperature limit for perfect reflectors
  *
  * For perfect reflectors the Fresnel coefficients become
@@ -1082,6 +2279,9 @@ double caps_ht_drude(caps_t *caps)
  *  - [1] Bimonte, Classical Casimir interaction of perfectly conducting sphere
  *    and plate (2017), https://arxiv.org/abs/1701.06461
  *
+ * The determinants for different m are computed in parallel if more than one
+ * thread is set, see \ref caps_set_threads.
+ *
  * @param [in] caps CaPS object
  * @param [in] eps \f$\epsilon\f$ abort criterion
  * @retval energy free energy in units of \f$k_\mathrm{B}T\f$
@@ -1103,21 +2303,14 @@ double caps_ht_perf(caps_t *caps, double eps)
             break;
     }
 
-    for(int m = 1; true; m++)
-    {
-        double v;
-        caps_logdetD0(caps, m, 0, NULL, &v, NULL);
-
-        MM += v;
-
-        if(fabs(v/MM) < eps)
-            return drude+MM;
-    }
+    /* m ≥ 1, see caps_set_threads */
+    return drude+_caps_ht_sum_m(caps, 1, 0, MM, eps);
 }
 
 /** @brief Compute free energy in the high-temperature limit for plasma model
  *
- * The abort criterion eps is the same as in \ref caps_ht_perf.
+ * The abort criterion eps and the parallelization over m are the same as in
+ * \ref caps_ht_perf.
  *
  * @param [in] caps CaPS object
  * @param [in] omegap plasma frequency in rad/s
@@ -1127,21 +2320,9 @@ double caps_ht_perf(caps_t *caps, double eps)
 double caps_ht_plasma(caps_t *caps, double omegap, double eps)
 {
     const double drude = caps_ht_drude(caps);
-    double MM_plasma = 0;
-
-    for(int m = 0; true; m++)
-    {
-        double v;
-        caps_logdetD0(caps, m, omegap, NULL, NULL, &v);
 
-        if(m == 0)
-            MM_plasma += v/2;
-        else
-            MM_plasma += v;
-
-        if(fabs(v/MM_plasma) < eps)
-            return drude+MM_plasma;
-    }
+    /* see caps_set_threads */
+    return drude+_caps_ht_sum_m(caps, 0, omegap, 0, eps);
 }
 
 /*@}*/
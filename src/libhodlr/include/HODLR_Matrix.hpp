@@ -8,7 +8,7 @@
 #include <Eigen/Dense>
 #include <iostream>
 #include <iomanip>
-#include <set>
+#include <algorithm>
 #include <vector>
 // Used to dump data:
 #include <fstream>
@@ -56,6 +56,10 @@ friend class HODLR_Tree;
 private:
     // Size of the matrix:
     int N;
+    // Number of rows fetched at once by rookPiv when searching a new pivot row:
+    int aca_batch;
+    // Matrix entries may be computed concurrently by several threads:
+    bool thread_safe;
 
 public:
 
@@ -63,6 +67,26 @@ public:
     HODLR_Matrix(int N)
     {
         this->N = N;
+        this->aca_batch = 1;
+        this->thread_safe = false;
+    }
+
+    // When the residual row in rookPiv vanishes, fetch batch consecutive
+    // candidate rows with a single call of getMatrixBlock and continue with
+    // the one with the largest pivot. This pays off if getMatrixBlock is
+    // cheaper per entry than getMatrixEntry:
+    void setACABatch(int batch)
+    {
+        this->aca_batch = batch;
+    }
+
+    // If getMatrixEntry and getMatrixBlock may be called concurrently from
+    // several threads, blocks of the tree are assembled in parallel (when
+    // compiled with OpenMP). By default matrix entries are computed by one
+    // thread at a time:
+    void setThreadSafe(bool thread_safe)
+    {
+        this->thread_safe = thread_safe;
     }
 
     // Returns individual matrix 
@@ -74,12 +98,20 @@ public:
         return 0.0;
     }
 
+    // Writes the block starting at (j,k) of size n_rows x n_cols into out
+    // (column major, leading dimension ld). By default the block is
+    // assembled entry by entry using getMatrixEntry; derived classes may
+    // override this to compute whole blocks at once:
+    virtual void getMatrixBlock(int j, int k, int n_rows, int n_cols, dtype *out, int ld);
+
     Vec getRow(int j, int n_col_start, int n_cols);
     Vec getCol(int k, int n_row_start, int n_rows);
     Mat getMatrix(int j, int k, int n_rows, int n_cols);
 
-    void maxAbsVector(const Vec& v, 
-                      const std::set<int>& allowed_indices, 
+    // Entry of v (of length n) with the largest magnitude among the indices
+    // i with used[i] == 0; index = -1 if all indices are used:
+    void maxAbsVector(const dtype* v, int n,
+                      const std::vector<char>& used,
                       dtype& max, int& index
                      );
 
@@ -26,6 +26,8 @@ private:
     Mat K;
 
     // Variables and methods needed for HODLR solver
+    // For symmetric matrices only U[0] and V[1] are stored, since
+    // V[0] = U[0] and U[1] = V[1]:
     Mat U[2], V[2];
     Mat U_factor[2], V_factor[2];
     Eigen::PartialPivLU<Mat> K_factor_LU;
@@ -34,14 +36,19 @@ private:
     // Unitary matrices:
     Mat Q[2];
     Eigen::LLT<Mat> K_factor_LLT;
+    // Contribution of the node to the log determinant:
+    dtype log_det;
 
     // Methods for Leaf Nodes:
     void assembleLeafNode(HODLR_Matrix* A);
-    void matmatProductLeaf(Mat x, Mat& b);
+    void matmatProductLeaf(const Eigen::Ref<const Mat>& x, Mat& b);
 
     // Methods for Non-leaf Nodes:
     void assembleNonLeafNode(HODLR_Matrix* A, bool is_sym);
-    void matmatProductNonLeaf(Mat x, Mat& b);
+    void matmatProductNonLeaf(const Eigen::Ref<const Mat>& x, Mat& b, bool is_sym);
+
+    // Frees all matrices and factorizations stored in the node:
+    void releaseData();
 
     // Method to print the parameters of the node(mainly used to debug)
     void printNodeDetails();
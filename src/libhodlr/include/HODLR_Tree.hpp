@@ -1,6 +1,8 @@
 #ifndef __HODLR_Tree__
 #define __HODLR_Tree__
 
+#include <new>
+#include <utility>
 #include <Eigen/Dense>
 #include "HODLR_Matrix.hpp"
 #include "HODLR_Node.hpp"
@@ -17,35 +19,52 @@ private:
     
     // Vector of levels(which contain nodes) thereby giving the tree:
     std::vector<std::vector<HODLR_Node*>> tree;
+    // All nodes of the tree are stored in a single contiguous block of
+    // memory; node k of level j is nodes[2^j-1+k]:
+    HODLR_Node* nodes;
     void createTree();
-    void createRoot();
-    void createChildren(int level_number, int node_number);
+
+    // Factorization of the tree: the subtrees rooted at level task_level are
+    // factorized concurrently (one task per node down to task_depth levels
+    // below task_level, serially below), the levels above are factorized
+    // node by node so that dense linear algebra may use threads. If release
+    // is true, the contribution of each node to the log determinant is
+    // stored and the node data released afterwards:
+    static const int task_depth = 2;
+    int task_level;
+    void factorizeTree(bool release);
+    void factorizeSubtree(int level_number, int node_number, bool release);
+    void factorizeNode(int level_number, int node_number, bool release);
+
+    // The solve methods below work in place, i.e., the right hand side b is
+    // overwritten by the solution.
 
     // Methods needed for the nonSPD HODLR solver:
     void factorizeLeafNonSPD(int node_number);
     void factorizeNonLeafNonSPD(int level_number, int node_number);
     void factorizeNonSPD();
-    Mat solveLeafNonSPD(int node_number, Mat b);
-    Mat solveNonLeafNonSPD(int level_number, int node_number, Mat b);
-    Mat solveNonSPD(Mat b);
+    void solveLeafNonSPD(int node_number, Eigen::Ref<Mat> b);
+    void solveNonLeafNonSPD(int level_number, int node_number, Eigen::Ref<Mat> b);
+    void solveNonSPD(Eigen::Ref<Mat> b);
     dtype logDeterminantNonSPD();
+    dtype factorizeLogDeterminantNonSPD();
 
     // Methods needed for the SPD HODLR solver:
     void factorizeLeafSPD(int node_number);
     void factorizeNonLeafSPD(int level_number, int node_number);
     void factorizeSPD();
     void qr(int level_number, int node_number);
-    void qrForLevel(int level_number);
-    Mat solveLeafSymmetricFactor(int node_number, Mat b);
-    Mat solveNonLeafSymmetricFactor(int level_number, int node_number, Mat b);
-    Mat solveSymmetricFactor(Mat b);
-    Mat solveLeafSymmetricFactorTranspose(int node_number, Mat b);
-    Mat solveNonLeafSymmetricFactorTranspose(int level_number, int node_number, Mat b);
-    Mat solveSymmetricFactorTranspose(Mat b);
-    Mat solveSPD(Mat b);
-    Mat SymmetricFactorNonLeafProduct(int level_number, int node_number, Mat b);
-    Mat SymmetricFactorTransposeNonLeafProduct(int level_number, int node_number, Mat b);
+    void solveLeafSymmetricFactor(int node_number, Eigen::Ref<Mat> b);
+    void solveNonLeafSymmetricFactor(int level_number, int node_number, Eigen::Ref<Mat> b);
+    void solveSymmetricFactor(Eigen::Ref<Mat> b);
+    void solveLeafSymmetricFactorTranspose(int node_number, Eigen::Ref<Mat> b);
+    void solveNonLeafSymmetricFactorTranspose(int level_number, int node_number, Eigen::Ref<Mat> b);
+    void solveSymmetricFactorTranspose(Eigen::Ref<Mat> b);
+    void solveSPD(Eigen::Ref<Mat> b);
+    void SymmetricFactorNonLeafProduct(int level_number, int node_number, Eigen::Ref<Mat> b);
+    void SymmetricFactorTransposeNonLeafProduct(int level_number, int node_number, Eigen::Ref<Mat> b);
     dtype logDeterminantSPD();
+    dtype factorizeLogDeterminantSPD();
 
 public:
     HODLR_Tree(int n_levels, double tolerance, HODLR_Matrix* A);
@@ -58,13 +77,23 @@ public:
     // Lists details of all boxes in the tree
     void printTreeDetails();
     void plotTree();
-    Mat matmatProduct(Mat x);
+    // Maximal and mean rank of the off-diagonal blocks of level level_number
+    // (0 <= level_number < n_levels) and mean size of these blocks; only
+    // available after assembleTree:
+    void getRankStatistics(int level_number, int& rank_max, double& rank_mean, double& block_size);
+    Mat matmatProduct(const Eigen::Ref<const Mat>& x);
     void factorize();
+    // The following methods take b by value and work on it in place; pass
+    // an rvalue (e.g. std::move(b)) to avoid a copy:
     Mat solve(Mat b);
-    Mat symmetricFactorProduct(Mat x);
-    Mat symmetricFactorTransposeProduct(Mat x);
+    Mat symmetricFactorProduct(Mat b);
+    Mat symmetricFactorTransposeProduct(Mat b);
     Mat getSymmetricFactor();
     dtype logDeterminant();
+    // Factorizes the matrix and returns the log determinant. The data of a
+    // node is released as soon as no other level references it, so the
+    // tree can not be used afterwards:
+    dtype factorizeLogDeterminant();
 };
 
 #endif /*__HODLR_Tree__*/
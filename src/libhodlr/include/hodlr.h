@@ -13,6 +13,26 @@
 #define EXTERNC
 #endif
 
+/** @brief maximal number of levels for which statistics are recorded */
+#define HODLR_STATS_LEVELS 32
+
+/** @brief Statistics of a HODLR computation
+ *
+ * Rank statistics are recorded for the levels 0,...,n_levels-1 of the tree
+ * (at most HODLR_STATS_LEVELS levels). Level 0 contains the two largest
+ * off-diagonal blocks, the level n_levels-1 the smallest off-diagonal blocks
+ * just above the leaves.
+ */
+typedef struct {
+    int n_levels;                          /**< number of levels of the tree */
+    unsigned int nLeaf;                    /**< requested size of the leaves */
+    int rank_max[HODLR_STATS_LEVELS];      /**< maximal rank of the off-diagonal blocks of a level */
+    double rank_mean[HODLR_STATS_LEVELS];  /**< mean rank of the off-diagonal blocks of a level */
+    double size[HODLR_STATS_LEVELS];       /**< mean size of the off-diagonal blocks of a level */
+    double t_assemble;                     /**< time in seconds to assemble the tree */
+    double t_factorize;                    /**< time in seconds to factorize the tree */
+} hodlr_stats_t;
+
 /** @brief Calculate \f$\log\mathrm{det}(1-M)\f$ using HODLR approach
  *
  * Compute log det(1-A) for a matrix A of dimension given by dim. The diagonal
@@ -41,6 +61,45 @@
  */
 EXTERNC double hodlr_logdet_diagonal(int dim, double (*callback)(int,int,void *), void *args, double *diagonal, unsigned int nLeaf, double tolerance, int is_symmetric);
 
+/** @brief Calculate \f$\log\mathrm{det}(1-M)\f$ using HODLR approach and a block kernel
+ *
+ * Same as \ref hodlr_logdet_diagonal, but the matrix elements of M are given
+ * by a block kernel. A call callback_block(i0,j0,ni,nj,out,ld,args) must
+ * write the block of M with rows i0,...,i0+ni-1 and columns j0,...,j0+nj-1
+ * into out. The storage is column major with leading dimension ld, i.e.,
+ * M_ij is stored in out[(i-i0)+(j-j0)*ld]. Rows, columns and leaf blocks of
+ * the HODLR matrix are each computed by a single call of callback_block.
+ *
+ * @param dim            dimension of matrix M
+ * @param callback_block function that computes blocks of M
+ * @param args           pointer that is passed as last argument to callback_block
+ * @param diagonal       array with the diagonal elements of M
+ * @param nLeaf          nLeaf is the dimension of the smallest block at the leaf level
+ * @param tolerance      requested accuracy of result
+ * @param sym_spd        specifiy whether matrix is generic (0), symmetric (1) or spd (2)
+ * @retval logdet        \f$\log\mathrm{det}(1-M)\f$
+ */
+EXTERNC double hodlr_logdet_diagonal_block(int dim, void (*callback_block)(int,int,int,int,double *,int,void *), void *args, double *diagonal, unsigned int nLeaf, double tolerance, int sym_spd);
+
+/** @brief Calculate \f$\log\mathrm{det}(1-M)\f$ using a block kernel and record statistics
+ *
+ * Same as \ref hodlr_logdet_diagonal_block. In addition, the ranks of the
+ * off-diagonal blocks of every level and the times needed for assembly and
+ * factorization are stored in stats. If stats is NULL, this function is
+ * identical to \ref hodlr_logdet_diagonal_block.
+ *
+ * @param dim            dimension of matrix M
+ * @param callback_block function that computes blocks of M
+ * @param args           pointer that is passed as last argument to callback_block
+ * @param diagonal       array with the diagonal elements of M
+ * @param nLeaf          nLeaf is the dimension of the smallest block at the leaf level
+ * @param tolerance      requested accuracy of result
+ * @param sym_spd        specifiy whether matrix is generic (0), symmetric (1) or spd (2)
+ * @param [out] stats    statistics of the computation (may be NULL)
+ * @retval logdet        \f$\log\mathrm{det}(1-M)\f$
+ */
+EXTERNC double hodlr_logdet_diagonal_block_stats(int dim, void (*callback_block)(int,int,int,int,double *,int,void *), void *args, double *diagonal, unsigned int nLeaf, double tolerance, int sym_spd, hodlr_stats_t *stats);
+
 /** @brief Calculate log(det(Id-M)) using HODLR approach
  *
  * See \ref hodlr_logdet_diagonal for more information.
@@ -1,13 +1,24 @@
 #include "HODLR_Matrix.hpp"
 
+void HODLR_Matrix::getMatrixBlock(const int n_row_start, const int n_col_start,
+                                  const int n_rows, const int n_cols,
+                                  dtype *out, const int ld)
+{
+    #pragma omp parallel for if(thread_safe)
+    for (int k=0; k < n_cols; ++k) 
+    {
+        for (int j=0; j < n_rows; ++j) 
+        {
+            out[j + k*ld] = this->getMatrixEntry(j + n_row_start, k + n_col_start);
+        }
+    }
+}
+
 Vec HODLR_Matrix::getRow(const int j, const int n_col_start, const int n_cols) 
 {
     Vec row(n_cols);
-    #pragma omp parallel for
-    for(int k = 0; k < n_cols; k++) 
-    {   
-        row(k) = this->getMatrixEntry(j,  k + n_col_start);
-    }
+    // A row is a block with one row; its entries are stored with stride 1:
+    this->getMatrixBlock(j, n_col_start, 1, n_cols, row.data(), 1);
     
     return row;
 }
@@ -15,12 +26,7 @@ Vec HODLR_Matrix::getRow(const int j, const int n_col_start, const int n_cols)
 Vec HODLR_Matrix::getCol(const int k, const int n_row_start, const int n_rows) 
 {
     Vec col(n_rows);
-    
-    #pragma omp parallel for
-    for (int j=0; j<n_rows; ++j) 
-    {
-        col(j) = this->getMatrixEntry(j + n_row_start, k);
-    }
+    this->getMatrixBlock(n_row_start, k, n_rows, 1, col.data(), n_rows);
     
     return col;
 }
@@ -30,79 +36,84 @@ Mat HODLR_Matrix::getMatrix(const int n_row_start, const int n_col_start,
                             const int n_rows, const int n_cols) 
 {
     Mat mat(n_rows, n_cols);
-    
-    #pragma omp parallel for
-    for (int j=0; j < n_rows; ++j) 
-    {
-        #pragma omp parallel for
-        for (int k=0; k < n_cols; ++k) 
-        {
-            mat(j,k) = this->getMatrixEntry(j + n_row_start, k + n_col_start);
-        }
-    }
+    this->getMatrixBlock(n_row_start, n_col_start, n_rows, n_cols, mat.data(), n_rows);
 
     return mat;
 }
 
-void HODLR_Matrix::maxAbsVector(const Vec& v, 
-                                const std::set<int>& allowed_indices,
+
+void HODLR_Matrix::maxAbsVector(const dtype* v, int n,
+                                const std::vector<char>& used,
                                 dtype& max, int& index
-                               ) 
+                               )
 {
-    std::set<int>::iterator it;
-    index = *allowed_indices.begin();
-    max   = v(index);
+    // index = -1 signals that all indices have been used:
+    index = -1;
+    max   = 0;
 
-    for(it = allowed_indices.begin(); it != allowed_indices.end(); it++) 
+    for(int i = 0; i < n; i++)
     {
-        if(fabs(v(*it))>fabs(max)) 
+        if(!used[i] && (index < 0 || fabs(v[i]) > fabs(max)))
         {
-            index   =   *it;
-            max     =   v(index);
+            index   =   i;
+            max     =   v[i];
         }
     }
 }
 
-void HODLR_Matrix::rookPiv(int n_row_start, int n_col_start, 
-                           int n_rows, int n_cols, double tolerance, 
+void HODLR_Matrix::rookPiv(int n_row_start, int n_col_start,
+                           int n_rows, int n_cols, double tolerance,
                            Mat& L, Mat& R, int& computed_rank
                           )
 {
-    // Indices which have been used:
-    std::vector<int> row_ind;      
-    std::vector<int> col_ind;
-
-    // Indices that are remaining:
-    std::set<int> remaining_row_ind;
-    std::set<int> remaining_col_ind;
-    
-    // Bases:
-    std::vector<Vec> u; 
-    std::vector<Vec> v;
+    const int max_rank = std::min(n_rows, n_cols);
 
-    for(int k = 0; k < n_rows; k++) 
-    {
-        remaining_row_ind.insert(k);
-    }
-    
-    for(int k = 0; k < n_cols; k++) 
-    {
-        remaining_col_ind.insert(k);
-    }
+    // Indices which have been used (in the order they were chosen):
+    std::vector<int> row_ind;
+    std::vector<int> col_ind;
+    row_ind.reserve(max_rank + 1);
+    col_ind.reserve(max_rank + 1);
+
+    // Scratch space to sort the used row indices:
+    std::vector<int> row_ind_sort;
+    row_ind_sort.reserve(max_rank + 1);
+
+    // Flags of the indices which have been used, and the number of
+    // indices that are remaining:
+    std::vector<char> used_row(n_rows, 0);
+    std::vector<char> used_col(n_cols, 0);
+    int remaining_rows = n_rows;
+    int remaining_cols = n_cols;
+
+    // Bases: the first computed_rank columns of the panels U and V hold
+    // the vectors u_i and v_i. The panels grow geometrically if the rank
+    // exceeds their capacity:
+    int capacity = std::min(max_rank, 16);
+    Mat U(n_rows, capacity);
+    Mat V(n_cols, capacity);
+
+    // Overlaps of the new basis vectors with the previous ones:
+    Vec u_dot(capacity), v_dot(capacity);
+
+    // Rows fetched at once when looking for a new pivot row. The rows are
+    // stored as the rows of the panel, i.e., with leading dimension batch:
+    const int batch = std::max(1, std::min(aca_batch, n_rows));
+    Mat rows(batch, n_cols);
 
     dtype max, gamma, unused_max;
 
     // Initialize the matrix norm and the the first row index
     dtype_base matrix_norm = 0;
     row_ind.push_back(0);
-    remaining_row_ind.erase(0);
+    used_row[0] = 1;
+    remaining_rows--;
 
     // Stores the pivot entry of the considered row / col:
     int pivot;
 
     // This would get updated:
     computed_rank = 0;
-    Vec row, col;
+    Vec row(n_cols), col(n_rows);
     // These quantities in finding the stopping criteria:
     dtype_base row_squared_norm, row_norm, col_squared_norm, col_norm;
 
@@ -111,34 +122,30 @@ void HODLR_Matrix::rookPiv(int n_row_start, int n_col_start,
     int count;
 
     // Repeat till the desired tolerance is obtained
-    do 
+    do
     {
         // Generation of the row
         // Row of the residuum and the pivot column
         // By calling row_ind.back(), we are getting the last pushed number
-        row = this->getRow(n_row_start + row_ind.back(), n_col_start, n_cols);
-        
-        for(int i = 0; i < computed_rank; i++) 
-        {
-            row = row - u[i](row_ind.back()) * v[i];
-        }
+        this->getMatrixBlock(n_row_start + row_ind.back(), n_col_start, 1, n_cols, row.data(), 1);
+        row.noalias() -= V.leftCols(computed_rank) * U.row(row_ind.back()).head(computed_rank).transpose();
 
-        this->maxAbsVector(row, remaining_col_ind, max, pivot);
+        this->maxAbsVector(row.data(), n_cols, used_col, max, pivot);
         count = 0;
 
-        // This randomization is needed if in the middle of the algorithm the 
-        // row happens to be exactly the linear combination of the previous rows 
+        // This randomization is needed if in the middle of the algorithm the
+        // row happens to be exactly the linear combination of the previous rows
         // upto some tolerance. i.e. prevents from ACA throwing false positives
-        
+
         // Alternating upon each call:
         bool eval_at_end = false;
         // Toggling randomness
         bool use_randomization = false;
-        while (fabs(max) < tolerance && 
-               count < max_tries   && 
-               remaining_col_ind.size() > 0 && 
-               remaining_row_ind.size() > 0
-              ) 
+        while (fabs(max) < tolerance &&
+               count < max_tries   &&
+               remaining_cols > 0 &&
+               remaining_rows > 0
+              )
         {
             row_ind.pop_back();
             int new_row_ind;
@@ -148,14 +155,18 @@ void HODLR_Matrix::rookPiv(int n_row_start, int n_col_start,
             {
                 if(eval_at_end)
                 {
-                    new_row_ind = *--remaining_row_ind.end();
+                    new_row_ind = n_rows - 1;
+                    while(used_row[new_row_ind])
+                        new_row_ind--;
                 }
 
                 else
                 {
-                    new_row_ind = *remaining_row_ind.begin();
+                    new_row_ind = 0;
+                    while(used_row[new_row_ind])
+                        new_row_ind++;
                 }
-    
+
                 eval_at_end = !eval_at_end;
             }
 
@@ -165,27 +176,26 @@ void HODLR_Matrix::rookPiv(int n_row_start, int n_col_start,
             {
                 if(use_randomization == true)
                 {
-                    std::set<int>::const_iterator it(remaining_row_ind.begin());
-                    std::advance(it, rand() % remaining_row_ind.size());
-                    new_row_ind = *it;
+                    int skip = rand() % remaining_rows;
+                    new_row_ind = 0;
+                    while(used_row[new_row_ind] || skip-- > 0)
+                        new_row_ind++;
                 }
 
                 else
                 {
-                    std::vector<int> row_ind_sort(row_ind);
+                    row_ind_sort.assign(row_ind.begin(), row_ind.end());
                     std::sort(row_ind_sort.begin(), row_ind_sort.end());
-                    std::vector<int> row_ind_diff(row_ind_sort.size() - 1);
 
                     int max = 0;
                     int idx = 0;
 
                     for(unsigned int i = 1; i < row_ind_sort.size(); i++)
                     {
-                        row_ind_diff[i-1] = row_ind_sort[i] - row_ind_sort[i-1];
-                        if(row_ind_diff[i-1] > max)
+                        if(row_ind_sort[i] - row_ind_sort[i-1] > max)
                         {
                             idx = i-1;
-                            max = row_ind_diff[i-1];
+                            max = row_ind_sort[i] - row_ind_sort[i-1];
                         }
                     }
 
@@ -195,142 +205,97 @@ void HODLR_Matrix::rookPiv(int n_row_start, int n_col_start,
                 use_randomization = !(use_randomization);
             }
 
-            row_ind.push_back(new_row_ind);
-            remaining_row_ind.erase(new_row_ind);
-            // Generation of the row
-            // Row of the residuum and the pivot column
-            row = this->getRow(n_row_start + new_row_ind, n_col_start, n_cols);
-            for(int i = 0; i < computed_rank; i++) 
-            {
-                row = row - u[i](row_ind.back()) * v[i];
-            }
+            // Generation of the rows new_row_ind, ..., new_row_ind+n-1 of the
+            // residuum with a single call of getMatrixBlock. The row with the
+            // largest pivot is used; rows that are (numerically) zero are
+            // discarded:
+            const int n = std::min(batch, n_rows - new_row_ind);
+            this->getMatrixBlock(n_row_start + new_row_ind, n_col_start, n, n_cols, rows.data(), batch);
+            rows.topRows(n).noalias() -= U.block(new_row_ind, 0, n, computed_rank) * V.leftCols(computed_rank).transpose();
 
-            this->maxAbsVector(row, remaining_col_ind, max, pivot);
-            count++;
-        }
-
-        // In case it failed to resolve in the previous step, 
-        // we break out of the dowhile loop:
-        if (count == max_tries || 
-            remaining_col_ind.size() == 0 || 
-            remaining_row_ind.size() == 0
-           )
-        {
-            break;
-        } 
-
-        // Now we will move onto doing this process for the column bases
-        // Resetting the count back to zero:
-        count = 0;
-
-        col_ind.push_back(pivot);
-        remaining_col_ind.erase(pivot);
-
-        // Normalizing constant
-        gamma = dtype_base(1.0) / max;
-
-        // Generation of the column
-        // Column of the residuum and the pivot row
-        col = this->getCol(n_col_start + col_ind.back(), n_row_start, n_rows);
-        
-        for(int i = 0; i < computed_rank; i++) 
-        {
-            col = col - v[i](col_ind.back()) * u[i];
-        }
-
-        this->maxAbsVector(col, remaining_row_ind, unused_max, pivot);
-
-        // Repeating the same randomization we carried out for the rows, now for the columns:
-        while (fabs(max)<tolerance && 
-               count < max_tries && 
-               remaining_col_ind.size() >0 && 
-               remaining_row_ind.size() >0
-              ) 
-        {
-            col_ind.pop_back();
-
-            int new_col_ind;
-
-            if(col_ind.size() < 3)
+            int best = -1;
+            for(int i = 0; i < n; i++)
             {
-                if(eval_at_end)
+                // new_row_ind itself is always considered (it may have been
+                // tried before), the remaining rows only if they are unused:
+                if(i > 0 && used_row[new_row_ind + i])
                 {
-                    new_col_ind = *remaining_col_ind.end();
+                    continue;
                 }
 
-                else
-                {
-                    new_col_ind = *remaining_col_ind.begin();
-                }
-    
-                eval_at_end = !eval_at_end;
-            }
+                row = rows.row(i).transpose();
+                this->maxAbsVector(row.data(), n_cols, used_col, unused_max, pivot);
 
-            else
-            {                
-                if(use_randomization == true)
+                if(best < 0 || fabs(unused_max) > fabs(max))
                 {
-                    std::set<int>::const_iterator it(remaining_col_ind.begin());
-                    std::advance(it, rand() % remaining_col_ind.size());
-                    new_col_ind = *it;
+                    best = i;
+                    max  = unused_max;
                 }
 
-                else
+                if(fabs(unused_max) < tolerance && !used_row[new_row_ind + i])
                 {
-                    std::vector<int> col_ind_sort(col_ind);
-                    std::sort(col_ind_sort.begin(), col_ind_sort.end());
-                    std::vector<int> col_ind_diff(col_ind_sort.size() - 1);
-
-                    int max = 0;
-                    int idx = 0;
-
-                    for(unsigned int i = 1; i < col_ind_sort.size(); i++)
-                    {
-                        col_ind_diff[i-1] = col_ind_sort[i] - col_ind_sort[i-1];
-                        if(col_ind_diff[i-1] > max)
-                        {
-                            idx = i-1;
-                            max = col_ind_diff[i-1];
-                        }
-                    }
-
-                    new_col_ind = col_ind_sort[idx] + max / 2;
+                    used_row[new_row_ind + i] = 1;
+                    remaining_rows--;
                 }
 
-                use_randomization = !(use_randomization);
+                count++;
             }
 
-            col_ind.push_back(new_col_ind);
-            remaining_col_ind.erase(new_col_ind);
-
-            // Generation of the column
-            // Column of the residuum and the pivot row:
-            col = this->getCol(n_col_start + new_col_ind, n_row_start, n_rows);
-            for(int i = 0; i < computed_rank; i++) 
+            if(!used_row[new_row_ind + best])
             {
-                col = col - v[i](col_ind.back()) * u[i];
+                used_row[new_row_ind + best] = 1;
+                remaining_rows--;
             }
 
-            this->maxAbsVector(col, remaining_row_ind, unused_max, pivot);
-            count++;
+            row_ind.push_back(new_row_ind + best);
+            row = rows.row(best).transpose();
+            this->maxAbsVector(row.data(), n_cols, used_col, max, pivot);
         }
 
-        // In case it failed to resolve in the previous step, 
+        // In case it failed to resolve in the previous step,
         // we break out of the dowhile loop:
-        if (count == max_tries || 
-            remaining_col_ind.size() == 0 || 
-            remaining_row_ind.size() == 0
+        if (fabs(max) < tolerance ||
+            remaining_cols == 0 ||
+            remaining_rows == 0
            )
         {
             break;
-        } 
+        }
+
+        // Now we will move onto doing this process for the column bases
+        col_ind.push_back(pivot);
+        used_col[pivot] = 1;
+        remaining_cols--;
+
+        // Normalizing constant
+        gamma = dtype_base(1.0) / max;
+
+        // Generation of the column
+        // Column of the residuum and the pivot row
+        // The entry of the residual column in the current row equals the row
+        // pivot, so the column is never zero and, in contrast to the rows, no
+        // retries are needed.
+        this->getMatrixBlock(n_row_start, n_col_start + col_ind.back(), n_rows, 1, col.data(), n_rows);
+        col.noalias() -= U.leftCols(computed_rank) * V.row(col_ind.back()).head(computed_rank).transpose();
+
+        this->maxAbsVector(col.data(), n_rows, used_row, unused_max, pivot);
 
         row_ind.push_back(pivot);
-        remaining_row_ind.erase(pivot);
+        used_row[pivot] = 1;
+        remaining_rows--;
 
         // New vectors
-        u.push_back(gamma * col);
-        v.push_back(row);
+        if(computed_rank == capacity)
+        {
+            capacity = std::min(2*capacity, max_rank);
+            U.conservativeResize(Eigen::NoChange, capacity);
+            V.conservativeResize(Eigen::NoChange, capacity);
+            u_dot.resize(capacity);
+            v_dot.resize(capacity);
+        }
+
+        U.col(computed_rank) = gamma * col;
+        V.col(computed_rank) = row;
 
         // New approximation of matrix norm
         row_squared_norm = row.squaredNorm();
@@ -342,48 +307,43 @@ void HODLR_Matrix::rookPiv(int n_row_start, int n_col_start,
         // Updating the matrix norm:
         matrix_norm += std::abs(gamma * gamma * row_squared_norm * col_squared_norm);
 
-        for(int j = 0; j < computed_rank; j++) 
-        {
-            matrix_norm += 2.0 * std::abs(u[j].dot(u.back())) 
-                               * std::abs(v[j].dot(v.back()));
-        }
-        
+        u_dot.head(computed_rank).noalias() = U.leftCols(computed_rank).transpose() * U.col(computed_rank);
+        v_dot.head(computed_rank).noalias() = V.leftCols(computed_rank).transpose() * V.col(computed_rank);
+        matrix_norm += 2.0 * u_dot.head(computed_rank).cwiseAbs().dot(v_dot.head(computed_rank).cwiseAbs());
+
         computed_rank++;
-    } 
-    while(computed_rank * (n_rows + n_cols) * row_norm * col_norm > 
-          fabs(max) * tolerance * matrix_norm && 
-          computed_rank < fmin(n_rows, n_cols)
+    }
+    while(computed_rank * (n_rows + n_cols) * row_norm * col_norm >
+          fabs(max) * tolerance * matrix_norm &&
+          computed_rank < max_rank
          );
 
     // If the computed_rank is >= to full-rank
     // then return the trivial full-rank decomposition
-    if (computed_rank >= fmin(n_rows, n_cols) - 1) 
+    if (computed_rank >= max_rank - 1)
     {
-        if (n_rows < n_cols) 
+        if (n_rows < n_cols)
         {
             L = Mat::Identity(n_rows, n_rows);
             R = getMatrix(n_row_start, n_col_start, n_rows, n_cols).transpose();
             computed_rank = n_rows;
         }
 
-        else 
+        else
         {
             L = getMatrix(n_row_start, n_col_start, n_rows, n_cols);
             R = Mat::Identity(n_cols, n_cols);
             computed_rank = n_cols;
         }
     }
-    
-    // This is when ACA has succeeded:
-    else 
+
+    // This is when ACA has succeeded; the panels are shrunk to the
+    // computed rank and handed over without copying:
+    else
     {
-        L = Mat(n_rows, computed_rank);
-        R = Mat(n_cols, computed_rank);
-        
-        for (int j = 0; j < computed_rank; j++) 
-        {
-            L.col(j) = u[j];
-            R.col(j) = v[j];
-        }
+        U.conservativeResize(Eigen::NoChange, computed_rank);
+        V.conservativeResize(Eigen::NoChange, computed_rank);
+        L.swap(U);
+        R.swap(V);
     }
 }
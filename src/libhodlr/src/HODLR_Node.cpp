@@ -25,18 +25,17 @@ void HODLR_Node::assembleLeafNode(HODLR_Matrix* A)
     K = A->getMatrix(n_start, n_start, n_size, n_size);
 }
 
-void HODLR_Node::matmatProductLeaf(Mat x, Mat& b) 
+void HODLR_Node::matmatProductLeaf(const Eigen::Ref<const Mat>& x, Mat& b) 
 {
-    b.block(n_start, 0, n_size, x.cols()) += K * x.block(n_start, 0, n_size, x.cols());
+    b.block(n_start, 0, n_size, x.cols()).noalias() += K * x.block(n_start, 0, n_size, x.cols());
 }
 
 void HODLR_Node::assembleNonLeafNode(HODLR_Matrix* A, bool is_sym) 
 {
     if(is_sym == true)
     {
+        // V[0] = U[0] and U[1] = V[1] are not stored:
         A->rookPiv(c_start[0], c_start[1], c_size[0], c_size[1], tolerance, U[0], V[1], rank[0]);
-        V[0]    = U[0];
-        U[1]    = V[1];
         rank[1] = rank[0];
     }
 
@@ -47,13 +46,33 @@ void HODLR_Node::assembleNonLeafNode(HODLR_Matrix* A, bool is_sym)
     }
 }
 
-void HODLR_Node::matmatProductNonLeaf(Mat x, Mat& b) 
+void HODLR_Node::matmatProductNonLeaf(const Eigen::Ref<const Mat>& x, Mat& b, bool is_sym) 
 {
-    b.block(c_start[0], 0, c_size[0], x.cols()) += 
+    const Mat& U1 = is_sym ? V[1] : U[1];
+    const Mat& V0 = is_sym ? U[0] : V[0];
+
+    b.block(c_start[0], 0, c_size[0], x.cols()).noalias() += 
     (U[0] * (V[1].transpose() * x.block(c_start[1], 0, c_size[1], x.cols())));
 
-    b.block(c_start[1], 0, c_size[1], x.cols()) += 
-    (U[1] * (V[0].transpose() * x.block(c_start[0], 0, c_size[0], x.cols())));
+    b.block(c_start[1], 0, c_size[1], x.cols()).noalias() += 
+    (U1 * (V0.transpose() * x.block(c_start[0], 0, c_size[0], x.cols())));
+}
+
+void HODLR_Node::releaseData()
+{
+    K.resize(0, 0);
+
+    for(int i = 0; i < 2; i++)
+    {
+        U[i].resize(0, 0);
+        V[i].resize(0, 0);
+        U_factor[i].resize(0, 0);
+        V_factor[i].resize(0, 0);
+        Q[i].resize(0, 0);
+    }
+
+    K_factor_LU  = Eigen::PartialPivLU<Mat>();
+    K_factor_LLT = Eigen::LLT<Mat>();
 }
 
 void HODLR_Node::printNodeDetails()
@@ -1,5 +1,9 @@
 #include "HODLR_Tree.hpp"
 
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
 // Contructor for the HODLR Tree class:
 HODLR_Tree::HODLR_Tree(int n_levels, double tolerance, HODLR_Matrix* A) 
 {
@@ -13,6 +17,18 @@ HODLR_Tree::HODLR_Tree(int n_levels, double tolerance, HODLR_Matrix* A)
     {
         nodes_in_level.push_back(2 * nodes_in_level.back());
     }
+
+    // The first level with at least as many nodes as threads:
+    #ifdef _OPENMP
+        const int n_threads = omp_get_max_threads();
+    #else
+        const int n_threads = 1;
+    #endif
+    task_level = 0;
+    while(task_level < n_levels && nodes_in_level[task_level] < n_threads)
+    {
+        task_level++;
+    }
     
     this->createTree();
 }
@@ -22,59 +38,51 @@ HODLR_Tree::~HODLR_Tree()
 {
     for(int j = 0; j <= n_levels; j++) 
     {
-        #pragma omp parallel for
         for(int k = 0; k < nodes_in_level[j]; k++) 
         {
-            delete tree[j][k];
+            tree[j][k]->~HODLR_Node();
         }
     }
-}
-
-// Creates the node at the root level:
-void HODLR_Tree::createRoot() 
-{
-    HODLR_Node* root = new HODLR_Node(0, 0, 0, 0, N, tolerance);
-    std::vector<HODLR_Node*> level;
-    level.push_back(root);
-    tree.push_back(level);
-}
 
-// Function that adds on children for the given level and node number:
-void HODLR_Tree::createChildren(int level_number, int node_number) 
-{
-    //  Adding left child:
-    HODLR_Node* left = new HODLR_Node(level_number + 1, 2 * node_number, 0, 
-                                      tree[level_number][node_number]->c_start[0], 
-                                      tree[level_number][node_number]->c_size[0], 
-                                      tolerance
-                                     );
-    tree[level_number + 1].push_back(left);
-
-    //  Adding right child
-    HODLR_Node* right = new HODLR_Node(level_number + 1, 2 * node_number + 1, 1, 
-                                       tree[level_number][node_number]->c_start[1], 
-                                       tree[level_number][node_number]->c_size[1], 
-                                       tolerance
-                                      );
-    tree[level_number + 1].push_back(right);
+    ::operator delete(nodes);
 }
 
 // Creates the tree structure:
 // Depending upon the parameters set by the user, this function
-// creates a tree having required number of nodes in the tree
+// creates a tree having required number of nodes in the tree.
+// The nodes are constructed in a single block of memory (the node
+// arena) which is allocated once for the whole tree:
 void HODLR_Tree::createTree() 
 {
-    this->createRoot();
-    
+    const int n_nodes = 2 * nodes_in_level[n_levels] - 1;
+    nodes = static_cast<HODLR_Node*>(::operator new(n_nodes * sizeof(HODLR_Node)));
+
+    // Creating the root:
+    HODLR_Node* root = new (&nodes[0]) HODLR_Node(0, 0, 0, 0, N, tolerance);
+    tree.push_back(std::vector<HODLR_Node*>(1, root));
+
     for(int j = 0; j < n_levels; j++) 
     {
         std::vector<HODLR_Node*> level;
-        tree.push_back(level);
-        
+        level.reserve(nodes_in_level[j + 1]);
+
+        // Adding the left and right child of every node of level j:
         for(int k = 0; k < nodes_in_level[j]; k++) 
         {
-            this->createChildren(j, k);
+            HODLR_Node* parent = tree[j][k];
+            for(int child = 0; child < 2; child++)
+            {
+                const int index = nodes_in_level[j + 1] - 1 + 2 * k + child;
+                level.push_back(new (&nodes[index]) HODLR_Node(j + 1, 2 * k + child, child,
+                                                             parent->c_start[child],
+                                                             parent->c_size[child],
+                                                             tolerance
+                                                            )
+                               );
+            }
         }
+
+        tree.push_back(level);
     }
 }
 
@@ -86,21 +94,19 @@ void HODLR_Tree::assembleTree(bool is_sym, bool is_pd)
 {
     this->is_sym = is_sym;
     this->is_pd  = is_pd;
-    // Assembly of nonleaf nodes:
-    for(int j = 0; j < n_levels; j++) 
-    {
-        #pragma omp parallel for
-        for(int k = 0; k < nodes_in_level[j]; k++) 
-        {
-            tree[j][k]->assembleNonLeafNode(A, is_sym);
-        }
-    }
 
-    // Assembly of leaf nodes:
-    #pragma omp parallel for
-    for (int k = 0; k < nodes_in_level[n_levels]; k++) 
+    // All nodes are independent of each other. They are assembled in the
+    // order of the arena, i.e., level by level starting with the root. The
+    // nodes are only assembled concurrently if the matrix is thread safe:
+    const int n_nodes = 2 * nodes_in_level[n_levels] - 1;
+
+    #pragma omp parallel for schedule(dynamic) if(A->thread_safe)
+    for(int i = 0; i < n_nodes; i++) 
     {
-        tree[n_levels][k]->assembleLeafNode(A);
+        if(nodes[i].level_number == n_levels)
+            nodes[i].assembleLeafNode(A);
+        else
+            nodes[i].assembleNonLeafNode(A, is_sym);
     }
 }
 
@@ -126,8 +132,30 @@ void HODLR_Tree::printTreeDetails()
     }
 }
 
+void HODLR_Tree::getRankStatistics(int level_number, int& rank_max, double& rank_mean, double& block_size)
+{
+    rank_max   = 0;
+    rank_mean  = 0;
+    block_size = 0;
+
+    const int n = nodes_in_level[level_number];
+    for(int k = 0; k < n; k++)
+    {
+        const HODLR_Node* node = tree[level_number][k];
+        for(int i = 0; i < 2; i++)
+        {
+            rank_max    = std::max(rank_max, node->rank[i]);
+            rank_mean  += node->rank[i];
+            block_size += node->c_size[i];
+        }
+    }
+
+    rank_mean  /= 2*n;
+    block_size /= 2*n;
+}
+
 // Performs a MatMat product with the given matrix X.
-Mat HODLR_Tree::matmatProduct(Mat x) 
+Mat HODLR_Tree::matmatProduct(const Eigen::Ref<const Mat>& x) 
 {
     // Initializing matrix b:
     Mat b = Mat::Zero(N, x.cols());
@@ -138,7 +166,7 @@ Mat HODLR_Tree::matmatProduct(Mat x)
         #pragma omp parallel for
         for (int k = 0; k < nodes_in_level[j]; k++) 
         {
-            tree[j][k]->matmatProductNonLeaf(x, b);
+            tree[j][k]->matmatProductNonLeaf(x, b, is_sym);
         }
     }
 
@@ -162,13 +190,97 @@ void HODLR_Tree::factorize()
         this->factorizeNonSPD();
 }
 
+// Factorizes node k of level j. The bases of the ancestors of the node are
+// updated, hence, all descendants of the node must have been factorized:
+void HODLR_Tree::factorizeNode(int j, int k, bool release)
+{
+    HODLR_Node* node = tree[j][k];
+
+    if(is_sym == true && is_pd == true)
+    {
+        if(j == n_levels)
+        {
+            this->factorizeLeafSPD(k);
+        }
+        else
+        {
+            this->qr(j, k);
+            this->factorizeNonLeafSPD(j, k);
+        }
+
+        if(release)
+            node->log_det = node->K.size() > 0 ? node->K_factor_LLT.matrixLLT().diagonal().array().abs().log().sum() : 0;
+    }
+    else
+    {
+        if(j == n_levels)
+            this->factorizeLeafNonSPD(k);
+        else
+            this->factorizeNonLeafNonSPD(j, k);
+
+        if(release)
+            node->log_det = node->K.size() > 0 ? node->K_factor_LU.matrixLU().diagonal().array().abs().log().sum() : 0;
+    }
+
+    if(release)
+        node->releaseData();
+}
+
+// Factorizes the subtree with root node k of level j. The two subtrees of the
+// children are independent, they touch disjoint rows of the bases of their
+// ancestors. Tasks are only created for the task_depth levels below
+// task_level; deeper subtrees are small and factorized by the same task:
+void HODLR_Tree::factorizeSubtree(int j, int k, bool release)
+{
+    if(j < n_levels && j < task_level + task_depth)
+    {
+        #pragma omp task
+        this->factorizeSubtree(j + 1, 2 * k,     release);
+        #pragma omp task
+        this->factorizeSubtree(j + 1, 2 * k + 1, release);
+        #pragma omp taskwait
+    }
+    else if(j < n_levels)
+    {
+        this->factorizeSubtree(j + 1, 2 * k,     release);
+        this->factorizeSubtree(j + 1, 2 * k + 1, release);
+    }
+
+    this->factorizeNode(j, k, release);
+}
+
+void HODLR_Tree::factorizeTree(bool release)
+{
+    // Subtrees of level task_level:
+    #pragma omp parallel
+    #pragma omp single
+    for(int k = 0; k < nodes_in_level[task_level]; k++) 
+    {
+        #pragma omp task
+        this->factorizeSubtree(task_level, k, release);
+    }
+
+    // The levels above have less nodes than threads but contain the largest
+    // dense blocks. They are factorized outside of a parallel region, so that
+    // Eigen may use all threads:
+    for(int j = task_level - 1; j >= 0; j--) 
+    {
+        for(int k = 0; k < nodes_in_level[j]; k++) 
+        {
+            this->factorizeNode(j, k, release);
+        }
+    }
+}
+
 // Returns x, by solving Ax = b, where A is the matrix represented by the HODLR structure
 Mat HODLR_Tree::solve(Mat b)
 {
     if(is_sym == true && is_pd == true)
-        return this->solveSPD(b);
+        this->solveSPD(b);
     else
-        return this->solveNonSPD(b);
+        this->solveNonSPD(b);
+
+    return b;
 }
 
 // Returns the log determinant of the matrix represented by the HODLR structure
@@ -180,6 +292,16 @@ dtype HODLR_Tree::logDeterminant()
         return this->logDeterminantNonSPD();
 }
 
+// Returns the log determinant of the matrix represented by the HODLR structure
+// without keeping the factorization:
+dtype HODLR_Tree::factorizeLogDeterminant()
+{
+    if(is_sym == true && is_pd == true)
+        return this->factorizeLogDeterminantSPD();
+    else
+        return this->factorizeLogDeterminantNonSPD();
+}
+
 // disable this method
 #if 0
 // Creates a plot of the HODLR matrix represented.
@@ -20,7 +20,6 @@ void HODLR_Tree::factorizeLeafNonSPD(int k)
         r       = tree[l][parent]->rank[child];
 
         // We factor out the leaf level by applying inv(K) to the appropriate subblock:
-        tree[l][parent]->U_factor[child].block(t_start, 0, size, r) =   
         this->solveLeafNonSPD(k, tree[l][parent]->U_factor[child].block(t_start, 0, size, r));
     }
 }
@@ -44,10 +43,10 @@ void HODLR_Tree::factorizeNonLeafNonSPD(int j, int k)
         //     |           |           |
         //     -------------------------
 
-        tree[j][k]->K.block(0, r0, r0, r1)  =   
+        tree[j][k]->K.block(0, r0, r0, r1).noalias() =   
         tree[j][k]->V_factor[1].transpose() * tree[j][k]->U_factor[1];
 
-        tree[j][k]->K.block(r0, 0, r1, r0)  =   
+        tree[j][k]->K.block(r0, 0, r1, r0).noalias() =   
         tree[j][k]->V_factor[0].transpose() * tree[j][k]->U_factor[0];
 
         // Computing LU factorization of K:
@@ -68,7 +67,6 @@ void HODLR_Tree::factorizeNonLeafNonSPD(int j, int k)
             // This updates U's by using the Sherman Morrisson Woodbury formula:
             if(tree[l][parent]->U_factor[child].cols() > 0)
             {
-                tree[l][parent]->U_factor[child].block(t_start, 0, size, r) =   
                 this->solveNonLeafNonSPD(j, k, tree[l][parent]->U_factor[child].block(t_start, 0, size, r));
             }
         }
@@ -86,40 +84,31 @@ void HODLR_Tree::factorizeNonSPD()
             int &r0 = tree[j][k]->rank[0];
             int &r1 = tree[j][k]->rank[1];
 
+            // For symmetric matrices V[0] = U[0] and U[1] = V[1]:
             tree[j][k]->U_factor[0] = tree[j][k]->U[0];
-            tree[j][k]->U_factor[1] = tree[j][k]->U[1];
-            tree[j][k]->V_factor[0] = tree[j][k]->V[0];
+            tree[j][k]->U_factor[1] = is_sym ? tree[j][k]->V[1] : tree[j][k]->U[1];
+            tree[j][k]->V_factor[0] = is_sym ? tree[j][k]->U[0] : tree[j][k]->V[0];
             tree[j][k]->V_factor[1] = tree[j][k]->V[1];
             tree[j][k]->K           = Mat::Identity(r0 + r1, r0 + r1);
         }
     }
 
-    // Factorizing the leaf levels:
-    #pragma omp parallel for
-    for(int k = 0; k < nodes_in_level[n_levels]; k++) 
-    {
-        this->factorizeLeafNonSPD(k);
-    }
-
-    // Factorizing the nonleaf levels:
-    for(int j = n_levels - 1; j >= 0; j--) 
-    {
-        #pragma omp parallel for
-        for(int k = 0; k < nodes_in_level[j]; k++) 
-        {
-            this->factorizeNonLeafNonSPD(j, k);
-        }
-    }
+    // Factorizing the leaf and nonleaf levels:
+    this->factorizeTree(false);
 }
 
-// Solve at the leaf is just directly performed by solving Kx = b:
-Mat HODLR_Tree::solveLeafNonSPD(int k, Mat b) 
+// Solve at the leaf is just directly performed by solving Kx = b.
+// With K = P^T * L * U, b is overwritten by inv(U) * inv(L) * P * b:
+void HODLR_Tree::solveLeafNonSPD(int k, Eigen::Ref<Mat> b) 
 {
-    Mat x = tree[n_levels][k]->K_factor_LU.solve(b);
-    return x;
+    const Eigen::PartialPivLU<Mat>& lu = tree[n_levels][k]->K_factor_LU;
+
+    b = lu.permutationP() * b;
+    lu.matrixLU().triangularView<Eigen::UnitLower>().solveInPlace(b);
+    lu.matrixLU().triangularView<Eigen::Upper>().solveInPlace(b);
 }
 
-Mat HODLR_Tree::solveNonLeafNonSPD(int j, int k, Mat b) 
+void HODLR_Tree::solveNonLeafNonSPD(int j, int k, Eigen::Ref<Mat> b) 
 {
     int r0 = tree[j][k]->rank[0];
     int r1 = tree[j][k]->rank[1];
@@ -138,26 +127,19 @@ Mat HODLR_Tree::solveNonLeafNonSPD(int j, int k, Mat b)
     //        -------------
 
     Mat temp(r0 + r1, r);
-    temp << tree[j][k]->V_factor[1].transpose() * b.block(n0, 0, n1, r),
-            tree[j][k]->V_factor[0].transpose() * b.block(0,  0, n0, r);
+    temp.topRows(r0).noalias()    = tree[j][k]->V_factor[1].transpose() * b.bottomRows(n1);
+    temp.bottomRows(r1).noalias() = tree[j][k]->V_factor[0].transpose() * b.topRows(n0);
     temp = tree[j][k]->K_factor_LU.solve(temp);
     
-    Mat y(n0 + n1, r);
-    
-    // y = U * (1 + VT * U)^{-1} * VT * b
-    y << tree[j][k]->U_factor[0] * temp.block(0,  0, r0, r), 
-         tree[j][k]->U_factor[1] * temp.block(r0, 0, r1, r);
-    
     // This is using Sherman Morrison Woodbury Formula:
     // x = b - U * (1 + VT * U)^{-1} * VT * b
-    return(b - y);
+    b.topRows(n0).noalias()    -= tree[j][k]->U_factor[0] * temp.topRows(r0);
+    b.bottomRows(n1).noalias() -= tree[j][k]->U_factor[1] * temp.bottomRows(r1);
 }
 
-Mat HODLR_Tree::solveNonSPD(Mat b) 
+void HODLR_Tree::solveNonSPD(Eigen::Ref<Mat> b) 
 {   
     int start, size;
-    Mat x = Mat::Zero(b.rows(),b.cols());
-    
     int r = b.cols();
 
     // Solving over the leaf nodes:
@@ -166,11 +148,9 @@ Mat HODLR_Tree::solveNonSPD(Mat b)
         start = tree[n_levels][k]->n_start;
         size  = tree[n_levels][k]->n_size;
 
-        x.block(start, 0, size, r) = this->solveLeafNonSPD(k, b.block(start, 0, size, r));
+        this->solveLeafNonSPD(k, b.block(start, 0, size, r));
     }
 
-    b = x;
-    
     // Solving over nonleaf levels:
     for(int j = n_levels - 1; j >= 0; j--) 
     {
@@ -179,13 +159,9 @@ Mat HODLR_Tree::solveNonSPD(Mat b)
             start = tree[j][k]->n_start;
             size  = tree[j][k]->n_size;
             
-            x.block(start, 0, size, r) = this->solveNonLeafNonSPD(j, k, b.block(start, 0, size, r));
+            this->solveNonLeafNonSPD(j, k, b.block(start, 0, size, r));
         }
-
-        b = x;
     }
-
-    return x;
 }
 
 dtype HODLR_Tree::logDeterminantNonSPD()
@@ -207,3 +183,51 @@ dtype HODLR_Tree::logDeterminantNonSPD()
 
     return(log_det);
 }
+
+// Computes the log determinant while factorizing the matrix. The factors of
+// a node are only needed to update the bases of its ancestors, so they are
+// released immediately after the node has been factorized:
+dtype HODLR_Tree::factorizeLogDeterminantNonSPD()
+{
+    dtype log_det = 0.0;
+
+    // Initializing for the non-leaf levels; the bases are not needed
+    // anymore and are moved instead of copied:
+    for(int j = 0; j < n_levels; j++) 
+    {
+        #pragma omp parallel for
+        for(int k = 0; k < nodes_in_level[j]; k++) 
+        {
+            HODLR_Node* node = tree[j][k];
+
+            // For symmetric matrices V[0] = U[0] and U[1] = V[1]:
+            if(is_sym)
+            {
+                node->V_factor[0] = node->U[0];
+                node->U_factor[1] = node->V[1];
+            }
+            else
+            {
+                node->V_factor[0] = std::move(node->V[0]);
+                node->U_factor[1] = std::move(node->U[1]);
+            }
+            node->U_factor[0] = std::move(node->U[0]);
+            node->V_factor[1] = std::move(node->V[1]);
+            node->K           = Mat::Identity(node->rank[0] + node->rank[1], node->rank[0] + node->rank[1]);
+        }
+    }
+
+    // Factorizing the leaf and nonleaf levels; every node stores its
+    // contribution to the log determinant before its data is released:
+    this->factorizeTree(true);
+
+    for(int j = n_levels; j >= 0; j--) 
+    {
+        for(int k = 0; k < nodes_in_level[j]; k++) 
+        {
+            log_det += tree[j][k]->log_det;
+        }
+    }
+
+    return(log_det);
+}
@@ -20,7 +20,6 @@ void HODLR_Tree::factorizeLeafSPD(int k)
         r       = tree[l][parent]->rank[child]; // NOTE: Here the rank for both children is the same
 
         // We factor out the leaf level by applying inv(L) to the appropriate subblock:
-        tree[l][parent]->Q[child].block(t_start, 0, size, r) =   
         this->solveLeafSymmetricFactor(k, tree[l][parent]->Q[child].block(t_start, 0, size, r));
     }
 }
@@ -65,16 +64,6 @@ void HODLR_Tree::qr(int j, int k)
     tree[j][k]->K *= qr.matrixQR().block(0, 0, min1, min1).triangularView<Eigen::Upper>().transpose();
 }
 
-// Obtains the QR decomposition of all nodes at this level:
-void HODLR_Tree::qrForLevel(int level)
-{
-    #pragma omp parallel for
-    for(int k = 0; k < nodes_in_level[level]; k++)
-    {
-        qr(level, k);
-    }
-}
-
 void HODLR_Tree::factorizeNonLeafSPD(int j, int k) 
 {
     int r0 = tree[j][k]->rank[0];
@@ -101,7 +90,6 @@ void HODLR_Tree::factorizeNonLeafSPD(int j, int k)
 
         if(tree[l][parent]->Q[child].cols() > 0)
         {
-            tree[l][parent]->Q[child].block(t_start, 0, size, r) =   
             this->solveNonLeafSymmetricFactor(j, k, tree[l][parent]->Q[child].block(t_start, 0, size, r));
         }
     }
@@ -132,82 +120,61 @@ void HODLR_Tree::factorizeSPD()
         }
     }
 
-    // Factorizing the leaf levels:
-    #pragma omp parallel for
-    for(int k = 0; k < nodes_in_level[n_levels]; k++) 
-    {
-        this->factorizeLeafSPD(k);
-    }
-
-    // Factorizing the nonleaf levels:
-    for(int j = n_levels - 1; j >= 0; j--) 
-    {
-        qrForLevel(j);
-        #pragma omp parallel for
-        for(int k = 0; k < nodes_in_level[j]; k++) 
-        {
-            this->factorizeNonLeafSPD(j, k);
-        }
-    }
+    // Factorizing the leaf and nonleaf levels:
+    this->factorizeTree(false);
 }
 
-// Returns inv(L) * b 
-Mat HODLR_Tree::solveLeafSymmetricFactor(int k, Mat b) 
+// b = inv(L) * b 
+void HODLR_Tree::solveLeafSymmetricFactor(int k, Eigen::Ref<Mat> b) 
 {
-    Mat x = tree[n_levels][k]->K_factor_LLT.matrixL().solve(b);
-    return x;
+    tree[n_levels][k]->K_factor_LLT.matrixL().solveInPlace(b);
 }
 
-// Returns inv(LT) * b 
-Mat HODLR_Tree::solveLeafSymmetricFactorTranspose(int k, Mat b) 
+// b = inv(LT) * b 
+void HODLR_Tree::solveLeafSymmetricFactorTranspose(int k, Eigen::Ref<Mat> b) 
 {
-    Mat x = tree[n_levels][k]->K_factor_LLT.matrixL().transpose().solve(b);
-    return x;
+    tree[n_levels][k]->K_factor_LLT.matrixU().solveInPlace(b);
 }
 
-Mat HODLR_Tree::solveNonLeafSymmetricFactor(int j, int k, Mat b) 
+void HODLR_Tree::solveNonLeafSymmetricFactor(int j, int k, Eigen::Ref<Mat> b) 
 {
-    int n0 = tree[j][k]->U[0].rows();
-    int n1 = tree[j][k]->V[1].rows();
-    int r  = b.cols();
+    int n0 = tree[j][k]->c_size[0];
+    int n1 = tree[j][k]->c_size[1];
 
     // tmp = Q1^T * b
-    Mat tmp = tree[j][k]->Q[1].transpose() * b.block(n0, 0, n1, r);
+    Mat tmp = tree[j][k]->Q[1].transpose() * b.bottomRows(n1);
     // What we are trying to solve is:
     // (I + Q1 * K^T * Q0^T) * x = b
     // by Sherman Morrisson Woodbury Formula:
     // x = b - Q1 * inv(inv(K^T) + Q0^T * Q1) * Q1^T
-    b.block(n0, 0, n1, r) -=   tree[j][k]->Q[1]
-                             * (  tree[j][k]->K_factor_LLT.matrixL().solve((tree[j][k]->K.transpose()
-                                *(tree[j][k]->Q[0].transpose() * b.block(0, 0, n0, r))) - tmp) + tmp
-                               );
-    return(b);
+    Mat w = tree[j][k]->K.transpose() * (tree[j][k]->Q[0].transpose() * b.topRows(n0)) - tmp;
+    tree[j][k]->K_factor_LLT.matrixL().solveInPlace(w);
+    w += tmp;
+
+    b.bottomRows(n1).noalias() -= tree[j][k]->Q[1] * w;
 }
 
-Mat HODLR_Tree::solveNonLeafSymmetricFactorTranspose(int j, int k, Mat b)
+void HODLR_Tree::solveNonLeafSymmetricFactorTranspose(int j, int k, Eigen::Ref<Mat> b)
 {
-    int n0 = tree[j][k]->U[0].rows();
-    int n1 = tree[j][k]->V[1].rows();
-    int r  = b.cols();
+    int n0 = tree[j][k]->c_size[0];
+    int n1 = tree[j][k]->c_size[1];
 
     // xtmp = Q1T * b
     // ytmp = inv(LT) * Q1T * b
-    Mat xtmp = tree[j][k]->Q[1].transpose() * b.block(n0, 0, n1, r);
-    Mat ytmp = tree[j][k]->K_factor_LLT.matrixL().transpose().solve(xtmp);
+    Mat xtmp = tree[j][k]->Q[1].transpose() * b.bottomRows(n1);
+    Mat ytmp = xtmp;
+    tree[j][k]->K_factor_LLT.matrixU().solveInPlace(ytmp);
     
     // b = b - Q0 * R * RT * inv(L)
     // b = b - Q1 * (ytmp - ytmp)
-    b.block(0 , 0, n0, r) -= tree[j][k]->Q[0] * (tree[j][k]->K * ytmp);
-    b.block(n0, 0, n1, r) -= tree[j][k]->Q[1] * (xtmp - ytmp);
-    
-    return(b);
+    b.topRows(n0).noalias()    -= tree[j][k]->Q[0] * (tree[j][k]->K * ytmp);
+    xtmp -= ytmp;
+    b.bottomRows(n1).noalias() -= tree[j][k]->Q[1] * xtmp;
 }
 
-Mat HODLR_Tree::solveSymmetricFactor(Mat b)
+void HODLR_Tree::solveSymmetricFactor(Eigen::Ref<Mat> b)
 {
     int start, size;
-    Mat x = Mat::Zero(b.rows(),b.cols());
-    
     int r = b.cols();
 
     // Factoring out the leaf nodes:
@@ -216,12 +183,9 @@ Mat HODLR_Tree::solveSymmetricFactor(Mat b)
         start = tree[n_levels][k]->n_start;
         size  = tree[n_levels][k]->n_size;
 
-        x.block(start, 0, size, r) = 
         this->solveLeafSymmetricFactor(k, b.block(start, 0, size, r));
     }
 
-    b = x;
-    
     // Factoring out over nonleaf levels:
     for(int j = n_levels - 1; j >= 0; j--) 
     {
@@ -230,21 +194,14 @@ Mat HODLR_Tree::solveSymmetricFactor(Mat b)
             start = tree[j][k]->n_start;
             size  = tree[j][k]->n_size;
             
-            x.block(start, 0, size, r) = 
             this->solveNonLeafSymmetricFactor(j, k, b.block(start, 0, size, r));
         }
-
-        b = x;
     }
-
-    return x;
 } 
 
-Mat HODLR_Tree::solveSymmetricFactorTranspose(Mat b) 
+void HODLR_Tree::solveSymmetricFactorTranspose(Eigen::Ref<Mat> b) 
 {
     int start, size;
-    Mat x = Mat::Zero(b.rows(),b.cols());
-    
     int r = b.cols();
 
     // Factoring out over nonleaf levels:
@@ -255,11 +212,8 @@ Mat HODLR_Tree::solveSymmetricFactorTranspose(Mat b)
             start = tree[j][k]->n_start;
             size  = tree[j][k]->n_size;
             
-            x.block(start, 0, size, r) = 
             this->solveNonLeafSymmetricFactorTranspose(j, k, b.block(start, 0, size, r));
         }
-
-        b = x;
     }
 
     // Factoring out the leaf nodes:
@@ -268,54 +222,47 @@ Mat HODLR_Tree::solveSymmetricFactorTranspose(Mat b)
         start = tree[n_levels][k]->n_start;
         size  = tree[n_levels][k]->n_size;
 
-        x.block(start, 0, size, r) = 
         this->solveLeafSymmetricFactorTranspose(k, b.block(start, 0, size, r));
     }
-
-    return x;
 }
 
-Mat HODLR_Tree::solveSPD(Mat b) 
+void HODLR_Tree::solveSPD(Eigen::Ref<Mat> b) 
 {   
-    return(solveSymmetricFactorTranspose(solveSymmetricFactor(b)));
+    this->solveSymmetricFactor(b);
+    this->solveSymmetricFactorTranspose(b);
 }
 
-Mat HODLR_Tree::SymmetricFactorNonLeafProduct(int j, int k, Mat b) 
+void HODLR_Tree::SymmetricFactorNonLeafProduct(int j, int k, Eigen::Ref<Mat> b) 
 {
-    int n0                        = tree[j][k]->U[0].rows();
-    int n1                        = tree[j][k]->V[1].rows();
-    Mat tmp                       = tree[j][k]->Q[1].transpose() * b.block(n0, 0, n1, b.cols());
-    b.block(n0, 0, n1, b.cols()) += tree[j][k]->Q[1]*(  (  tree[j][k]->K.transpose() 
-                                                         * tree[j][k]->Q[0].transpose() 
-                                                         * b.block(0, 0, n0, b.cols())
-                                                        ) 
-                                                      + (  (Mat)tree[j][k]->K_factor_LLT.matrixL() 
-                                                         - Mat::Identity(tree[j][k]->rank[0], tree[j][k]->rank[1])
-                                                        ) * tmp
-                                                     );
-
-    return(b);
+    int n0  = tree[j][k]->c_size[0];
+    int n1  = tree[j][k]->c_size[1];
+    Mat tmp = tree[j][k]->Q[1].transpose() * b.bottomRows(n1);
+
+    // w = K^T * Q0^T * b0 + (L - I) * tmp
+    Mat w   = tree[j][k]->K.transpose() * (tree[j][k]->Q[0].transpose() * b.topRows(n0));
+    w.noalias() += tree[j][k]->K_factor_LLT.matrixL() * tmp;
+    w -= tmp;
+
+    b.bottomRows(n1).noalias() += tree[j][k]->Q[1] * w;
 }
 
-Mat HODLR_Tree::SymmetricFactorTransposeNonLeafProduct(int j, int k, Mat b)
+void HODLR_Tree::SymmetricFactorTransposeNonLeafProduct(int j, int k, Eigen::Ref<Mat> b)
 {
-    int n0                        = tree[j][k]->U[0].rows();
-    int n1                        = tree[j][k]->V[1].rows();
-    Mat tmp                       = tree[j][k]->Q[1].transpose() * b.block(n0, 0, n1, b.cols());
-    b.block(0,  0, n0, b.cols()) += tree[j][k]->Q[0] * tree[j][k]->K * tmp;
-    b.block(n0, 0, n1, b.cols()) += tree[j][k]->Q[1] * ((  (Mat)tree[j][k]->K_factor_LLT.matrixL().transpose() 
-                                                          - Mat::Identity(tree[j][k]->rank[0], tree[j][k]->rank[1])
-                                                        ) * tmp
-                                                       );
-
-    return(b);
+    int n0  = tree[j][k]->c_size[0];
+    int n1  = tree[j][k]->c_size[1];
+    Mat tmp = tree[j][k]->Q[1].transpose() * b.bottomRows(n1);
+
+    // w = (L^T - I) * tmp
+    Mat w   = tree[j][k]->K_factor_LLT.matrixU() * tmp;
+    w -= tmp;
+
+    b.topRows(n0).noalias()    += tree[j][k]->Q[0] * (tree[j][k]->K * tmp);
+    b.bottomRows(n1).noalias() += tree[j][k]->Q[1] * w;
 }
 
 Mat HODLR_Tree::symmetricFactorProduct(Mat b)
 {
     int start, size;
-    Mat x = Mat::Zero(b.rows(),b.cols());
-    
     int r = b.cols();
 
     for(int j = 0; j < n_levels; j++)
@@ -325,11 +272,8 @@ Mat HODLR_Tree::symmetricFactorProduct(Mat b)
             start = tree[j][k]->n_start;
             size  = tree[j][k]->n_size;
             
-            x.block(start, 0, size, r) = 
             this->SymmetricFactorNonLeafProduct(j, k, b.block(start, 0, size, r));
         }
-
-        b = x;
     } 
     
     for(int k = 0; k < nodes_in_level[n_levels]; k++) 
@@ -337,18 +281,16 @@ Mat HODLR_Tree::symmetricFactorProduct(Mat b)
         start = tree[n_levels][k]->n_start;
         size  = tree[n_levels][k]->n_size;
 
-        x.block(start, 0, size, r) = 
+        b.block(start, 0, size, r) = 
         tree[n_levels][k]->K_factor_LLT.matrixL() * b.block(start, 0, size, r);
     }
 
-    return x;
+    return b;
 }
 
 Mat HODLR_Tree::symmetricFactorTransposeProduct(Mat b)
 {
     int start, size;
-    Mat x = Mat::Zero(b.rows(),b.cols());
-    
     int r = b.cols();
 
     for(int k = 0; k < nodes_in_level[n_levels]; k++) 
@@ -356,12 +298,10 @@ Mat HODLR_Tree::symmetricFactorTransposeProduct(Mat b)
         start = tree[n_levels][k]->n_start;
         size  = tree[n_levels][k]->n_size;
 
-        x.block(start, 0, size, r) = 
-        tree[n_levels][k]->K_factor_LLT.matrixL().transpose() * b.block(start, 0, size, r);
+        b.block(start, 0, size, r) = 
+        tree[n_levels][k]->K_factor_LLT.matrixU() * b.block(start, 0, size, r);
     }
 
-    b = x;
-    
     // Factoring out over nonleaf levels:
     for(int j = n_levels - 1; j >= 0; j--) 
     {
@@ -370,14 +310,11 @@ Mat HODLR_Tree::symmetricFactorTransposeProduct(Mat b)
             start = tree[j][k]->n_start;
             size  = tree[j][k]->n_size;
             
-            x.block(start, 0, size, r) = 
             this->SymmetricFactorTransposeNonLeafProduct(j, k, b.block(start, 0, size, r));
         }
-
-        b = x;
     }
 
-    return x;
+    return b;
 }
 
 Mat HODLR_Tree::getSymmetricFactor()
@@ -452,3 +389,38 @@ dtype HODLR_Tree::logDeterminantSPD()
     log_det *= 2;
     return(log_det);
 }
+
+// Computes the log determinant while factorizing the matrix. The factors of
+// a node are only needed to update the bases of its ancestors, so they are
+// released immediately after the node has been factorized:
+dtype HODLR_Tree::factorizeLogDeterminantSPD()
+{
+    dtype log_det = 0.0;
+
+    // Initializing for the non-leaf levels; the bases are not needed
+    // anymore and are moved instead of copied:
+    for(int j = 0; j < n_levels; j++) 
+    {
+        #pragma omp parallel for
+        for(int k = 0; k < nodes_in_level[j]; k++) 
+        {
+            tree[j][k]->Q[0] = std::move(tree[j][k]->U[0]);
+            tree[j][k]->Q[1] = std::move(tree[j][k]->V[1]);
+        }
+    }
+
+    // Factorizing the leaf and nonleaf levels; every node stores its
+    // contribution to the log determinant before its data is released:
+    this->factorizeTree(true);
+
+    for(int j = n_levels; j >= 0; j--) 
+    {
+        for(int k = 0; k < nodes_in_level[j]; k++) 
+        {
+            log_det += tree[j][k]->log_det;
+        }
+    }
+
+    log_det *= 2;
+    return(log_det);
+}
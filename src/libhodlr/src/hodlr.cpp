@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <math.h>
+#include <chrono>
 
 #include "HODLR_Tree.hpp"
 #include "HODLR_Matrix.hpp"
@@ -30,6 +31,48 @@ public:
     };
 };
 
+class KernelBlock : public HODLR_Matrix
+{
+private:
+    void *args;
+    double *diag;
+    void (*get_kernel_block)(int, int, int, int, double *, int, void *);
+
+public:
+    KernelBlock(unsigned N, void (kernel_block)(int,int,int,int,double *,int,void *), double *diag, void *args) : HODLR_Matrix(N)
+    {
+        this->args = args;
+        this->diag = diag;
+        this->get_kernel_block = kernel_block;
+
+        /* rows are cheaper when computed in blocks, so fetch several
+         * candidate rows at once when rookPiv has to search a new pivot */
+        setACABatch(8);
+    };
+
+    double getMatrixEntry(int m, int n)
+    {
+        double elem;
+        getMatrixBlock(m, n, 1, 1, &elem, 1);
+        return elem;
+    };
+
+    void getMatrixBlock(int j, int k, int n_rows, int n_cols, double *out, int ld)
+    {
+        get_kernel_block(j, k, n_rows, n_cols, out, ld, args);
+
+        /* Id-M */
+        for(int c = 0; c < n_cols; c++)
+            for(int r = 0; r < n_rows; r++)
+            {
+                if(j+r == k+c)
+                    out[r+c*ld] = 1-diag[j+r];
+                else
+                    out[r+c*ld] = -out[r+c*ld];
+            }
+    };
+};
+
 
 double hodlr_logdet_diagonal(int dim, double (*callback)(int,int,void *), void *args, double *diagonal, unsigned int nLeaf, double tolerance, int sym_spd)
 {
@@ -46,8 +89,59 @@ double hodlr_logdet_diagonal(int dim, double (*callback)(int,int,void *), void *
     int sym = sym_spd > 0 ? 1 : 0; /* matrix is symmetric */
     int spd = sym_spd > 1 ? 1 : 0; /* matrix is symmetric positive definite */
     T->assembleTree(sym, spd);
-    T->factorize();
-    double logdet = T->logDeterminant();
+    double logdet = T->factorizeLogDeterminant();
+
+    delete T;
+
+    return logdet;
+}
+
+/** Compute log det(Id-M) using a block kernel
+ *
+ * See \ref hodlr_logdet_diagonal_block.
+ */
+double hodlr_logdet_diagonal_block(int dim, void (*callback_block)(int,int,int,int,double *,int,void *), void *args, double *diagonal, unsigned int nLeaf, double tolerance, int sym_spd)
+{
+    return hodlr_logdet_diagonal_block_stats(dim, callback_block, args, diagonal, nLeaf, tolerance, sym_spd, NULL);
+}
+
+/** Compute log det(Id-M) using a block kernel and record statistics
+ *
+ * See \ref hodlr_logdet_diagonal_block_stats.
+ */
+double hodlr_logdet_diagonal_block_stats(int dim, void (*callback_block)(int,int,int,int,double *,int,void *), void *args, double *diagonal, unsigned int nLeaf, double tolerance, int sym_spd, hodlr_stats_t *stats)
+{
+    typedef std::chrono::steady_clock clock;
+
+    const int n_levels = fmax(1,log2(((double)dim)/nLeaf));
+
+    KernelBlock K = KernelBlock(dim, callback_block, diagonal, args);
+
+    HODLR_Tree *T = new HODLR_Tree(n_levels, tolerance, &K);
+
+    int sym = sym_spd > 0 ? 1 : 0; /* matrix is symmetric */
+    int spd = sym_spd > 1 ? 1 : 0; /* matrix is symmetric positive definite */
+
+    clock::time_point t0 = clock::now();
+    T->assembleTree(sym, spd);
+    clock::time_point t1 = clock::now();
+
+    if(stats != NULL)
+    {
+        stats->n_levels = n_levels;
+        stats->nLeaf = nLeaf;
+        for(int j = 0; j < n_levels && j < HODLR_STATS_LEVELS; j++)
+            T->getRankStatistics(j, stats->rank_max[j], stats->rank_mean[j], stats->size[j]);
+    }
+
+    double logdet = T->factorizeLogDeterminant();
+    clock::time_point t2 = clock::now();
+
+    if(stats != NULL)
+    {
+        stats->t_assemble  = std::chrono::duration<double>(t1-t0).count();
+        stats->t_factorize = std::chrono::duration<double>(t2-t1).count();
+    }
 
     delete T;
 
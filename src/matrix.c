@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
@@ -20,10 +21,226 @@
 /* prototypes for LAPACK functions */
 double ddot_(int *n, double *dx, int *incx, double *dy, int *incy);
 int dgetrf_(int *m, int *n, double *a, int *lda, int *ipiv, int *info);
+int dgetrs_(char *trans, int *n, int *nrhs, double *a, int *lda, int *ipiv, double *b, int *ldb, int *info);
 int dpotrf_(char *uplo, int *n, double *a, int *lda, int *info);
 int dgeqrf_(int *m, int *n, double *a, int *lda, double *tau, double *work, int *lwork, int *info);
 int dgemm_(char *transa, char *transb, int *m, int *n, int *k, double *alpha, double *a, int *lda, double *b, int *ldb, double *beta, double *c__, int *ldc);
 
+static double _matrix_logdet_dense_exact(matrix_t *A, double z, detalg_t detalg);
+static void _kernel_logdet_measure(int dim, void (*kernel_block)(int,int,int,int,double *,int,void *), void *args, const double *diagonal, double tolerance, double *t_elem, int *rank);
+
+
+/* arguments for kernel_block_entrywise */
+typedef struct {
+    double (*kernel)(int,int,void *);
+    void *args;
+} kernel_entrywise_t;
+
+/* block kernel that evaluates the block element by element using a kernel
+ * that returns single matrix elements; used by kernel_logdet */
+static void kernel_block_entrywise(int i0, int j0, int ni, int nj, double *out, int ld, void *args_)
+{
+    kernel_entrywise_t *args = (kernel_entrywise_t *)args_;
+
+    for(int j = 0; j < nj; j++)
+        for(int i = 0; i < ni; i++)
+            out[i+j*ld] = args->kernel(i0+i, j0+j, args->args);
+}
+
+/* default values of the cost model, see \ref kernel_logdet_detalg */
+#define KERNEL_LOGDET_KAPPA 4  /* cost of a matrix element for HODLR relative to dense assembly */
+#define KERNEL_LOGDET_RANK 20  /* typical rank of off-diagonal blocks */
+
+/* relative tolerance of HODLR, see \ref kernel_logdet_set_tolerance */
+static double kernel_logdet_tolerance = KERNEL_LOGDET_TOLERANCE;
+
+/* cost model used for DETALG_AUTO; determined on first use */
+static kernel_logdet_model_t kernel_logdet_model;
+static bool kernel_logdet_model_initialized = false;
+
+/** @brief Calibrate cost model
+ *
+ * Measure the throughput of a dense Cholesky decomposition of a 256x256
+ * matrix (built-in benchmark, runs about 5ms) and store it in model->flops.
+ * model->kappa and model->rank are set to their default values 4 and 20
+ * which have been determined for the round-trip matrix of the plane-sphere
+ * geometry.
+ *
+ * @param [out] model cost model
+ */
+void kernel_logdet_calibrate(kernel_logdet_model_t *model)
+{
+    const int dim = 256;
+    int repetitions = 0;
+    double t = 0;
+    matrix_t *A = matrix_alloc(dim);
+
+    do {
+        /* symmetric, diagonally dominant matrix */
+        for(int i = 0; i < dim; i++)
+            for(int j = 0; j < dim; j++)
+                matrix_set(A, i,j, i == j ? dim : 1./(1+abs(i-j)));
+
+        const double t0 = now();
+        matrix_logdet_cholesky(A, 'U');
+        t += now()-t0;
+        repetitions++;
+    } while(t < 0.005);
+
+    matrix_free(A);
+
+    model->flops = repetitions*pow_2(dim)*dim/3/t;
+    model->kappa = KERNEL_LOGDET_KAPPA;
+    model->rank  = KERNEL_LOGDET_RANK;
+}
+
+/** @brief Set cost model
+ *
+ * Set the cost model used to choose the algorithm if detalg is DETALG_AUTO,
+ * see \ref kernel_logdet_detalg. If model is NULL, the model is determined
+ * again on next use.
+ *
+ * @param [in] model cost model or NULL
+ */
+void kernel_logdet_set_model(const kernel_logdet_model_t *model)
+{
+    if(model == NULL)
+        kernel_logdet_model_initialized = false;
+    else
+    {
+        kernel_logdet_model = *model;
+        kernel_logdet_model_initialized = true;
+    }
+}
+
+/** @brief Set relative tolerance of HODLR
+ *
+ * The off-diagonal blocks of the HODLR tree are compressed with the absolute
+ * tolerance max(eps, eps*tr A), where tr A is the trace of the matrix. As
+ * \f$|\log\det(1-A)| \ge \mathrm{tr} A\f$ for positive eigenvalues, eps is
+ * roughly the relative error of the determinant. The tolerance also enters
+ * the estimate of the rank in the cost model of DETALG_AUTO. The default is
+ * KERNEL_LOGDET_TOLERANCE=1e-13.
+ *
+ * The tolerance is a global setting and not thread-safe.
+ *
+ * @param [in] eps relative tolerance, eps > 0
+ * @retval 1 if successful
+ * @retval 0 if eps <= 0
+ */
+int kernel_logdet_set_tolerance(double eps)
+{
+    if(!(eps > 0))
+        return 0;
+
+    kernel_logdet_tolerance = eps;
+    return 1;
+}
+
+/** @brief Get relative tolerance of HODLR
+ *
+ * See \ref kernel_logdet_set_tolerance.
+ *
+ * @retval eps relative tolerance
+ */
+double kernel_logdet_get_tolerance(void)
+{
+    return kernel_logdet_tolerance;
+}
+
+/** @brief Get cost model
+ *
+ * Return the cost model used to choose the algorithm if detalg is
+ * DETALG_AUTO. If no model has been set using \ref kernel_logdet_set_model,
+ * the model is determined on first use by \ref kernel_logdet_calibrate. The
+ * values can be overridden by the environment variable CAPS_DETALG_MODEL
+ * which contains the values "flops kappa rank" separated by spaces; trailing
+ * values may be omitted. If flops is given, the benchmark is skipped.
+ *
+ * The initialization is not thread-safe; call this function once before
+ * computing determinants concurrently.
+ *
+ * @retval model cost model
+ */
+kernel_logdet_model_t kernel_logdet_get_model(void)
+{
+    if(!kernel_logdet_model_initialized)
+    {
+        kernel_logdet_model_t model = {
+            .flops = NAN, .kappa = KERNEL_LOGDET_KAPPA, .rank = KERNEL_LOGDET_RANK
+        };
+
+        const char *s = getenv("CAPS_DETALG_MODEL");
+        if(s != NULL)
+            sscanf(s, "%lg %lg %lg", &model.flops, &model.kappa, &model.rank);
+
+        if(isnan(model.flops) || model.flops <= 0)
+        {
+            kernel_logdet_model_t calibrated;
+            kernel_logdet_calibrate(&calibrated);
+            model.flops = calibrated.flops;
+        }
+
+        kernel_logdet_set_model(&model);
+    }
+
+    return kernel_logdet_model;
+}
+
+/** @brief Choose algorithm to compute \f$\log\det(1-A)\f$
+ *
+ * Estimate the run time to compute \f$\log\det(1-A)\f$ using a dense
+ * algorithm and using HODLR and return the faster algorithm. The dense
+ * algorithm is Cholesky decomposition if the matrix is symmetric and positive
+ * definite (sym_spd=2) and LU decomposition otherwise. Dense algorithms are
+ * not considered if dim > KERNEL_LOGDET_DENSE_MAX.
+ *
+ * The costs are modelled as follows (see \ref kernel_logdet_get_model for the
+ * parameters flops, kappa and rank):
+ *  - dense: all (for Cholesky: upper half) dim² matrix elements are computed,
+ *    the factorization needs dim³/3 (Cholesky) or 2dim³/3 (LU) operations.
+ *  - HODLR: the leaves need nLeaf*dim matrix elements, every level of the
+ *    tree needs r*dim (symmetric) or 2r*dim (generic) matrix elements for the
+ *    rows and columns computed by adaptive cross approximation, where
+ *    r=min(rank, model rank). A matrix element is kappa times more expensive
+ *    than for dense algorithms. The factorization needs about
+ *    dim*(nLeaf²+r²*n_levels²) operations.
+ *
+ * @param [in] dim     dimension of matrix
+ * @param [in] sym_spd matrix is generic (0), symmetric (1), symmetric positive definite (2)
+ * @param [in] t_elem  time in seconds to compute a matrix element
+ * @param [in] rank    upper bound for the rank of the off-diagonal blocks
+ * @param [in] nLeaf   size of leaves of HODLR tree (0 for default)
+ * @retval detalg DETALG_HODLR, DETALG_CHOLESKY or DETALG_LU
+ */
+detalg_t kernel_logdet_detalg(int dim, int sym_spd, double t_elem, double rank, unsigned int nLeaf)
+{
+    const detalg_t dense = (sym_spd == 2) ? DETALG_CHOLESKY : DETALG_LU;
+
+    if(dim > KERNEL_LOGDET_DENSE_MAX)
+        return DETALG_HODLR;
+
+    const kernel_logdet_model_t model = kernel_logdet_get_model();
+
+    if(nLeaf == 0)
+        nLeaf = KERNEL_LOGDET_NLEAF;
+
+    const double N = dim;
+    const double n_levels = fmax(1, (int)log2(N/nLeaf));
+    const double r = fmin(rank, model.rank);
+
+    /* dense */
+    const double elems_dense = (sym_spd == 2) ? N*(N+1)/2 : N*N;
+    const double ops_dense   = ((sym_spd == 2) ? 1./3 : 2./3)*N*N*N;
+    const double t_dense     = t_elem*elems_dense + ops_dense/model.flops;
+
+    /* HODLR */
+    const double elems_hodlr = N*(nLeaf + ((sym_spd > 0) ? 1 : 2)*r*n_levels);
+    const double ops_hodlr   = N*(pow_2(nLeaf) + pow_2(r*n_levels));
+    const double t_hodlr     = model.kappa*t_elem*elems_hodlr + ops_hodlr/model.flops;
+
+    return (t_dense <= t_hodlr) ? dense : DETALG_HODLR;
+}
 
 /** @brief Compute \f$\log \det(1-A)\f$
  *
@@ -33,12 +250,56 @@ int dgemm_(char *transa, char *transb, int *m, int *n, int *k, double *alpha, do
  * (starting from 0), and a pointer to args. The callback returns the
  * corresponding matrix element.
  *
+ * This is a wrapper around \ref kernel_logdet_block that evaluates blocks of
+ * \f$A\f$ element by element. See \ref kernel_logdet_block for more
+ * information.
+ *
+ * @param [in] dim       dimension of matrix
+ * @param [in] kernel    callback function that returns matrix elements of \f$A\f$
+ * @param [in] args      pointer given to callback function kernel
+ * @param [in] sym_spd   matrix is generic (0), symmetric (1), symmetric positive definite (2)
+ * @param [in] detalg    algorithm (DETALG_HODLR, DETALG_LU, DETALG_QR, DETALG_CHOLESKY, DETALG_AUTO)
+ * @retval logdet \f$\log \det(1-A)\f$
+ */
+double kernel_logdet(int dim, double (*kernel)(int,int,void *), void *args, int sym_spd, detalg_t detalg)
+{
+    kernel_entrywise_t args_entrywise = { .kernel = kernel, .args = args };
+
+    return kernel_logdet_block(dim, kernel_block_entrywise, &args_entrywise, sym_spd, detalg);
+}
+
+/** @brief Compute \f$\log \det(1-A)\f$ using a block kernel
+ *
+ * This function computes \f$\log \det(1-A)\f$ using either the HODLR approach or
+ * LU decomposition. The matrix \f$A\f$ is given as a callback function that
+ * computes whole blocks of the matrix. A call
+ * kernel_block(i0,j0,ni,nj,out,ld,args) must write the block with rows
+ * \f$i_0,\dots,i_0+n_i-1\f$ and columns \f$j_0,\dots,j_0+n_j-1\f$ to out.
+ * The block is stored in column-major order with leading dimension ld, i.e.,
+ * \f$A_{ij}\f$ is stored in out[(i-i0)+(j-j0)*ld]. Indices start from 0.
+ *
  * If the matrix elements of \f$A\f$ are small, i.e., if the modulus of the
  * trace is smaller than 1e-8, the trace will be used as an approximation to
  * prevent a loss of significance. If the modulus of the trace is larger than
  * the modulus of the value computed using HODLR, the trace approximation is
  * returned.
  *
+ * If the matrix is symmetric and positive definite (sym_spd=2, the
+ * eigenvalues of \f$A\f$ are assumed to be in \f$[0,1)\f$) and small, the
+ * determinant is computed from the Mercator series \f$-\log\det(1-A) =
+ * \mathrm{tr} A + \mathrm{tr} A^2/2 + \dots\f$ without a factorization. The
+ * series is used only if a rigorous bound of its error is smaller than the
+ * tolerance of HODLR (see \ref kernel_logdet_set_tolerance). The bound needs
+ * the diagonal and, for \f$\mathrm{tr} A^2\f$, the upper half of the principal
+ * submatrix that contains the bulk of the trace.
+ *
+ * If detalg is DETALG_AUTO, the algorithm is chosen for every call by the cost
+ * model of \ref kernel_logdet_detalg: dense Cholesky (for sym_spd=2) or LU
+ * decomposition for small matrices, HODLR otherwise. The cost of a matrix
+ * element is estimated from the time needed to compute a column, the rank of
+ * the off-diagonal blocks is bounded by the number of diagonal elements that
+ * are larger than the tolerance of HODLR.
+ *
  * If the determinant is not computed using the HODLR approach, all matrix
  * elements have to be computed. In this case the matrix \f$A\f$ is written to
  * the filesystem if the environment variable CAPS_DUMP is set. If the
@@ -47,21 +308,193 @@ int dgemm_(char *transa, char *transb, int *m, int *n, int *k, double *alpha, do
  * debugging. Also note that if detalg is CHOLESKY, only the upper half of the
  * matrix will be initialized.
  *
- * @param [in] dim       dimension of matrix
- * @param [in] kernel    callback function that returns matrix elements of \f$A\f$
- * @param [in] args      pointer given to callback function kernel
- * @param [in] sym_spd   matrix is generic (0), symmetric (1), symmetric positive definite (2)
- * @param [in] detalg    algorithm (DETALG_HODLR, DETALG_LU, DETALG_QR, DETALG_CHOLESKY)
+ * @param [in] dim          dimension of matrix
+ * @param [in] kernel_block callback function that computes blocks of \f$A\f$
+ * @param [in] args         pointer given to callback function kernel_block
+ * @param [in] sym_spd      matrix is generic (0), symmetric (1), symmetric positive definite (2)
+ * @param [in] detalg       algorithm (DETALG_HODLR, DETALG_LU, DETALG_QR, DETALG_CHOLESKY, DETALG_AUTO)
  * @retval logdet \f$\log \det(1-A)\f$
  */
-double kernel_logdet(int dim, double (*kernel)(int,int,void *), void *args, int sym_spd, detalg_t detalg)
+double kernel_logdet_block(int dim, void (*kernel_block)(int,int,int,int,double *,int,void *), void *args, int sym_spd, detalg_t detalg)
+{
+    return kernel_logdet_block_stats(dim, kernel_block, args, sym_spd, detalg, 0, NULL);
+}
+
+/* Measure the parameters of the cost model for DETALG_AUTO: the time t_elem
+ * to compute a matrix element and an upper bound for the rank of the
+ * off-diagonal blocks. */
+static void _kernel_logdet_measure(int dim, void (*kernel_block)(int,int,int,int,double *,int,void *), void *args, const double *diagonal, double tolerance, double *t_elem, int *rank)
+{
+    /* The rank of the off-diagonal blocks can not be larger than the number
+     * of diagonal elements that are not negligible. */
+    *rank = 0;
+    for(int n = 0; n < dim; n++)
+        if(fabs(diagonal[n]) > tolerance)
+            (*rank)++;
+
+    /* The cost of a matrix element is estimated by computing a column in the
+     * middle of the matrix. Kernels usually cache intermediate results, so
+     * the column next to it is computed first. */
+    double *column = xmalloc(((size_t)(dim))*sizeof(double));
+    kernel_block(0,MAX(0,dim/2-1),dim,1,column,dim,args);
+    const double t0 = now();
+    kernel_block(0,dim/2,dim,1,column,dim,args);
+    *t_elem = (now()-t0)/dim;
+    xfree(column);
+}
+
+/* Try to compute log det(Id-M) from the Mercator series
+ *
+ *      -log det(Id-M) = tr(M) + tr(M²)/2 + tr(M³)/3 + ...
+ *
+ * without factorizing the matrix. M must be symmetric and positive
+ * semidefinite with eigenvalues 0 <= λ_i < 1. Then
+ *
+ *      |M_ij|² <= M_ii M_jj   and   λ_max <= ||M||_F = sqrt(tr(M²)).
+ *
+ * 1) Only the diagonal: as -log(1-λ) is convex and λ_i <= λ_max <= tr(M),
+ *    tr(M) <= -log det(Id-M) <= -log(1-tr(M)).
+ *
+ * 2) tr(M²) = Σ_ij M_ij² is computed exactly on a window [a,b) that contains
+ *    the bulk of the diagonal; by Cauchy-Schwarz the elements outside the
+ *    window contribute at most off = tr(M)² - tr_W(M)². The remainder of the
+ *    series is
+ *      Σ_{k>=3} tr(M^k)/k <= λ_max tr(M²)/(3(1-λ_max)).
+ *
+ * In both cases the midpoint of the bounds is returned if half of their
+ * distance is smaller than tolerance. The window is only computed if it
+ * needs fewer matrix elements than the leaves of a HODLR tree. On success
+ * logdet is set and true is returned.
+ *
+ * If plus is not NULL, log det(Id+M) = tr(M) - tr(M²)/2 + tr(M³)/3 - ... is
+ * stored in plus. The same bounds apply: log(1+λ) is concave, i.e.,
+ * log(1+tr(M)) <= log det(Id+M) <= tr(M), and the error is not larger than
+ * for log det(Id-M). */
+static bool _kernel_logdet_series(int dim, void (*kernel_block)(int,int,int,int,double *,int,void *), void *args, const double *diagonal, double trace, double tolerance, unsigned int nLeaf, double *logdet, double *plus)
+{
+    if(trace <= 0 || trace >= 1)
+        return false;
+
+    for(int i = 0; i < dim; i++)
+        if(diagonal[i] < 0)
+            return false;
+
+    /* 1) bounds from the trace */
+    const double upper1 = -log1p(-trace);
+    if((upper1-trace)/2 <= tolerance)
+    {
+        *logdet = -(trace+upper1)/2;
+        if(plus != NULL)
+            *plus = (log1p(trace)+trace)/2;
+        return true;
+    }
+
+    /* 2) shrink the window [a,b) from the smaller end as long as the
+     * elements outside of the window contribute less than tolerance */
+    int a = 0, b = dim;
+    double trace_W = trace;
+    while(b-a > 1)
+    {
+        const bool left = diagonal[a] <= diagonal[b-1];
+        const double trace_new = trace_W - (left ? diagonal[a] : diagonal[b-1]);
+        if(pow_2(trace)-pow_2(trace_new) > tolerance)
+            break;
+
+        trace_W = trace_new;
+        if(left)
+            a++;
+        else
+            b--;
+    }
+
+    const int k = b-a;
+    const double off = pow_2(trace)-pow_2(trace_W);
+
+    /* the remainder is too large even for tr(M²) >= Σ_i M_ii² */
+    double trace2 = 0;
+    for(int i = a; i < b; i++)
+        trace2 += pow_2(diagonal[i]);
+    const double lambda_min = sqrt(trace2);
+    if(off/4 + lambda_min*trace2/(6*(1-lambda_min)) > tolerance)
+        return false;
+
+    if(nLeaf == 0)
+        nLeaf = KERNEL_LOGDET_NLEAF;
+    if((double)k*(k+1)/2 > (double)dim*nLeaf)
+        return false;
+
+    /* upper half of the window, column by column */
+    double *column = xmalloc(((size_t)k)*sizeof(double));
+    for(int j = 1; j < k; j++)
+    {
+        kernel_block(a,a+j,j,1,column,k,args);
+        for(int i = 0; i < j; i++)
+        {
+            const double Mij2 = pow_2(column[i]);
+
+            /* M is not positive semidefinite */
+            if(Mij2 > diagonal[a+i]*diagonal[a+j]*(1+1e-10))
+            {
+                xfree(column);
+                return false;
+            }
+
+            trace2 += 2*Mij2;
+        }
+    }
+    xfree(column);
+
+    const double trace2_max = trace2+off;
+    const double lambda_max = sqrt(trace2_max);
+    if(lambda_max >= 1)
+        return false;
+
+    const double lower = trace + trace2/2;
+    const double upper = trace + trace2_max/2 + lambda_max*trace2_max/(3*(1-lambda_max));
+    if((upper-lower)/2 > tolerance)
+        return false;
+
+    *logdet = -(lower+upper)/2;
+    if(plus != NULL)
+        *plus = trace - (trace2+trace2_max)/4 + lambda_max*trace2_max/(6*(1-lambda_max));
+    return true;
+}
+
+/* arguments for _kernel_block_negative */
+typedef struct {
+    void (*kernel_block)(int,int,int,int,double *,int,void *);
+    void *args;
+} kernel_negative_t;
+
+/* block kernel of -A; log det(Id+A) is computed as log det(Id-(-A)) */
+static void _kernel_block_negative(int i0, int j0, int ni, int nj, double *out, int ld, void *args_)
+{
+    kernel_negative_t *args = (kernel_negative_t *)args_;
+
+    args->kernel_block(i0, j0, ni, nj, out, ld, args->args);
+    for(int j = 0; j < nj; j++)
+        for(int i = 0; i < ni; i++)
+            out[i+(size_t)j*ld] = -out[i+(size_t)j*ld];
+}
+
+/* see kernel_logdet_block_stats and kernel_logdet_block_pm; if plus is not
+ * NULL, log det(Id+A) is stored in plus */
+static double _kernel_logdet_block(int dim, void (*kernel_block)(int,int,int,int,double *,int,void *), void *args, int sym_spd, detalg_t detalg, unsigned int nLeaf, hodlr_stats_t *stats, double *plus)
 {
     double logdet = NAN;
+
+    if(stats != NULL)
+    {
+        stats->n_levels = 0;
+        stats->nLeaf = 0;
+        stats->t_assemble = stats->t_factorize = 0;
+    }
+
     double *diagonal = xmalloc(((size_t)(dim))*sizeof(double));
 
     /* calculate diagonal elements */
     for(int n = 0; n < dim; n++)
-        diagonal[n] = kernel(n,n,args);
+        kernel_block(n,n,1,1,&diagonal[n],1,args);
 
     const double trace = kahan_sum(diagonal, dim);
 
@@ -78,39 +511,76 @@ double kernel_logdet(int dim, double (*kernel)(int,int,void *), void *args, int
     if(fabs(trace) < 1e-8)
     {
         xfree(diagonal);
+        if(plus != NULL)
+            *plus = trace;
         return -trace;
     }
 
+    /* Choose relative error to compute the determinant as ~eps (default:
+     * 1e-13). The value of the determinant is estimated using the trace. As
+     *      |log det(Id-M)| < trace(M)
+     * the estimate trace*eps gives actually a lower error than eps.
+     */
+    const double eps = kernel_logdet_tolerance;
+    const double tolerance = fmax(eps, trace*eps);
+
+    /* Mercator series with certified error */
+    if(sym_spd == 2 && _kernel_logdet_series(dim, kernel_block, args, diagonal, trace, tolerance, nLeaf, &logdet, plus))
+    {
+        xfree(diagonal);
+        return logdet;
+    }
+
+    const bool automatic = (detalg == DETALG_AUTO);
+    if(automatic)
+    {
+        int rank;
+        double t_elem;
+        _kernel_logdet_measure(dim, kernel_block, args, diagonal, tolerance, &t_elem, &rank);
+
+        detalg = kernel_logdet_detalg(dim, sym_spd, t_elem, rank, nLeaf);
+    }
+
     if(detalg != DETALG_HODLR)
     {
         /* allocate space for matrix M */
         matrix_t *M = matrix_alloc(dim);
+        const int lda = M->lda;
 
-        /* set matrix elements to 0 */
-        matrix_setall(M, 0);
-
-        /* copy diagonal */
-        for(size_t k = 0; k < (size_t)dim; k++)
-            matrix_set(M, k,k, diagonal[k]);
-
-        /* n-th minor diagonal */
-        for(size_t md = 1; md < (size_t)dim; md++)
-            for(size_t k = 0; k < (size_t)dim-md; k++)
-            {
-                /* for cholesky decomposition we only need the upper part of
-                 * the matrix */
-                if(detalg != DETALG_CHOLESKY)
-                    matrix_set(M, k,md+k, kernel(k,md+k,args));
-                matrix_set(M, md+k,k, kernel(md+k,k,args));
-            }
+        if(detalg == DETALG_CHOLESKY)
+        {
+            /* for cholesky decomposition we only need the upper part of the
+             * matrix; compute it column by column */
+            matrix_setall(M, 0);
+            for(int j = 0; j < dim; j++)
+                kernel_block(0,j,j+1,1,&M->M[(size_t)j*lda],lda,args);
+        }
+        else
+            kernel_block(0,0,dim,dim,M->M,lda,args);
 
         /* dump */
         const char *filename = getenv("CAPS_DUMP");
         if(filename != NULL)
             matrix_save_to_file(M, filename);
 
-        /* compute logdet */
-        logdet = matrix_logdet_dense(M, -1, detalg);
+        /* log det(Id+M) from a copy of the same matrix */
+        if(plus != NULL)
+        {
+            matrix_t *P = matrix_copy(M);
+            if(automatic)
+                *plus = _matrix_logdet_dense_exact(P, +1, detalg);
+            else
+                *plus = matrix_logdet_dense(P, +1, detalg);
+            matrix_free(P);
+        }
+
+        /* compute logdet; if the algorithm has been chosen automatically,
+         * the result must be as accurate as HODLR, so the Mercator series
+         * (relative accuracy 1e-8) is not used */
+        if(automatic)
+            logdet = _matrix_logdet_dense_exact(M, -1, detalg);
+        else
+            logdet = matrix_logdet_dense(M, -1, detalg);
 
         matrix_free(M);
         xfree(diagonal);
@@ -126,28 +596,285 @@ double kernel_logdet(int dim, double (*kernel)(int,int,void *), void *args, int
          * by n_levels=log_2(N/nLeaf) where N denotes the dimension of the
          * matrix.
          */
-        const unsigned int nLeaf = 50;
-
-        /* Choose relative error to compute the determinant as ~1e-13.
-         * The value of the determinant is estimated using the trace. As
-         *      |log det(Id-M)| < trace(M)
-         * the estimate trace*1e-13 gives actually a lower error than 1e-13.
-         */
-        const double tolerance = fmax(1e-13, trace*1e-13);
+        if(nLeaf == 0)
+            nLeaf = KERNEL_LOGDET_NLEAF;
 
         /* calculate log(det(D)) using HODLR approach */
-        logdet = hodlr_logdet_diagonal(dim, kernel, args, diagonal, nLeaf, tolerance, sym_spd);
+        logdet = hodlr_logdet_diagonal_block_stats(dim, kernel_block, args, diagonal, nLeaf, tolerance, sym_spd, stats);
+
+        /* if |trace| > |log(det(D))|, then the trace result is more accurate;
+         * this bound only holds if the eigenvalues of M are positive. For
+         * negative eigenvalues (e.g., log det(Id+M) computed for -M) we have
+         * |log det(D)| < |trace|. log det(Id+M) is then approximated by the
+         * trace as well, so that both values come from the same
+         * approximation. */
+        if(trace > 0 && trace > fabs(logdet))
+        {
+            logdet = -trace;
+            if(plus != NULL)
+                *plus = trace;
+        }
+        else if(plus != NULL)
+        {
+            /* log det(Id+M) as log det(Id-(-M)); the kernel usually caches
+             * the expensive parts of the matrix elements */
+            kernel_negative_t negative = { .kernel_block = kernel_block, .args = args };
+            for(int n = 0; n < dim; n++)
+                diagonal[n] = -diagonal[n];
+            *plus = hodlr_logdet_diagonal_block_stats(dim, _kernel_block_negative, &negative, diagonal, nLeaf, tolerance, sym_spd, NULL);
+        }
 
         xfree(diagonal);
 
-        /* if |trace| > |log(det(D))|, then the trace result is more accurate */
-        if(fabs(trace) > fabs(logdet))
-            return -trace;
-
         return logdet;
     }
 }
 
+/** @brief Compute \f$\log \det(1-A)\f$ using a block kernel and record statistics
+ *
+ * Same as \ref kernel_logdet_block, but the size of the leaves nLeaf of the
+ * HODLR tree can be chosen; if nLeaf is 0, the default size
+ * KERNEL_LOGDET_NLEAF is used. The number of levels of the tree is given by
+ * log_2(dim/nLeaf).
+ *
+ * If stats is not NULL, the rank statistics of the HODLR tree and the times
+ * needed for assembly and factorization are stored in stats. If the
+ * determinant is not computed using HODLR (dense algorithm or trace
+ * approximation), stats->n_levels is set to 0.
+ *
+ * @param [in] dim          dimension of matrix
+ * @param [in] kernel_block callback function that computes blocks of \f$A\f$
+ * @param [in] args         pointer given to callback function kernel_block
+ * @param [in] sym_spd      matrix is generic (0), symmetric (1), symmetric positive definite (2)
+ * @param [in] detalg       algorithm (DETALG_HODLR, DETALG_LU, DETALG_QR, DETALG_CHOLESKY, DETALG_AUTO)
+ * @param [in] nLeaf        size of leaves of HODLR tree (0 for default)
+ * @param [out] stats       statistics of HODLR computation (may be NULL)
+ * @retval logdet \f$\log \det(1-A)\f$
+ */
+double kernel_logdet_block_stats(int dim, void (*kernel_block)(int,int,int,int,double *,int,void *), void *args, int sym_spd, detalg_t detalg, unsigned int nLeaf, hodlr_stats_t *stats)
+{
+    return _kernel_logdet_block(dim, kernel_block, args, sym_spd, detalg, nLeaf, stats, NULL);
+}
+
+/** @brief Compute \f$\log \det(1-A)\f$ and \f$\log \det(1+A)\f$ using a block kernel
+ *
+ * Same as \ref kernel_logdet_block_stats, but \f$\log \det(1+A)\f$ is
+ * computed as well and stored in plus. Both determinants share the
+ * computation of the matrix: for dense algorithms the matrix is computed
+ * only once and factorized twice; for HODLR the second tree is assembled
+ * from the same kernel, which usually caches the expensive parts of the
+ * matrix elements. The sum of both values is \f$\log\det(1-A^2)\f$.
+ *
+ * If the trace approximation is used (\f$|\mathrm{tr}A| < 10^{-8}\f$, or
+ * HODLR gives \f$|\log\det(1-A)| < \mathrm{tr}A\f$), \f$\log\det(1+A)\f$
+ * is approximated by \f$\mathrm{tr}A\f$.
+ *
+ * @param [in] dim          dimension of matrix
+ * @param [in] kernel_block callback function that computes blocks of \f$A\f$
+ * @param [in] args         pointer given to callback function kernel_block
+ * @param [in] sym_spd      matrix is generic (0), symmetric (1), symmetric positive definite (2)
+ * @param [in] detalg       algorithm (DETALG_HODLR, DETALG_LU, DETALG_QR, DETALG_CHOLESKY, DETALG_AUTO)
+ * @param [in] nLeaf        size of leaves of HODLR tree (0 for default)
+ * @param [out] stats       statistics of HODLR computation of \f$\log \det(1-A)\f$ (may be NULL)
+ * @param [out] plus        \f$\log \det(1+A)\f$
+ * @retval logdet \f$\log \det(1-A)\f$
+ */
+double kernel_logdet_block_pm(int dim, void (*kernel_block)(int,int,int,int,double *,int,void *), void *args, int sym_spd, detalg_t detalg, unsigned int nLeaf, hodlr_stats_t *stats, double *plus)
+{
+    return _kernel_logdet_block(dim, kernel_block, args, sym_spd, detalg, nLeaf, stats, plus);
+}
+
+/* Kernel of the principal submatrix of A with rows and columns offset,
+ * offset+1, ...; see kernel_logdet_block_nested. */
+typedef struct {
+    void (*kernel_block)(int,int,int,int,double *,int,void *);
+    void *args;
+    int offset;
+} kernel_window_t;
+
+static void _kernel_block_window(int i0, int j0, int ni, int nj, double *out, int ld, void *args_)
+{
+    kernel_window_t *window = (kernel_window_t *)args_;
+    window->kernel_block(window->offset+i0, window->offset+j0, ni, nj, out, ld, window->args);
+}
+
+/* Compute log det(Id-A) for the nested windows of the symmetric positive
+ * definite matrix A using a single Cholesky decomposition; see
+ * kernel_logdet_block_nested.
+ *
+ * The rows and columns of the largest window are permuted such that the
+ * first size[k] rows and columns are the window k. As the determinant is
+ * invariant under (symmetric) permutations, the Cholesky factor of the
+ * permuted matrix contains the determinants of all windows:
+ *      log det(Id-A)_k = 2 Σ_{p<size[k]} log U_pp
+ */
+static void _kernel_logdet_nested_cholesky(int n, const int start[], const int size[], void (*kernel_block)(int,int,int,int,double *,int,void *), void *args, double logdet[])
+{
+    const int first = start[n-1], dim = size[n-1];
+
+    /* perm[p] is the index (relative to first) of row p of the permuted
+     * matrix, iperm is the inverse permutation, and window[p] is the first
+     * window that contains the row p */
+    int *perm   = xmalloc(3*(size_t)dim*sizeof(int));
+    int *iperm  = perm+dim;
+    int *window = iperm+dim;
+
+    int p = 0, lo = start[0]-first, hi = lo;
+    for(int k = 0; k < n; k++)
+    {
+        const int lo_k = start[k]-first, hi_k = lo_k+size[k];
+
+        for(int i = lo_k; i < lo; i++, p++)
+        {
+            perm[p] = i;
+            window[p] = k;
+        }
+        for(int i = hi; i < hi_k; i++, p++)
+        {
+            perm[p] = i;
+            window[p] = k;
+        }
+
+        lo = lo_k;
+        hi = hi_k;
+    }
+
+    for(p = 0; p < dim; p++)
+        iperm[perm[p]] = p;
+
+    /* Compute the upper half of Id-A (permuted) column by column. The rows
+     * p <= q of column q are contained in the window of row q, which is a
+     * contiguous range of rows of A. */
+    matrix_t *B = matrix_alloc(dim);
+    const size_t ldb = B->lda;
+    double *column = xmalloc((size_t)dim*sizeof(double));
+    double *diagonal = xmalloc((size_t)dim*sizeof(double));
+
+    matrix_setall(B, 0);
+    for(int q = 0; q < dim; q++)
+    {
+        const int k = window[q];
+        const int lo_k = start[k]-first, ni = size[k];
+
+        kernel_block(first+lo_k, first+perm[q], ni, 1, column, ni, args);
+
+        for(int i = 0; i < ni; i++)
+        {
+            const int row = iperm[lo_k+i];
+            if(row <= q)
+                B->M[row+q*ldb] = -column[i];
+        }
+
+        diagonal[q] = -B->M[q+q*ldb];
+        B->M[q+q*ldb] += 1;
+    }
+
+    xfree(column);
+
+    /* Cholesky decomposition of permuted matrix */
+    char uplo = 'U';
+    int info = 0, dim_ = dim, lda = ldb;
+    dpotrf_(&uplo, &dim_, B->M, &lda, &info);
+    TERMINATE(info != 0, "dpotrf returned %d", info);
+
+    double *logs = xmalloc((size_t)dim*sizeof(double));
+    for(p = 0; p < dim; p++)
+        logs[p] = 2*log(B->M[p+p*ldb]);
+
+    for(int k = 0; k < n; k++)
+    {
+        /* use trace approximation to avoid cancellation, see
+         * kernel_logdet_block_stats */
+        const double trace = kahan_sum(diagonal, size[k]);
+        if(fabs(trace) < 1e-8)
+            logdet[k] = -trace;
+        else
+            logdet[k] = kahan_sum(logs, size[k]);
+    }
+
+    xfree(logs);
+    xfree(diagonal);
+    xfree(perm);
+    matrix_free(B);
+}
+
+/** @brief Compute \f$\log \det(1-A)\f$ for a sequence of nested principal submatrices
+ *
+ * Compute \f$\log \det(1-A_k)\f$ for k=0,...,n-1, where the matrix
+ * \f$A_k\f$ is the principal submatrix (window) of \f$A\f$ with rows and
+ * columns start[k],...,start[k]+size[k]-1. The windows must be nested, i.e.,
+ * every window must contain the previous one. The matrix \f$A\f$ is given by
+ * the block kernel kernel_block, see \ref kernel_logdet_block.
+ *
+ * This function is useful to check the convergence of a determinant with
+ * respect to the truncation of a matrix. If the determinants are computed
+ * using a dense algorithm and the matrix is symmetric and positive definite
+ * (sym_spd=2), the matrix elements of the largest window are computed once
+ * and a single Cholesky decomposition yields the determinants of all windows.
+ * Dense algorithms are therefore only slightly more expensive than for the
+ * largest window alone. Otherwise the determinants of all windows are
+ * computed independently using \ref kernel_logdet_block_stats.
+ *
+ * If detalg is DETALG_AUTO, the algorithm is chosen for the largest window
+ * using the cost model of \ref kernel_logdet_detalg.
+ *
+ * @param [in]  n            number of windows
+ * @param [in]  start        first row/column of the windows
+ * @param [in]  size         dimensions of the windows
+ * @param [in]  kernel_block callback function that computes blocks of \f$A\f$
+ * @param [in]  args         pointer given to callback function kernel_block
+ * @param [in]  sym_spd      matrix is generic (0), symmetric (1), symmetric positive definite (2)
+ * @param [in]  detalg       algorithm (DETALG_HODLR, DETALG_LU, DETALG_QR, DETALG_CHOLESKY, DETALG_AUTO)
+ * @param [in]  nLeaf        size of leaves of HODLR tree (0 for default)
+ * @param [out] logdet       \f$\log \det(1-A_k)\f$ for k=0,...,n-1
+ */
+void kernel_logdet_block_nested(int n, const int start[], const int size[], void (*kernel_block)(int,int,int,int,double *,int,void *), void *args, int sym_spd, detalg_t detalg, unsigned int nLeaf, double logdet[])
+{
+    TERMINATE(n < 1, "n=%d", n);
+
+    for(int k = 0; k < n; k++)
+    {
+        TERMINATE(start[k] < 0 || size[k] < 1, "k=%d, start=%d, size=%d", k, start[k], size[k]);
+        if(k > 0)
+            TERMINATE(start[k] > start[k-1] || start[k]+size[k] < start[k-1]+size[k-1], "windows are not nested: k=%d", k);
+    }
+
+    kernel_window_t window = { .kernel_block = kernel_block, .args = args, .offset = start[n-1] };
+    const int dim = size[n-1];
+
+    if(sym_spd == 2 && detalg == DETALG_AUTO)
+    {
+        /* Compare a Cholesky decomposition of the largest window with HODLR.
+         * If HODLR is used for every window, the matrix elements of the
+         * smaller windows are mostly cached, so only the largest window is
+         * considered. */
+        double *diagonal = xmalloc((size_t)dim*sizeof(double));
+        for(int i = 0; i < dim; i++)
+            _kernel_block_window(i,i,1,1,&diagonal[i],1,&window);
+        const double eps = kernel_logdet_tolerance;
+        const double tolerance = fmax(eps, kahan_sum(diagonal, dim)*eps);
+
+        int rank;
+        double t_elem;
+        _kernel_logdet_measure(dim, _kernel_block_window, &window, diagonal, tolerance, &t_elem, &rank);
+        xfree(diagonal);
+
+        detalg = kernel_logdet_detalg(dim, sym_spd, t_elem, rank, nLeaf);
+    }
+
+    if(sym_spd == 2 && detalg != DETALG_HODLR && detalg != DETALG_AUTO)
+    {
+        _kernel_logdet_nested_cholesky(n, start, size, kernel_block, args, logdet);
+        return;
+    }
+
+    for(int k = 0; k < n; k++)
+    {
+        window.offset = start[k];
+        logdet[k] = kernel_logdet_block_stats(size[k], _kernel_block_window, &window, sym_spd, detalg, nLeaf, NULL);
+    }
+}
+
 /**
  * @brief Create new matrix object
  *
@@ -470,40 +1197,10 @@ double matrix_logdet_triangular(matrix_t *A)
     return kahan_sum(logdet, dim);
 }
 
-/**
- * @brief Calculate \f$\log\det(1+zA)\f$ for matrix \f$A\f$
- *
- * Compute \f$\log\det(1+zA)\f$ using LAPACK. The algorithm is chosen by detalg
- * and may be DETALG_QR, DETALG_LU or DETALG_CHOLESKY.
- *
- * If the Frobenius norm of \f$zA\f$ is smaller than 1, the function tries to
- * approximate \f$\log\det A\f$ using a Mercator series (if possible) to reduce
- * the complexity for an \f$N\times N\f$ matrix \f$A\f$ from
- * \f$\mathcal{O}(N^3)\f$ to \f$\mathcal{O}(N^2)\f$.
- *
- * @param [in,out] A matrix; will be overwritten.
- * @param [in]     z factor \f$z\f$
- * @param [in]     detalg algorithm to use (cholesky, lu or qr)
- * @retval logdet  \f$\log\det(1+zA)\f$
- */
-double matrix_logdet_dense(matrix_t *A, double z, detalg_t detalg)
+/* Compute log det(1+zA) using LAPACK without approximations; see
+ * matrix_logdet_dense. */
+static double _matrix_logdet_dense_exact(matrix_t *A, double z, detalg_t detalg)
 {
-    /* ||zA|| = |z| ||A|| */
-    const double norm = fabs(z)*matrix_norm_frobenius(A);
-
-    if(norm < 1)
-    {
-        /* log(det(Id+zA)) ≈ z*tr(A) - z²/2 tr(A²) + ... */
-        const double trA  = z*matrix_trace(A);
-        const double trA2 = pow_2(z)*matrix_trace2(A);
-        const double mercator = trA-trA2/2;
-        const double error = fabs(pow_2(norm)/2+norm+log1p(-norm));
-        const double rel_error = fabs(error/mercator);
-
-        if(rel_error < 1e-8)
-            return mercator;
-    }
-
     /* A = Id+z*A */
     {
         const size_t dim  = A->dim;
@@ -543,6 +1240,43 @@ double matrix_logdet_dense(matrix_t *A, double z, detalg_t detalg)
         return matrix_logdet_lu(A);
 }
 
+/**
+ * @brief Calculate \f$\log\det(1+zA)\f$ for matrix \f$A\f$
+ *
+ * Compute \f$\log\det(1+zA)\f$ using LAPACK. The algorithm is chosen by detalg
+ * and may be DETALG_QR, DETALG_LU or DETALG_CHOLESKY.
+ *
+ * If the Frobenius norm of \f$zA\f$ is smaller than 1, the function tries to
+ * approximate \f$\log\det A\f$ using a Mercator series (if possible) to reduce
+ * the complexity for an \f$N\times N\f$ matrix \f$A\f$ from
+ * \f$\mathcal{O}(N^3)\f$ to \f$\mathcal{O}(N^2)\f$.
+ *
+ * @param [in,out] A matrix; will be overwritten.
+ * @param [in]     z factor \f$z\f$
+ * @param [in]     detalg algorithm to use (cholesky, lu or qr)
+ * @retval logdet  \f$\log\det(1+zA)\f$
+ */
+double matrix_logdet_dense(matrix_t *A, double z, detalg_t detalg)
+{
+    /* ||zA|| = |z| ||A|| */
+    const double norm = fabs(z)*matrix_norm_frobenius(A);
+
+    if(norm < 1)
+    {
+        /* log(det(Id+zA)) ≈ z*tr(A) - z²/2 tr(A²) + ... */
+        const double trA  = z*matrix_trace(A);
+        const double trA2 = pow_2(z)*matrix_trace2(A);
+        const double mercator = trA-trA2/2;
+        const double error = fabs(pow_2(norm)/2+norm+log1p(-norm));
+        const double rel_error = fabs(error/mercator);
+
+        if(rel_error < 1e-8)
+            return mercator;
+    }
+
+    return _matrix_logdet_dense_exact(A, z, detalg);
+}
+
 /**
  * @brief Calculate \f$\log\det A\f$ using LU decomposition
  *
@@ -577,6 +1311,64 @@ double matrix_logdet_lu(matrix_t *A)
 }
 
 
+/**
+ * @brief Derivatives of \f$\log\det D\f$ using LU decomposition
+ *
+ * For a matrix \f$D(\alpha)\f$ that depends on a parameter \f$\alpha\f$
+ * compute
+ * \f[
+ *  \partial_\alpha \log\det D = \mathrm{tr}\left(D^{-1} D^\prime\right)
+ * \f]
+ * and, if d2 is not NULL,
+ * \f[
+ *  \partial_\alpha^2 \log\det D = \mathrm{tr}\left(D^{-1} D^{\prime\prime}\right) - \mathrm{tr}\left[\left(D^{-1} D^\prime\right)^2\right] \,.
+ * \f]
+ *
+ * The matrices are overwritten: D by its LU decomposition, dD by
+ * \f$D^{-1}D^\prime\f$ and d2D by \f$D^{-1}D^{\prime\prime}\f$.
+ *
+ * @param [in,out] D matrix \f$D\f$
+ * @param [in,out] dD derivative \f$D^\prime\f$
+ * @param [in,out] d2D second derivative \f$D^{\prime\prime}\f$ (only used if d2 is not NULL)
+ * @param [out] d2 \f$\partial_\alpha^2 \log\det D\f$ if not NULL
+ * @retval d1 \f$\partial_\alpha \log\det D\f$
+ */
+double matrix_dlogdet_lu(matrix_t *D, matrix_t *dD, matrix_t *d2D, double *d2)
+{
+    int info = 0;
+    int dim = (int)D->dim;
+    if(dim <= 0)
+        return NAN;
+    int lda = (int)D->lda;
+    int ldb = (int)dD->lda;
+    int nrhs = dim;
+    char trans = 'N';
+    int *ipiv = xmalloc(dim*sizeof(int));
+
+    dgetrf_(&dim, &dim, D->M, &lda, ipiv, &info);
+    TERMINATE(info != 0, "dgetrf returned %d", info);
+
+    /* The matrices are stored row-major, so LAPACK solves the transposed
+     * systems. The traces are invariant under transposition. */
+    dgetrs_(&trans, &dim, &nrhs, D->M, &lda, ipiv, dD->M, &ldb, &info);
+    TERMINATE(info != 0, "dgetrs returned %d", info);
+
+    const double d1 = matrix_trace(dD);
+
+    if(d2 != NULL)
+    {
+        ldb = (int)d2D->lda;
+        dgetrs_(&trans, &dim, &nrhs, D->M, &lda, ipiv, d2D->M, &ldb, &info);
+        TERMINATE(info != 0, "dgetrs returned %d", info);
+
+        *d2 = matrix_trace(d2D) - matrix_trace2(dD);
+    }
+
+    xfree(ipiv);
+
+    return d1;
+}
+
 /**
  * @brief Calculate \f$\log \det A\f$ using Cholesky decomposition
  *
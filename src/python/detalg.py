@@ -4,14 +4,21 @@ from os import system, unlink
 import random, string
 from sys import argv
 
-# script to measure and compare the run-time using HODLR and Cholesky
+# script to measure and compare the run-time using HODLR, Cholesky and the
+# automatic choice (AUTO) between both
+#
+# usage: python detalg.py m xi [TABLE]
+#
+# If TABLE is given, the run-time using HODLR with the tuning table TABLE is
+# measured in addition. Missing entries of the table are determined before
+# the measurement (caps_logdetD --hodlr-tune).
 
-def runtime(LbyR, m, nT, detalg, repeat=3):
+def runtime(LbyR, m, xi, detalg, repeat=3, options=""):
     time = 0
 
     for i in range(repeat):
         filename = "/tmp/" + ''.join(random.choice(string.ascii_uppercase + string.ascii_lowercase + string.digits) for _ in range(10)) + ".csv"
-        cmd = "./caps_logdetD -L %g -R 1 --nT %g -m %d -d %s > %s" % (LbyR, nT, m, detalg, filename)
+        cmd = "./caps_logdetD -L %g -R 1 --xi %g -m %d -d %s %s > %s" % (LbyR, xi, m, detalg, options, filename)
         system(cmd)
         
         with open(filename) as f:
@@ -27,14 +34,25 @@ def runtime(LbyR, m, nT, detalg, repeat=3):
 
 
 m = int(argv[1])
-nT = float(argv[2])
+xi = float(argv[2])
+table = argv[3] if len(argv) > 3 else None
+
+if table is None:
+    print("# R/L, m, xi, CHOLESKY, HODLR, AUTO, 1-HODLR/CHOLESKY")
+else:
+    print("# R/L, m, xi, CHOLESKY, HODLR, AUTO, HODLR (tuned), 1-HODLR/CHOLESKY")
 
-print("# R/L, m, nT, CHOLESKY, HODLR")
 for LbyR in np.logspace(log10(0.1), log10(0.0005), 25):
-    vc, cholesky  = runtime(LbyR, m, nT, "CHOLESKY", repeat=1)
-    vh, hodlr     = runtime(LbyR, m, nT, "HODLR",    repeat=1)
+    vc, cholesky  = runtime(LbyR, m, xi, "CHOLESKY", repeat=1)
+    vh, hodlr     = runtime(LbyR, m, xi, "HODLR",    repeat=1)
+    va, auto      = runtime(LbyR, m, xi, "AUTO",     repeat=1)
 
-    print("%.8g, %d, %g, %g, %g, %e" % (1/LbyR, m, nT, cholesky, hodlr, 1-abs(vh/vc)))
+    if table is None:
+        print("%.8g, %d, %g, %g, %g, %g, %e" % (1/LbyR, m, xi, cholesky, hodlr, auto, 1-abs(vh/vc)))
+    else:
+        runtime(LbyR, m, xi, "HODLR", repeat=1, options="--hodlr-table %s --hodlr-tune" % table)
+        vt, tuned = runtime(LbyR, m, xi, "HODLR", repeat=1, options="--hodlr-table %s" % table)
+        print("%.8g, %d, %g, %g, %g, %g, %g, %e" % (1/LbyR, m, xi, cholesky, hodlr, auto, tuned, 1-abs(vh/vc)))
 
 #LbyR = float(argv[1])
 #m = int(argv[2])
@@ -2,6 +2,8 @@
  * The reference data was produced using scipy functions or Mathematica.
  */
 
+#include <math.h>
+
 #include "bessel.h"
 #include "unittest.h"
 
@@ -7460,3 +7462,43 @@ int test_bessel_ratioI()
 
     return test_results(&test, stderr);
 }
+
+int test_bessel_logIn_array()
+{
+    const double x[] = { 1e-4, 0.01, 0.5, 3, 15, 80, 400, 2000 };
+    const int nmax = 1000;
+    double logIn[nmax+1];
+    unittest_t test;
+    unittest_init(&test, "bessel_logIn_array", "Bessel functions I_n for n=0..nmax", 1e-10);
+
+    for(size_t i = 0; i < sizeof(x)/sizeof(x[0]); i++)
+    {
+        bessel_logIn_array(nmax, x[i], logIn);
+
+        /* compare I_n(x) */
+        for(int n = 0; n <= nmax; n += 7)
+            AssertAlmostEqual(&test, exp(logIn[n]-bessel_logIn(n,x[i])), 1);
+    }
+
+    return test_results(&test, stderr);
+}
+
+int test_bessel_logKn_array()
+{
+    const double x[] = { 1e-4, 0.01, 0.5, 3, 15, 80, 400, 2000 };
+    const int nmax = 1000;
+    double logKn[nmax+1];
+    unittest_t test;
+    unittest_init(&test, "bessel_logKn_array", "Bessel functions K_n for n=0..nmax", 1e-10);
+
+    for(size_t i = 0; i < sizeof(x)/sizeof(x[0]); i++)
+    {
+        bessel_logKn_array(nmax, x[i], logKn);
+
+        /* compare K_n(x) */
+        for(int n = 0; n <= nmax; n += 7)
+            AssertAlmostEqual(&test, exp(logKn[n]-bessel_logKn(n,x[i])), 1);
+    }
+
+    return test_results(&test, stderr);
+}
@@ -19,6 +19,9 @@ int test_bessel_logKn_half(void);
 int test_bessel_logIn(void);
 int test_bessel_logKn(void);
 
+int test_bessel_logIn_array(void);
+int test_bessel_logKn_array(void);
+
 int test_bessel_ratioI(void);
 
 #endif
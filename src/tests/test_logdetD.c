@@ -1,4 +1,5 @@
 #include "libcaps.h"
+#include "matrix.h"
 #include "misc.h"
 #include "unittest.h"
 
@@ -139,5 +140,267 @@ int test_logdetD0()
 
     caps_free(caps);
 
+    /* structured kernels against the element kernels */
+    const int ldim = 140;
+    size_t lmin, lmax;
+    caps = caps_init(1,0.05); /* R/L=20 */
+    caps_set_ldim(caps, ldim);
+    caps_estimate_lminmax(caps, 3, &lmin, &lmax);
+    caps_M_t args = { .caps = caps, .m = 3, .lmin = lmin, .ldim = ldim };
+
+    caps_logdetD0(caps, 3, 0, &EE, &MM, NULL);
+    AssertAlmostEqual(&test, EE, kernel_logdet(ldim, &caps_kernel_M0_EE, &args, 2, DETALG_CHOLESKY));
+    AssertAlmostEqual(&test, MM, kernel_logdet(ldim, &caps_kernel_M0_MM, &args, 2, DETALG_CHOLESKY));
+
+    /* the sum over m does not depend on the number of threads */
+    const double pr = caps_ht_perf(caps, eps);
+    caps_set_threads(caps, 3);
+    AssertAlmostEqual(&test, caps_ht_perf(caps, eps), pr);
+
+    caps_free(caps);
+
+    return test_results(&test, stderr);
+}
+
+/* log det D for the separation L at fixed frequency xi (in rad/s) */
+static double _logdetD_L(double R, double L, int ldim, double *drude, double xi, int m)
+{
+    caps_t *caps = caps_init(R,L);
+    caps_set_ldim(caps, ldim);
+    caps_set_epsrel(caps, 1e-12);
+    if(drude != NULL)
+        caps_set_epsilonm1(caps, caps_epsilonm1_drude, drude);
+
+    const double logdetD = caps_logdetD(caps, xi*(L+R)/CAPS_c, m);
+    caps_free(caps);
+
+    return logdetD;
+}
+
+int test_dlogdetD_dL()
+{
+    const double R = 1e-6, L = 0.1e-6, h = 1e-2*L;
+    const int ldim = 50;
+    double drude[] = { 9/CAPS_hbar_eV, 0.035/CAPS_hbar_eV };
+    double *materials[] = { NULL, drude };
+    unittest_t test;
+
+    unittest_init(&test, "caps_dlogdetD_dL", "Derivatives of logdet with respect to L", 1e-6);
+
+    for(int k = 0; k < 2; k++)
+    {
+        caps_t *caps = caps_init(R,L);
+        caps_set_ldim(caps, ldim);
+        caps_set_epsrel(caps, 1e-12);
+        if(materials[k] != NULL)
+            caps_set_epsilonm1(caps, caps_epsilonm1_drude, materials[k]);
+
+        const int mvalues[] = { 0, 1, 3 };
+        for(int i = 0; i < 3; i++)
+        {
+            const int m = mvalues[i];
+            const double xi_ = 1, xi = xi_*CAPS_c/(L+R);
+
+            /* finite differences of fourth order */
+            double f[5];
+            for(int j = 0; j < 5; j++)
+                f[j] = _logdetD_L(R, L+(j-2)*h, ldim, materials[k], xi, m);
+
+            const double d1_fd = (f[0]-8*f[1]+8*f[3]-f[4])/(12*h);
+            const double d2_fd = (-f[0]+16*f[1]-30*f[2]+16*f[3]-f[4])/(12*h*h);
+
+            double d2;
+            const double d1 = caps_dlogdetD_dL(caps, xi_, m, &d2);
+
+            AssertAlmostEqual(&test, d1, d1_fd);
+            AssertAlmostEqual(&test, d2, d2_fd);
+            AssertAlmostEqual(&test, caps_dlogdetD_dL(caps, xi_, m, NULL), d1);
+        }
+
+        caps_free(caps);
+    }
+
+    return test_results(&test, stderr);
+}
+
+int test_logdetD_window()
+{
+    const double xivalues[] = { 1, 10, 50 }; /* ξL/c */
+    const int mvalues[] = { 0, 5, 20, 60 };
+    size_t dim_full, dim_window;
+    unittest_t test;
+
+    unittest_init(&test, "caps_set_window", "Adaptive truncation window", 1e-9);
+
+    caps_t *caps = caps_init(20,1); /* R/L = 20 */
+    caps_set_ldim(caps, 120);
+
+    for(int i = 0; i < 3; i++)
+        for(int j = 0; j < 4; j++)
+        {
+            const double xi_ = xivalues[i]*21;
+            const int m = mvalues[j];
+
+            caps_set_window(caps, 0);
+            const double full = caps_logdetD(caps, xi_, m);
+
+            caps_set_window(caps, 1e-10);
+            AssertAlmostEqual(&test, caps_logdetD(caps, xi_, m), full);
+        }
+
+    /* the windows are smaller than the matrices for large ξ and m */
+    caps_get_window_stats(caps, &dim_full, &dim_window);
+    AssertEqual(&test, dim_window < dim_full, 1);
+
+    caps_free(caps);
+
+    return test_results(&test, stderr);
+}
+
+int test_logdetD_series()
+{
+    /* computed using HODLR; m=0,...,10 for ξL/c=7 */
+    const double v[] = {
+        -1.1803717010743196e-06, -1.2921092889414338e-06, -8.2693875836594382e-07,
+        -5.2742737023499118e-07, -3.3527427941249241e-07, -2.12431090569628e-07,
+        -1.3416746361268643e-07, -8.4472946871127614e-08, -5.3022286121743081e-08,
+        -3.3181631444246504e-08, -2.0704392645461506e-08
+    };
+    unittest_t test;
+
+    unittest_init(&test, "kernel_logdet_series", "Mercator series with certified error", 1e-5);
+
+    caps_t *caps = caps_init(20,1); /* R/L = 20 */
+    caps_set_ldim(caps, 200);
+
+    /* the traces are too large for the trace approximation; the error of
+     * the Mercator series is smaller than the tolerance of HODLR */
+    for(int m = 0; m < (int)(sizeof(v)/sizeof(v[0])); m++)
+    {
+        const double logdet = caps_logdetD(caps, 7*21, m);
+        AssertAlmostEqual(&test, logdet, v[m]);
+        Assert(&test, fabs(logdet-v[m]) < KERNEL_LOGDET_TOLERANCE);
+    }
+
+    caps_free(caps);
+
+    return test_results(&test, stderr);
+}
+
+int test_M_elem()
+{
+    const int ldim = 30, dim = 2*ldim;
+    double M[dim*dim];
+    unittest_t test;
+
+    unittest_init(&test, "caps_M_elem", "Element and block kernels", 1e-12);
+
+    caps_t *caps = caps_init(20,1); /* R/L = 20 */
+    caps_set_ldim(caps, ldim);
+
+    for(int m = 0; m < 4; m += 3)
+    {
+        caps_M_t *args = caps_M_init(caps, m, 21);
+
+        /* block kernel first, then the element kernel that uses the
+         * diagonal scalings computed by the block kernel */
+        caps_kernel_M_block(0, 0, dim, dim, M, dim, args);
+        for(int j = 0; j < dim; j++)
+            for(int i = 0; i < dim; i++)
+                AssertAlmostEqual(&test, caps_kernel_M(i, j, args), M[i+j*dim]);
+
+        caps_M_free(args);
+    }
+
+    caps_free(caps);
+
+    return test_results(&test, stderr);
+}
+
+int test_logdetD_pm()
+{
+    const int ldim = 60, dim = 2*ldim;
+    const detalg_t detalgs[] = { DETALG_CHOLESKY, DETALG_HODLR };
+    unittest_t test;
+
+    unittest_init(&test, "caps_logdetD_pm", "log det(1-M) and log det(1+M)", 1e-10);
+
+    caps_t *caps = caps_init(5,1); /* R/L = 5 */
+    caps_set_ldim(caps, ldim);
+
+    for(int m = 0; m < 4; m += 3)
+    {
+        const double xi_ = 3;
+
+        /* reference: log det(1+M) using LU decomposition */
+        caps_M_t *args = caps_M_init(caps, m, xi_);
+        matrix_t *D = matrix_alloc(dim);
+        caps_kernel_M_block(0, 0, dim, dim, D->M, D->lda, args);
+        for(int i = 0; i < dim; i++)
+            matrix_set(D, i,i, 1+matrix_get(D, i,i));
+        const double plus_ref = matrix_logdet_lu(D);
+        matrix_free(D);
+        caps_M_free(args);
+
+        for(size_t k = 0; k < sizeof(detalgs)/sizeof(detalgs[0]); k++)
+        {
+            double plus;
+            caps_set_detalg(caps, detalgs[k]);
+            const double minus = caps_logdetD_pm(caps, xi_, m, -1, &plus);
+
+            AssertAlmostEqual(&test, minus, caps_logdetD(caps, xi_, m));
+            AssertAlmostEqual(&test, plus, plus_ref);
+        }
+
+        if(m == 0)
+        {
+            /* polarization blocks EE and MM */
+            double plus, plus_EE, plus_MM;
+            const double minus = caps_logdetD_pm(caps, xi_, 0, -1, &plus);
+            const double EE = caps_logdetD_pm(caps, xi_, 0, 0, &plus_EE);
+            const double MM = caps_logdetD_pm(caps, xi_, 0, 1, &plus_MM);
+
+            AssertAlmostEqual(&test, EE+MM, minus);
+            AssertAlmostEqual(&test, plus_EE+plus_MM, plus);
+        }
+    }
+
+    caps_free(caps);
+
+    return test_results(&test, stderr);
+}
+
+int test_logdetD_sequence()
+{
+    const int ldims[] = { 100, 40, 70 }; /* in any order */
+    const int n = sizeof(ldims)/sizeof(ldims[0]);
+    const detalg_t detalgs[] = { DETALG_CHOLESKY, DETALG_HODLR };
+    double out[n];
+    unittest_t test;
+
+    unittest_init(&test, "caps_logdetD_sequence", "Sequence of truncations ldim", 1e-10);
+
+    caps_t *caps = caps_init(20,1); /* R/L = 20 */
+
+    for(size_t k = 0; k < sizeof(detalgs)/sizeof(detalgs[0]); k++)
+    {
+        caps_set_detalg(caps, detalgs[k]);
+
+        /* for m>0 the windows of l grow on both sides with ldim */
+        for(int m = 0; m < 11; m += 5)
+        {
+            const double xi_ = 21; /* ξL/c = 1 */
+
+            caps_logdetD_sequence(caps, xi_, m, ldims, n, out);
+            for(int i = 0; i < n; i++)
+            {
+                caps_set_ldim(caps, ldims[i]);
+                AssertAlmostEqual(&test, out[i], caps_logdetD(caps, xi_, m));
+            }
+        }
+    }
+
+    caps_free(caps);
+
     return test_results(&test, stderr);
 }
@@ -3,5 +3,11 @@
 
 int test_logdetD(void);
 int test_logdetD0(void);
+int test_dlogdetD_dL(void);
+int test_logdetD_window(void);
+int test_logdetD_series(void);
+int test_M_elem(void);
+int test_logdetD_pm(void);
+int test_logdetD_sequence(void);
 
 #endif
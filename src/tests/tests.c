@@ -36,6 +36,9 @@ int main(int argc, char *argv[])
     test_bessel_logIn();
     test_bessel_logKn();
 
+    test_bessel_logIn_array();
+    test_bessel_logKn_array();
+
     test_bessel_ratioI();
 
     test_caps_mie_perf();
@@ -45,6 +48,12 @@ int main(int argc, char *argv[])
 
     test_logdetD();
     test_logdetD0();
+    test_dlogdetD_dL();
+    test_logdetD_window();
+    test_logdetD_series();
+    test_M_elem();
+    test_logdetD_pm();
+    test_logdetD_sequence();
 
 	return 0;
 }